@@ -41,8 +41,6 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
-#include <signal.h>
-#include <sys/time.h>
 #include <errno.h>
 #include <unistd.h>
 #ifndef __USE_XOPEN
@@ -51,6 +49,8 @@
 #include <time.h>
 #include "previpass.h"
 #include "mangOH_Kim1.h"
+#include "json.h"
+#include "dhubUtils.h"
 #include "gpslib.h"
 #include "argosPublisher.h"
 
@@ -66,6 +66,24 @@
 #define DEFAULT_FREQ_BAND       1       //!< default ARGOS 2 band
 #define DEFAULT_FREQ_OFFSET     0       //!< default frequency offset (kHz) for ARGOS 2 transmit
 #define GPS_FRAME_LENGTH        11      //!< length of an ARGOS frame containing GPS data (bytes)
+#define TX_BURST_COUNT          5       //!< number of TX of the first frame
+#define TX_BURST_INTERVAL       15      //!< time (seconds) between 2 TX of the first frame
+#define DEFAULT_FIX_MAX_AGE     120     //!< oldest cached GPS fix (seconds) used for a frame
+#define DEFAULT_TTF             (TIMEOUT / 2) //!< time to fix (seconds) assumed before any is measured
+#define PREWARM_FACTOR          1.5     //!< GNSS pre-warm lead, relative to the time to fix
+#define PREWARM_MARGIN          5       //!< GNSS pre-warm lead (seconds) added to the above
+#define DEFAULT_FIX_MAX_ERROR   100     //!< least accurate cached fix (metres) used for a frame
+
+//! Data Hub resource paths
+#define FIX_MAX_AGE_PATH        "argos/fixMaxAge"
+#define FIX_MAX_ERROR_PATH      "argos/fixMaxError"
+#define PREWARM_LEAD_PATH       "argos/prewarm/lead"
+#define TIME_TO_FIX_PATH        "argos/prewarm/timeToFix"
+#define PASS_USAGE_PATH         "argos/passUsage"
+#define POS_OBS_PATH            "/obs/argos"
+#define POS_SENSOR_INPUT_PATH   "/app/redSensor/position/value"
+#define DR_OBS_PATH             "/obs/argosReckoned"
+#define DR_SENSOR_INPUT_PATH    "/app/redSensor/deadReckoning/value"
 
 #define NUM_ELEMS(a) (sizeof(a)/sizeof(a[0]))
 
@@ -109,6 +127,24 @@ struct SatelliteNextPassPrediction_t satPass;
 //! 2) NextPass if currently, no satellite is available in visibility period
 int fd_kineis;
 uint8_t gpsframe[GPS_FRAME_LENGTH];
+//! ARGOS protocol scheduler
+static le_timer_Ref_t protocolTimer;
+//! Oldest cached GPS fix (seconds) used for a frame
+static unsigned int fixMaxAge = DEFAULT_FIX_MAX_AGE;
+//! Least accurate cached GPS fix (metres) used for a frame
+static float fixMaxError = DEFAULT_FIX_MAX_ERROR;
+//! GNSS pre-warm, started ahead of the scheduler (lead in seconds, 0 = learned)
+static le_timer_Ref_t prewarmTimer;
+static unsigned int prewarmLead;
+//! Time of the first TX in the current satellite pass (0 = none yet)
+static time_t passFirstTx;
+#if MODEM_ENABLE
+//! First frame transmission burst
+static le_timer_Ref_t burstTimer;
+static char burstFrame[2 * GPS_FRAME_LENGTH + 1];
+static int burstTry;
+static unsigned long burstNxtTimerHandlerExec;
+#endif
 // -------------------------------------------------------------------------- //
 //! Convert satellite code to two chars name.
 // -------------------------------------------------------------------------- //
@@ -218,14 +254,184 @@ unsigned short crc16(char *ptr, int count)
 }
 
 // -------------------------------------------------------------------------- //
-//! @brief ARGOS protocol scheduler main function
+//! @brief Fill the prediction configuration in from a GPS acquisition
 //!
-//! This function is actually a timer handler. The ARGOS protocol scheduler is
-//! timer-based. It will be called each time an ARGOS message needs to be transmitted
-//! on KINEIS network.
+//! Unless a fix was just acquired, the current local time is used. Without a fix, the
+//! last known position (if any) is kept.
+//!
+//! @param[in]  status outcome of the acquisition
+//! @param[in]  fix position and time (NULL if status is GPS_FIX_NONE)
+//! @param[out] alt altitude of the fix
+//!
+//! @returns 0 if a new or recent enough cached fix was used, 1 otherwise
+// -------------------------------------------------------------------------- //
+static int apply_fix(enum gps_fix_status status, const struct gps_fix *fix, float *alt)
+{
+	time_t tnow;
+	struct tm *local_tnow;
+
+	if (fix != NULL) {
+		prepasConfiguration.beaconLatitude = fix->latitude;
+		prepasConfiguration.beaconLongitude = fix->longitude;
+		*alt = fix->altitude;
+	}
+
+	if (status == GPS_FIX_NEW) {
+		prepasConfiguration.start.year = fix->year;
+		prepasConfiguration.start.month = fix->month;
+		prepasConfiguration.start.day = fix->day;
+		prepasConfiguration.start.hour = fix->hour;
+		prepasConfiguration.start.minute = fix->min;
+		prepasConfiguration.start.second = fix->sec;
+		return 0;
+	}
+
+	if (status == GPS_FIX_LAST)
+		printf("[LOG_WARNING] Using last GPS fix, %.0f s old\n", fix->age);
+
+	//! Get current local time if GPS acquisition failed or was skipped
+	time(&tnow);
+	local_tnow = localtime(&tnow);
+	prepasConfiguration.start.year = local_tnow->tm_year + 1900;
+	prepasConfiguration.start.month = local_tnow->tm_mon + 1;
+	prepasConfiguration.start.day = local_tnow->tm_mday;
+	prepasConfiguration.start.hour = local_tnow->tm_hour;
+	prepasConfiguration.start.minute = local_tnow->tm_min;
+	prepasConfiguration.start.second = local_tnow->tm_sec;
+	return (status == GPS_FIX_CACHED) ? 0 : 1;
+}
+
+// -------------------------------------------------------------------------- //
+//! @brief GNSS pre-warm lead
+//!
+//! Unless set by the "argos/prewarm/lead" setting, the lead is learned from the time
+//! to fix of recent acquisitions.
+//!
+//! @returns time (seconds) GNSS acquisition is started ahead of the scheduler
+// -------------------------------------------------------------------------- //
+static unsigned long prewarm_lead(void)
+{
+	double ttf = gps_time_to_fix();
+	unsigned long lead;
+
+	if (prewarmLead > 0)
+		return prewarmLead;
+
+	if (isnan(ttf))
+		ttf = DEFAULT_TTF;
+
+	lead = (unsigned long) ceil(ttf * PREWARM_FACTOR) + PREWARM_MARGIN;
+	if (lead > TIMEOUT)
+		lead = TIMEOUT;
+
+	return lead;
+}
+
+// -------------------------------------------------------------------------- //
+//! @brief Arm the ARGOS protocol scheduler, and the GNSS pre-warm ahead of it
+//!
+//! @param[in]  delay time (seconds) until the scheduler runs
+// -------------------------------------------------------------------------- //
+static void arm_protocol_timer(unsigned long delay)
+{
+	unsigned long lead = prewarm_lead();
+
+	le_timer_Stop(protocolTimer);
+	le_timer_SetMsInterval(protocolTimer, delay * 1000);
+	le_timer_Start(protocolTimer);
+
+	le_timer_Stop(prewarmTimer);
+	if (delay > lead) {
+		le_timer_SetMsInterval(prewarmTimer, (delay - lead) * 1000);
+		le_timer_Start(prewarmTimer);
+	}
+}
+
+// -------------------------------------------------------------------------- //
+//! @brief Report the time to fix, if an acquisition was made
+//!
+//! @param[in]  status outcome of the GPS acquisition
+// -------------------------------------------------------------------------- //
+static void report_time_to_fix(enum gps_fix_status status)
+{
+	double ttf = gps_time_to_fix();
+
+	if ((status != GPS_FIX_CACHED) && !isnan(ttf))
+		dhubIO_PushNumeric(TIME_TO_FIX_PATH, DHUBIO_NOW, ttf);
+}
+
+// -------------------------------------------------------------------------- //
+//! @brief Keep track of the first TX in the current satellite pass
+//!
+//! @param[in]  t time of the TX
+// -------------------------------------------------------------------------- //
+static void record_tx(time_t t)
+{
+	double since_start = difftime(t, (time_t)satPass.epoch);
+
+	if ((passFirstTx == 0) && (since_start >= 0) && (since_start < satPass.duration))
+		passFirstTx = t;
+}
+
+// -------------------------------------------------------------------------- //
+//! @brief Report the fraction of the satellite pass window that was used, i.e. that
+//! was left after the first TX
+// -------------------------------------------------------------------------- //
+static void report_pass_usage(void)
+{
+	double used = 0.0;
+
+	if (passFirstTx != 0)
+		used = ((double)satPass.epoch + satPass.duration - passFirstTx) / satPass.duration;
+	if (used > 1.0)
+		used = 1.0;
+
+	printf("[DEBUG_LOG] Satellite pass window used: %.0f %%\n", used * 100.0);
+	dhubIO_PushNumeric(PASS_USAGE_PATH, DHUBIO_NOW, used);
+	passFirstTx = 0;
+}
+
+// -------------------------------------------------------------------------- //
+//! @brief GNSS pre-warm completion
+//!
+//! The fix is kept in the GPS fix cache, where the scheduler will find it.
+//!
+//! @param[in]  status outcome of the GPS acquisition
+//! @param[in]  fix not used
+//! @param[in]  context not used
+// -------------------------------------------------------------------------- //
+static void prewarm_fix_handler(enum gps_fix_status status,
+		const struct gps_fix *fix, void *context)
+{
+	report_time_to_fix(status);
+}
+
+// -------------------------------------------------------------------------- //
+//! @brief GNSS pre-warm timer handler
+//!
+//! Starts a GPS acquisition so that the scheduler finds a fresh fix in the cache and
+//! transmits at once. A cached fix that will still be recent enough when the scheduler
+//! runs makes the acquisition unnecessary.
+//!
+//! @param[in]  timer not used
+// -------------------------------------------------------------------------- //
+static void prewarm_timer_handler(le_timer_Ref_t timer)
+{
+	le_clk_Time_t remaining = le_timer_GetTimeRemaining(protocolTimer);
+	unsigned int max_age = 0;
+
+	if (fixMaxAge > remaining.sec)
+		max_age = fixMaxAge - remaining.sec;
+
+	printf("[DEBUG_LOG] GNSS pre-warm, %ld s ahead of the scheduler\n",
+		(long) remaining.sec);
+	gps_pos_async(TIMEOUT, max_age, fixMaxError, prewarm_fix_handler, NULL);
+}
+
+// -------------------------------------------------------------------------- //
+//! @brief ARGOS protocol scheduler, GPS acquisition completion
 //!
 //! Design is:
-//! * get GPS position and time
 //! * power ON KIM1
 //! * transmit position to KINEIS network
 //! * power OFF KIM1
@@ -233,44 +439,35 @@ unsigned short crc16(char *ptr, int count)
 //! * if yes, reprogram timer to next TX_INTERVAL
 //! * if not, compute next satellite pass and program timer to the beginning of this new pass
 //!
-//! @param[in]  signum not used
+//! @param[in]  status outcome of the GPS acquisition
+//! @param[in]  fix position and time (NULL if status is GPS_FIX_NONE)
+//! @param[in]  context not used
 //!
 //! @returns void
 // -------------------------------------------------------------------------- //
-void argos_protocol_timer_handler(int signum)
+static void argos_protocol_fix_handler(enum gps_fix_status status,
+		const struct gps_fix *fix, void *context)
 {
-	struct itimerval timer;
 	time_t tnow;
-	struct tm *local_tnow;
 	unsigned long nxtTimerHandlerExec = 0;
 	int j = 0;
 	uint16_t crc = 0;
 	char temp[256];
-	float beacon_alt; //! Used Only to call gpslib APIs correctely
+	float beacon_alt = 0; //! Used Only to call gpslib APIs correctely
+
+#if MODEM_ENABLE
+	//! A first transmission burst is in progress, and will rearm the scheduler
+	if (le_timer_IsRunning(burstTimer))
+		return;
+#endif
+
+	report_time_to_fix(status);
 
 	//! Get position and current time from GPS receiver
-	if (gps_pos(&(prepasConfiguration.beaconLatitude),
-			&(prepasConfiguration.beaconLongitude),
-			&beacon_alt,
-			&(prepasConfiguration.start.year),
-			&(prepasConfiguration.start.month),
-			&(prepasConfiguration.start.day),
-			&(prepasConfiguration.start.hour),
-			&(prepasConfiguration.start.minute),
-			&(prepasConfiguration.start.second))) {
+	if (apply_fix(status, fix, &beacon_alt)) {
 		printf("[LOG_WARNING] issue when running GPS !!!\n");
 		printf("[LOG_WARNING] GPS coordinates may not be the latest correct ones !!!\n");
 		printf("[LOG_WARNING] Please check gps receiver\n");
-
-		//! Get current local time if GPS acquisition failed
-		time(&tnow);
-		local_tnow = localtime(&tnow);
-		prepasConfiguration.start.year = local_tnow->tm_year + 1900;
-		prepasConfiguration.start.month = local_tnow->tm_mon + 1;
-		prepasConfiguration.start.day = local_tnow->tm_mday;
-		prepasConfiguration.start.hour = local_tnow->tm_hour;
-		prepasConfiguration.start.minute = local_tnow->tm_min;
-		prepasConfiguration.start.second = local_tnow->tm_sec;
 	}
 
 	//! SEND DATA and Parse response
@@ -311,6 +508,7 @@ void argos_protocol_timer_handler(int signum)
 		//! Send message
 		if (mangOH_kim_uart_tx_data(fd_kineis, &temp[0])) {
 			time(&tnow);
+			record_tx(tnow);
 			printf(">> Frame transmission at %s (PASS)\n", ctime(&tnow));
 		} else {
 			time(&tnow);
@@ -333,6 +531,8 @@ void argos_protocol_timer_handler(int signum)
 		nxtTimerHandlerExec = TX_INTERVAL;
 	} else {
 		//! Current satellite is no more in visibilty period
+		report_pass_usage();
+
 		//! So compute next Pass
 		if (!PREVIPASS_compute_next_pass_with_status(&prepasConfiguration,
 				aopTable,
@@ -371,11 +571,29 @@ void argos_protocol_timer_handler(int signum)
 	}
 
 	//! Configure the timer to expire after nxtTimerHandlerExec (for one shot)
-	timer.it_value.tv_sec = nxtTimerHandlerExec;
-	timer.it_value.tv_usec = 0;
-	timer.it_interval.tv_sec = 0;
-	timer.it_interval.tv_usec = 0;
-	setitimer(ITIMER_VIRTUAL, &timer, NULL);
+	arm_protocol_timer(nxtTimerHandlerExec);
+}
+
+// -------------------------------------------------------------------------- //
+//! @brief ARGOS protocol scheduler main function
+//!
+//! This function is actually a timer handler. The ARGOS protocol scheduler is
+//! timer-based. It will be called each time an ARGOS message needs to be transmitted
+//! on KINEIS network. It starts a GPS acquisition, and the transmission is done by
+//! argos_protocol_fix_handler once it completes, so the event loop keeps running
+//! meanwhile.
+//!
+//! @param[in]  timer not used
+//!
+//! @returns void
+// -------------------------------------------------------------------------- //
+static void argos_protocol_timer_handler(le_timer_Ref_t timer)
+{
+	if (gps_pos_async(TIMEOUT, fixMaxAge, fixMaxError, argos_protocol_fix_handler,
+			NULL)) {
+		printf("[LOG_ERROR] Failed to start GPS acquisition, retry in %d s\n", TX_INTERVAL);
+		arm_protocol_timer(TX_INTERVAL);
+	}
 }
 
 #ifdef MODEM_ENABLE
@@ -435,46 +653,78 @@ static bool mangOH_kim_set_tx_cfg(int fd)
 }
 #endif
 
+#if MODEM_ENABLE
 // -------------------------------------------------------------------------- //
-//! @brief main function of the example integrating KIM library and satellite pass
-//! prediction library
+//! @brief First frame transmission burst, one TX every TX_BURST_INTERVAL seconds
+//!
+//! @param[in]  timer not used
+//!
+//! @returns void
+// -------------------------------------------------------------------------- //
+static void burst_timer_handler(le_timer_Ref_t timer)
+{
+	time_t tnow;
+
+	//! Send message
+	if (mangOH_kim_uart_tx_data(fd_kineis, &burstFrame[0])) {
+		time(&tnow);
+		record_tx(tnow);
+		printf(">> Frame transmission at %s (PASS)\n", ctime(&tnow));
+	} else {
+		time(&tnow);
+		printf(">> Frame transmission at %s (FAIL) !!!\n", ctime(&tnow));
+	}
+
+	if (++burstTry < TX_BURST_COUNT)
+		return;
+
+	le_timer_Stop(burstTimer);
+
+	//! Close KIM KIM1 fd
+	printf("[DEBUG_LOG] Close /dev/ttyHS0\n");
+	mangOH_kim_close(fd_kineis);
+
+	//! Configure the timer to expire after (prediction - timenow) ...
+	arm_protocol_timer(burstNxtTimerHandlerExec);
+}
+#endif
+
+// -------------------------------------------------------------------------- //
+//! @brief First GPS acquisition completion
 //!
 //! Design is:
-//! * get current time through one GPS acquisition
+//! * update the system date from the GPS time
 //! * compute next satellite pass
+//! * transmit position to KINEIS network TX_BURST_COUNT times
 //! * schedule a timer to starting time of next pass
 //!
-//! @param[in]  argc not used
-//! @param[in]  argv not used
+//! @param[in]  status outcome of the GPS acquisition
+//! @param[in]  fix position and time (NULL if status is GPS_FIX_NONE)
+//! @param[in]  context not used
 //!
-//! @returns error status (0: OK, 1 FAIL)
+//! @returns void
 // -------------------------------------------------------------------------- //
-LE_SHARED int argos_publisher (void)
+static void argos_publisher_fix_handler(enum gps_fix_status status,
+		const struct gps_fix *fix, void *context)
 {
-	struct itimerval timer;
-	float beacon_alt; //! Used Only to call gpslib APIs correctely
+	float beacon_alt = 0; //! Used Only to call gpslib APIs correctely
 	unsigned long nxtTimerHandlerExec;
 	int j = 0;
 	uint16_t crc = 0;
 	char temp[256];
 	//! timenow
 	time_t tnow = time(NULL);
-	int try = 0 ;
 	char cmd[30];
 	FILE *output = NULL;
 
-        LE_INFO("Sending data through KIM1 IoT Card to ArgosWeb");
+	report_time_to_fix(status);
 
 	//! Init beacon_lat, beacon_long and beacon_alt with gps coordinates
-	if (!gps_pos(&(prepasConfiguration.beaconLatitude),
-			&(prepasConfiguration.beaconLongitude),
-			&beacon_alt,
-			&(prepasConfiguration.start.year),
-			&(prepasConfiguration.start.month),
-			&(prepasConfiguration.start.day),
-			&(prepasConfiguration.start.hour),
-			&(prepasConfiguration.start.minute),
-			&(prepasConfiguration.start.second))) {
+	if (apply_fix(status, fix, &beacon_alt)) {
+		printf("1st GPS coordinates unavailable !!!\n");
+		printf("It is impossible to update the UTC date of the module !!!\n");
+		printf("Please check gps receiver and restart the application.\n");
+	} else if (status == GPS_FIX_NEW) {
 		//! Update System date
 		snprintf(cmd, sizeof(cmd), "date %02d%02d%02d%02d%04d",
 				prepasConfiguration.start.month,
@@ -487,10 +737,6 @@ LE_SHARED int argos_publisher (void)
 			fprintf(stderr, "Erreur popen %d\n", errno);
 
 		pclose(output);
-	} else {
-		printf("1st GPS coordinates unavailable !!!\n");
-		printf("It is impossible to update the UTC date of the module !!!\n");
-		printf("Please check gps receiver and restart the application.\n");
 	}
  
         LE_INFO("Point1");
@@ -545,10 +791,11 @@ LE_SHARED int argos_publisher (void)
 			SAT_UPLK_ON_WITH_A2,
 			&satPass)) {
 		printf("ERROR : failed to compute next pass\n");
-		return 1;
+		return;
 	}
 
 	writeOnePass(&satPass);
+	passFirstTx = 0;
 
         printf("t_now = %s\n", ctime(&tnow));
 
@@ -560,7 +807,7 @@ LE_SHARED int argos_publisher (void)
 			printf("Error: it's too late, you missed the satellite...\n");
 			printf("Data transmission skipped\n");
 			printf("Please restart the application\n");
-			return 1;
+			return;
 		}
 		//! This satelite is currently in visibility period
 		//! In order to be able to send data now, nxtTimerHandlerExec
@@ -569,58 +816,218 @@ LE_SHARED int argos_publisher (void)
 	}
 
 #if MODEM_ENABLE
+	//! A previous transmission burst is still in progress
+	if (le_timer_IsRunning(burstTimer)) {
+		printf("[LOG_WARNING] Transmission in progress, frame skipped\n");
+		return;
+	}
+
 	//! Initialise serial port wired to Kineis modem
 	printf("[DEBUG_LOG] Open /dev/ttyHS0 and set serial port parameters\n");
 	fd_kineis = mangOH_kim_open(NULL);
 	if (fd_kineis != -1) {
 		//! Set TX Configuration
 		// mangOH_kim_set_tx_cfg(fd_kineis);
-                //! Send message
-		while (try<5){
-			if (mangOH_kim_uart_tx_data(fd_kineis, &temp[0])) {
-				time(&tnow);
-				printf(">> Frame transmission at %s (PASS)\n", ctime(&tnow));
-			} else {
-				time(&tnow);
-				printf(">> Frame transmission at %s (FAIL) !!!\n", ctime(&tnow));
-			}
-                sleep(15);
-		try++;
-                }
-
-		//! Close KIM KIM1 fd
-		printf("[DEBUG_LOG] Close /dev/ttyHS0\n");
-		mangOH_kim_close(fd_kineis);
-	} else {
-		printf("[LOG_ERROR] Open /dev/ttyHS0 FAILED, skip frame transmission\n");
+		//! The scheduler is rearmed at the end of the burst
+		le_timer_Stop(protocolTimer);
+		strcpy(burstFrame, temp);
+		burstTry = 0;
+		burstNxtTimerHandlerExec = nxtTimerHandlerExec;
+		le_timer_Start(burstTimer);
+		burst_timer_handler(burstTimer);
+		return;
 	}
+	printf("[LOG_ERROR] Open /dev/ttyHS0 FAILED, skip frame transmission\n");
 #endif
 
 	//! Configure the timer to expire after (prediction - timenow) ...
-	timer.it_value.tv_sec = nxtTimerHandlerExec;
-	timer.it_value.tv_usec = 0;
-
-	//! One shot
-	timer.it_interval.tv_sec = 0;
-	timer.it_interval.tv_usec = 0;
+	arm_protocol_timer(nxtTimerHandlerExec);
+}
 
-	setitimer(ITIMER_VIRTUAL, &timer, NULL);
+// -------------------------------------------------------------------------- //
+//! @brief main function of the example integrating KIM library and satellite pass
+//! prediction library
+//!
+//! Design is:
+//! * get current time through one GPS acquisition
+//! * compute next satellite pass
+//! * schedule a timer to starting time of next pass
+//!
+//! The GPS acquisition is asynchronous: this function returns at once, and the rest
+//! is done by argos_publisher_fix_handler once the acquisition completes.
+//!
+//! @returns error status (0: OK, 1 FAIL)
+// -------------------------------------------------------------------------- //
+LE_SHARED int argos_publisher (void)
+{
+	LE_INFO("Sending data through KIM1 IoT Card to ArgosWeb");
 
-	//! Close KIM KIM1 fd
-	mangOH_kim_close(fd_kineis);
+	if (gps_pos_async(TIMEOUT, fixMaxAge, fixMaxError, argos_publisher_fix_handler,
+			NULL)) {
+		printf("ERROR : failed to start GPS acquisition\n");
+		return 1;
+	}
 
 	return 0;
 }
 
+// -------------------------------------------------------------------------- //
+//! @brief Extract a numeric member from a JSON object
+//!
+//! @returns the number, or NAN if it couldn't be extracted
+// -------------------------------------------------------------------------- //
+static double extract_number(const char *json, const char *member_name)
+{
+	char member[32];
+	json_DataType_t data_type;
+
+	if ((json_Extract(member, sizeof(member), json, member_name, &data_type) != LE_OK) ||
+	    (data_type != JSON_TYPE_NUMBER))
+		return NAN;
+
+	return json_ConvertToNumber(member);
+}
+
+// -------------------------------------------------------------------------- //
+//! @brief Put each fix pushed by the position sensor in the GPS fix cache
+//!
+//! @param[in]  timestamp time (seconds since the epoch) of the fix
+//! @param[in]  value position sensor JSON sample
+//! @param[in]  context not used
+// -------------------------------------------------------------------------- //
+static void position_push_handler(double timestamp, const char *value, void *context)
+{
+	struct gps_fix fix;
+	double age = extract_number(value, "age");
+	double h_acc = extract_number(value, "hAcc");
+	double alt = extract_number(value, "alt");
+	time_t fix_time;
+	struct tm utc;
+
+	fix.latitude = extract_number(value, "lat");
+	fix.longitude = extract_number(value, "lon");
+	if (isnan(fix.latitude) || isnan(fix.longitude)) {
+		LE_ERROR("Failed to decode position value '%s'.", value);
+		return;
+	}
+
+	//! Repeated fixes carry their age, and simplified tracks are pushed late.
+	//! Dead-reckoned positions (with a "reckoned" member) are current, with
+	//! their error bound in hAcc, so they refresh the cache without GNSS
+	//! for as long as that bound is within fixMaxError. They don't replace
+	//! a more accurate fix that is still usable.
+	if (isnan(age))
+		age = 0.0;
+	fix_time = (time_t)(timestamp - age);
+	age = difftime(time(NULL), fix_time);
+	if (age < 0.0)
+		age = 0.0;
+	gmtime_r(&fix_time, &utc);
+
+	fix.is_3d = !isnan(alt);
+	fix.altitude = fix.is_3d ? alt : 0.0f;
+	fix.accuracy = h_acc;
+	fix.year = utc.tm_year + 1900;
+	fix.month = utc.tm_mon + 1;
+	fix.day = utc.tm_mday;
+	fix.hour = utc.tm_hour;
+	fix.min = utc.tm_min;
+	fix.sec = utc.tm_sec;
+	fix.age = age;
+
+	gps_cache_put(&fix, fixMaxAge);
+}
+
+// -------------------------------------------------------------------------- //
+//! @brief Fix max age setting push handler
+// -------------------------------------------------------------------------- //
+static void fix_max_age_push_handler(double timestamp, double value, void *context)
+{
+	if (!(value >= 0.0)) {
+		LE_ERROR("Invalid GPS fix max age %lf.", value);
+		return;
+	}
+
+	fixMaxAge = (unsigned int)value;
+}
+
+// -------------------------------------------------------------------------- //
+//! @brief Fix max error setting push handler
+// -------------------------------------------------------------------------- //
+static void fix_max_error_push_handler(double timestamp, double value, void *context)
+{
+	if (!(value > 0.0)) {
+		LE_ERROR("Invalid GPS fix max error %lf.", value);
+		return;
+	}
+
+	fixMaxError = (float)value;
+}
+
+// -------------------------------------------------------------------------- //
+//! @brief Pre-warm lead setting push handler
+// -------------------------------------------------------------------------- //
+static void prewarm_lead_push_handler(double timestamp, double value, void *context)
+{
+	if (!(value >= 0.0)) {
+		LE_ERROR("Invalid GNSS pre-warm lead %lf.", value);
+		return;
+	}
+
+	prewarmLead = (unsigned int)value;
+}
+
 COMPONENT_INIT
 {
-	struct sigaction sa;
+	le_result_t result;
 
-	//! Install timer_handler as the signal handler for SIGVTALRM.
-	memset(&sa, 0, sizeof(sa));
-	sa.sa_handler = &argos_protocol_timer_handler;
-	sigaction(SIGVTALRM, &sa, NULL);
+	//! ARGOS protocol scheduler
+	protocolTimer = le_timer_Create("argosProtocol");
+	le_timer_SetHandler(protocolTimer, argos_protocol_timer_handler);
+	prewarmTimer = le_timer_Create("argosPrewarm");
+	le_timer_SetHandler(prewarmTimer, prewarm_timer_handler);
+
+#if MODEM_ENABLE
+	burstTimer = le_timer_Create("argosBurst");
+	le_timer_SetMsInterval(burstTimer, TX_BURST_INTERVAL * 1000);
+	le_timer_SetRepeat(burstTimer, 0);
+	le_timer_SetHandler(burstTimer, burst_timer_handler);
+#endif
 
+	//! Share the fixes the position sensor gets, to avoid starting GNSS for every frame
+	dhubUtils_CreateOutput(FIX_MAX_AGE_PATH, DHUBIO_DATA_TYPE_NUMERIC, "s");
+	dhubIO_AddNumericPushHandler(FIX_MAX_AGE_PATH, fix_max_age_push_handler, NULL);
+	dhubIO_SetNumericDefault(FIX_MAX_AGE_PATH, DEFAULT_FIX_MAX_AGE);
+	dhubIO_MarkOptional(FIX_MAX_AGE_PATH);
+	dhubUtils_CreateOutput(FIX_MAX_ERROR_PATH, DHUBIO_DATA_TYPE_NUMERIC, "m");
+	dhubIO_AddNumericPushHandler(FIX_MAX_ERROR_PATH, fix_max_error_push_handler, NULL);
+	dhubIO_SetNumericDefault(FIX_MAX_ERROR_PATH, DEFAULT_FIX_MAX_ERROR);
+	dhubIO_MarkOptional(FIX_MAX_ERROR_PATH);
+
+	//! Start GNSS ahead of each satellite pass, so that the first TX is at its start
+	dhubUtils_CreateOutput(PREWARM_LEAD_PATH, DHUBIO_DATA_TYPE_NUMERIC, "s");
+	dhubIO_AddNumericPushHandler(PREWARM_LEAD_PATH, prewarm_lead_push_handler, NULL);
+	dhubIO_SetNumericDefault(PREWARM_LEAD_PATH, 0);
+	dhubIO_MarkOptional(PREWARM_LEAD_PATH);
+	dhubUtils_CreateInput(TIME_TO_FIX_PATH, DHUBIO_DATA_TYPE_NUMERIC, "s");
+	dhubUtils_CreateInput(PASS_USAGE_PATH, DHUBIO_DATA_TYPE_NUMERIC, "");
+
+	result = dhubAdmin_CreateObs(POS_OBS_PATH);
+	if (result != LE_OK)
+		LE_FATAL("Failed to create Data Hub observation at path '%s' (%s).",
+			POS_OBS_PATH, LE_RESULT_TXT(result));
+	dhubAdmin_AddJsonPushHandler(POS_OBS_PATH, position_push_handler, NULL);
+	dhubAdmin_SetSource(POS_OBS_PATH, POS_SENSOR_INPUT_PATH);
+
+	//! Dead-reckoned positions keep the cache fresh while the position
+	//! sensor (and GNSS) is off, e.g. while the device is parked. The
+	//! sensor is configured and enabled by the data publisher.
+	result = dhubAdmin_CreateObs(DR_OBS_PATH);
+	if (result != LE_OK)
+		LE_FATAL("Failed to create Data Hub observation at path '%s' (%s).",
+			DR_OBS_PATH, LE_RESULT_TXT(result));
+	dhubAdmin_AddJsonPushHandler(DR_OBS_PATH, position_push_handler, NULL);
+	dhubAdmin_SetSource(DR_OBS_PATH, DR_SENSOR_INPUT_PATH);
 
 	//! Initialise serial port wired to Kineis modem
 	printf("[DEBUG_LOG] Open /dev/ttyHS0 and set serial port parameters\n");
@@ -18,8 +18,8 @@
 #include <stdint.h>
 #include <string.h>
 #include <math.h>
-#include <errno.h>
-#include <unistd.h>
+#include "legato.h"
+#include "interfaces.h"
 #include "gpslib.h"
 
 
@@ -157,225 +157,259 @@ int gpsframe_parser(uint16_t day, uint8_t hour, uint8_t min,
 	return -1;
 }
 
-int gps_pos(float *latitude, float *longitude, float *altitude,
-	uint16_t *dat_year, uint8_t *dat_month, uint16_t *dat_day,
-	uint8_t *dat_hour, uint8_t *dat_min, uint8_t *dat_sec)
+//! Requests waiting for the acquisition in progress
+static struct {
+	gps_fix_handler_t handler;
+	void *context;
+	float max_error;
+} waiters[GPS_MAX_WAITERS];
+static unsigned int nb_waiters;
+
+//! Positioning service activation, held while an acquisition is in progress
+static le_posCtrl_ActivationRef_t activation;
+static le_timer_Ref_t poll_timer;
+static le_timer_Ref_t deadline_timer;
+
+//! Start of the acquisition in progress (relative time), and time to fix average (s)
+static le_clk_Time_t acquisition_start;
+static double ttf_average = NAN;
+
+//! Fix cache: last good fix, and when it was acquired (relative time)
+static struct gps_fix last_fix;
+static bool has_last_fix;
+static le_clk_Time_t last_fix_time;
+
+//! @brief  Check that a fix's accuracy is known and no worse than max_error (m)
+static bool is_accurate(const struct gps_fix *fix, float max_error)
 {
-	const char *gnss_start = "/legato/systems/current/bin/gnss start";
-	const char *get_posState = "/legato/systems/current/bin/gnss get posState";
-	const char *get_loc3d = "/legato/systems/current/bin/gnss get loc3d";
-	const char *get_time = "/legato/systems/current/bin/gnss get time";
-	const char *get_date = "/legato/systems/current/bin/gnss get date";
-	const char *check_gnssservice = "Success!\n";
-	const char *check_ifready = "The GNSS device is already started\n";
-	const char *fix_2d = "Position state: 2D Fix\n";
-	const char *fix_3d = "Position state: 3D Fix\n";
-	unsigned short fix2d = 0;
-	unsigned short fix3d = 0;
-	unsigned short timer = 1;
-	char line[128];
-	int line_number = 0;
-	char lat_header[32];
-	char lon_header[32];
-	char alt_header[32];
-	char dp[10];
-	char *date_ptr;
-	char year[5];
-	char month[3];
-	char day[3];
-	char hour[3];
-	char min[3];
-	char sec[3];
-	char time_header[32];
-	char time[32];
-	FILE *output;
-
-	/** Start gnss service */
-	output = popen(gnss_start, "r");
-	if (output == NULL)
-		fprintf(stderr, "Erreur popen %d\n", errno);
-
-	while (fgets(line, 127, output) != NULL) {
-		if (strcmp(line, check_gnssservice) == 0) {
-			printf("GPS service started\n");
-			pclose(output);
-			break;
-		} else if (strcmp(line, check_ifready) == 0) {
-			printf("GPS service already started\n");
-			pclose(output);
-			break;
-		}
+	return !isnan(fix->accuracy) && (fix->accuracy <= max_error);
+}
+
+//! @brief  Read a fix from the positioning service
+//! @retval 0 succeed ; 1 no fix yet
+static int read_fix(struct gps_fix *fix)
+{
+	le_result_t res;
+	int32_t lat, lon, h_acc, alt, v_acc;
+	uint16_t year, month, day, hour, min, sec, msec;
+
+	/** A 2D fix is enough for latitude and longitude */
+	res = le_pos_Get3DLocation(&lat, &lon, &h_acc, &alt, &v_acc);
+	if ((res != LE_OK) &&
+	    ((res != LE_OUT_OF_RANGE) || (lat == INT32_MAX) || (lon == INT32_MAX)))
+		return 1;
+
+	/** Date and time of the fix (UTC) */
+	if ((le_pos_GetDate(&year, &month, &day) != LE_OK) ||
+	    (le_pos_GetTime(&hour, &min, &sec, &msec) != LE_OK))
+		return 1;
+
+	fix->latitude = lat / 1000000.0f;
+	fix->longitude = lon / 1000000.0f;
+	/** Altitude is only known with a 3D fix */
+	fix->is_3d = (alt != INT32_MAX);
+	fix->altitude = fix->is_3d ? alt / 1000.0f : 0.0f;
+	fix->accuracy = (h_acc != INT32_MAX) ? (float)h_acc : NAN;
+	fix->year = year;
+	fix->month = month;
+	fix->day = day;
+	fix->hour = hour;
+	fix->min = min;
+	fix->sec = sec;
+	fix->age = 0.0f;
+
+	printf("year=%d; month=%d; day=%d; hour=%d; min=%d, sec=%d\n", fix->year,
+		fix->month, fix->day, fix->hour, fix->min, fix->sec);
+	printf("Latitude = %f, Longitude = %f, Altitude = %f, Accuracy = %f m\n",
+		fix->latitude, fix->longitude, fix->altitude, fix->accuracy);
+
+	return 0;
+}
+
+//! @brief  End the acquisition in progress and call the waiting handlers
+static void complete(enum gps_fix_status status)
+{
+	struct gps_fix fix;
+	unsigned int nb = nb_waiters;
+	unsigned int i;
+
+	if (activation != NULL) {
+		le_timer_Stop(poll_timer);
+		le_timer_Stop(deadline_timer);
+		le_posCtrl_Release(activation);
+		activation = NULL;
 	}
 
-	/** Get posState (no fix, 2D, 3D) */
-	do {
-		output = popen(get_posState, "r");
-		if (output == NULL)
-			fprintf(stderr, "Erreur popen %d\n", errno);
-		while (fgets(line, 127, output) != NULL) {
-			//printf("%s\n", line);
-			//printf("size of line %d\n", strlen(line));
-			if (strcmp(line, fix_2d) == 0) {
-				pclose(output);
-				fix2d = 1;
-				break;
-			} else if (strcmp(line, fix_3d) == 0) {
-				pclose(output);
-				fix3d = 1;
-				break;
-			}
+	if (status != GPS_FIX_NONE) {
+		le_clk_Time_t age = le_clk_Sub(le_clk_GetRelativeTime(), last_fix_time);
+
+		fix = last_fix;
+		fix.age = age.sec + age.usec / 1000000.0f;
+	}
+
+	/** Handlers may start a new acquisition */
+	nb_waiters = 0;
+	for (i = 0; i < nb; i++) {
+		/** The last good fix is only passed to the requests it is accurate enough for */
+		if ((status == GPS_FIX_LAST) && !is_accurate(&fix, waiters[i].max_error)) {
+			printf("Last good fix is too inaccurate (%.0f m)\n", fix.accuracy);
+			waiters[i].handler(GPS_FIX_NONE, NULL, waiters[i].context);
+		} else {
+			waiters[i].handler(status, (status == GPS_FIX_NONE) ? NULL : &fix,
+				waiters[i].context);
 		}
-		/** TTF */
-		sleep(TIMEOUT_PERIOD);
-		timer++;
+	}
+}
+
+//! @brief  Account for the time an acquisition took in the time to fix average
+static void update_time_to_fix(void)
+{
+	le_clk_Time_t elapsed = le_clk_Sub(le_clk_GetRelativeTime(), acquisition_start);
+	double ttf = elapsed.sec + elapsed.usec / 1000000.0;
+
+	if (isnan(ttf_average))
+		ttf_average = ttf;
+	else
+		ttf_average += GPS_TTF_WEIGHT * (ttf - ttf_average);
+}
+
+double gps_time_to_fix(void)
+{
+	return ttf_average;
+}
+
+static void poll_timer_handler(le_timer_Ref_t timer)
+{
+	if (activation == NULL)
+		return;
+
+	if (read_fix(&last_fix) == 0) {
+		update_time_to_fix();
+		has_last_fix = true;
+		last_fix_time = le_clk_GetRelativeTime();
+		complete(GPS_FIX_NEW);
+	}
+}
+
+static void poll_now(void *param1, void *param2)
+{
+	poll_timer_handler(poll_timer);
+}
+
+static void deliver_cached(void *param1, void *param2)
+{
+	complete(GPS_FIX_CACHED);
+}
+
+//! @brief  Get the age of the cached fix
+//! @retval age (s), or a negative value if the cache is empty
+static double cache_age(void)
+{
+	le_clk_Time_t age;
+
+	if (!has_last_fix)
+		return -1.0;
+
+	age = le_clk_Sub(le_clk_GetRelativeTime(), last_fix_time);
+	return age.sec + age.usec / 1000000.0;
+}
+
+void gps_cache_put(const struct gps_fix *fix, unsigned int max_age)
+{
+	le_clk_Time_t now = le_clk_GetRelativeTime();
+	le_clk_Time_t age = {
+		.sec = (time_t)fix->age,
+		.usec = (long)((fix->age - (time_t)fix->age) * 1000000),
+	};
+	double cached_age = cache_age();
+
+	if ((cached_age >= 0.0) && (cached_age < fix->age))
+		return;
 
-	} while (!fix2d && !fix3d && (timer <= TIMEOUT));
+	/** Keep a more accurate fix while it can still be used */
+	if ((cached_age >= 0.0) && (cached_age <= max_age) && !isnan(last_fix.accuracy) &&
+	    !(fix->accuracy <= last_fix.accuracy))
+		return;
 
-	/** force 3D to get altitude info */
-	/** Please check : "https://forum.mangoh.io/t/gnss-no-3d-fix-with-wp7702/1904/3" */
-	fix2d = 0;
-	fix3d = 1;
+	last_fix = *fix;
+	last_fix.age = 0.0f;
+	last_fix_time = le_clk_Sub(now, age);
+	has_last_fix = true;
+}
+
+static void deadline_timer_handler(le_timer_Ref_t timer)
+{
+	update_time_to_fix();
 
-	if (timer > TIMEOUT) {
+	if (has_last_fix) {
+		printf("timeout ... using last good fix\n");
+		complete(GPS_FIX_LAST);
+	} else {
 		printf("timeout ... (check gps antenna, etc ..)\n");
+		complete(GPS_FIX_NONE);
+	}
+}
+
+int gps_pos_async(unsigned int timeout, unsigned int max_age, float max_error,
+	gps_fix_handler_t handler, void *context)
+{
+	double cached_age;
+
+	if (nb_waiters >= GPS_MAX_WAITERS) {
+		printf("Too many GPS requests pending\n");
 		return 1;
-	} else if (fix3d) {
-		printf("Position state: 3D Fix\n");
-		/** Get day of month for gps frame */
-		output = popen(get_date, "r");
-		if (output == NULL) {
-			fprintf(stderr, "Erreur popen %d\n", errno);
-			return 1;
-		}
-		while (fgets(line, 127, output) != NULL) {
-			printf("%s\n", line);
-			/** looking for ")" in the returned string */
-			date_ptr = strstr(line, ")");
-			if (date_ptr != NULL) {
-				/** move date_ptr to point to "year" info */
-				date_ptr = date_ptr + 2;
-				/** copy the year */
-				strncpy(&year[0], date_ptr, 4);
-				year[4] = '\0';
-				//printf("Year = %s\n", year);
-				/** move date_ptr to point to "month" info */
-				date_ptr = date_ptr+5;
-				/** copy the month */
-				strncpy(&month[0], date_ptr, 2);
-				month[2] = '\0';
-				//printf("Month = %s\n", month);
-				/** move date_ptr to point to "day" info */
-				date_ptr = date_ptr+3;
-				/** copy the day */
-				strncpy(&day[0], date_ptr, 2);
-				day[2] = '\0';
-				//printf("Day of month = %s\n", day);
-			} else {
-				/* Close output stream before exit */
-				pclose(output);
-				return 1;
-			}
-		}
-		/* Close output steam */
-		if (output) {
-			pclose(output);
-			output = NULL;
-		}
+	}
 
-		/** Get time for gps frame */
-		output = popen(get_time, "r");
-		if (output == NULL) {
-			fprintf(stderr, "Erreur popen %d\n", errno);
-			return 1;
-		}
+	/** Join the acquisition in progress */
+	if (nb_waiters > 0) {
+		waiters[nb_waiters].handler = handler;
+		waiters[nb_waiters].context = context;
+		waiters[nb_waiters].max_error = max_error;
+		nb_waiters++;
+		return 0;
+	}
 
+	if (poll_timer == NULL) {
+		poll_timer = le_timer_Create("gpsPoll");
+		le_timer_SetMsInterval(poll_timer, TIMEOUT_PERIOD * 1000);
+		le_timer_SetRepeat(poll_timer, 0);
+		le_timer_SetHandler(poll_timer, poll_timer_handler);
 
-		while (fgets(line, 127, output) != NULL) {
-			//printf("returned time string = %s\n", line);
-			if (sscanf(line, "%s %s", time_header, time) != 2)
-				return 1;
-			//printf("time_header = %s\n", time_header);
-			//printf("time = %s\n", time);
-			strncpy(&hour[0], &time[0], 2);
-			/** Get hour info */
-			hour[2] = '\0';
-			//printf("hour = %s\n", hour);
-			/** Get min info */
-			strncpy(&min[0], &time[3], 2);
-			min[2] = '\0';
-			//printf("min = %s\n", min);
-			/** Get sec info */
-			strncpy(&sec[0], &time[6], 2);
-			sec[2] = '\0';
-			//printf("seconds = %s\n", sec);
-		}
+		deadline_timer = le_timer_Create("gpsDeadline");
+		le_timer_SetHandler(deadline_timer, deadline_timer_handler);
+	}
 
-		pclose(output);
-
-		/** convert string to int */
-		*dat_year = atoi(&year[0]);
-		*dat_month = atoi(&month[0]);
-		*dat_day = atoi(&day[0]);
-		*dat_hour = atoi(&hour[0]);
-		*dat_min = atoi(&min[0]);
-		*dat_sec = atoi(&sec[0]);
-		printf("year=%d; month=%d; day=%d; hour=%d; min=%d, sec=%d\n", *dat_year,
-			*dat_month, *dat_day, *dat_hour, *dat_min, *dat_sec);
-
-		/** Get location info */
-		output = popen(get_loc3d, "r");
-		if (output == NULL) {
-			fprintf(stderr, "Erreur popen %d\n", errno);
-			return 1;
-		}
+	waiters[0].handler = handler;
+	waiters[0].context = context;
+	waiters[0].max_error = max_error;
 
+	/** Reuse the cached fix rather than starting the receiver, unless it is known
+	 *  to be too inaccurate (e.g., a dead-reckoned position) */
+	cached_age = cache_age();
+	if ((cached_age >= 0.0) && (cached_age <= max_age) &&
+	    is_accurate(&last_fix, max_error)) {
+		printf("Using cached GPS fix, %.0f s old\n", cached_age);
+		nb_waiters = 1;
+		le_event_QueueFunction(deliver_cached, NULL, NULL);
+		return 0;
+	}
 
-		while (fgets(line, 127, output) != NULL) {
-			if (line_number == 0) {
-				if (sscanf(line, "%s %s %f", lat_header, dp, latitude) != 3)
-					return 1;
-				printf("Header = %s\n", lat_header);
-				printf("separator = %s\n", dp);
-				printf("Latitude = %f\n", *latitude);
-				/** check the sign for latitude */
-				if (strstr(lat_header, "positive") != NULL)
-					printf("Latitude positive -> North\n");
-				else {
-					printf("Latitude negative -> South\n");
-					*latitude = -(*latitude);
-				}
-			} else if (line_number == 1) {
-				if (sscanf(line, "%s %s %f", lon_header, dp, longitude) != 3)
-					return 1;
-				printf("Header = %s\n", lon_header);
-				printf("separator = %s\n", dp);
-				printf("Longitude = %f\n", *longitude);
-				/** check the sign for the longitude */
-				if (strstr(lon_header, "positive") != NULL)
-					printf("Longitude positive -> east\n");
-				else {
-					printf("Longitude negative -> west\n");
-					*longitude = -(*longitude);
-				}
-			} else if (line_number == 3) {
-				if (sscanf(line, "%s %s %f", alt_header, dp, altitude) != 3)
-					return 1;
-				printf("Header = %s\n", alt_header);
-				printf("separator = %s\n", dp);
-				printf("Altitude = %f\n", *altitude);
-			} else if (line_number > 4) {
-				break;
-			}
-			line_number++;
-		}
-		if (output) {
-			pclose(output);
-			output = NULL;
-		}
-	} else {
-		printf("Position state: no Fix\n");
+	/** Start gnss service (no-op if it is already running) */
+	activation = le_posCtrl_Request();
+	if (activation == NULL) {
+		printf("Cannot activate the positioning service\n");
 		return 1;
 	}
+	nb_waiters = 1;
+	acquisition_start = le_clk_GetRelativeTime();
+
+	le_timer_SetMsInterval(deadline_timer, timeout * 1000);
+	le_timer_Start(deadline_timer);
+	le_timer_Start(poll_timer);
+
+	/** The receiver may already have a fix */
+	le_event_QueueFunction(poll_now, NULL, NULL);
+
 	return 0;
 }
 
@@ -21,8 +21,47 @@
 /**
  * @brief  GPS parameters
  */
-#define TIMEOUT	60	// 60 * TIMEOUT_PERIOD (1s) = 60s
-#define TIMEOUT_PERIOD	1
+#define TIMEOUT	60	// default acquisition deadline (s)
+#define TIMEOUT_PERIOD	1	// positioning service polling period (s)
+#define GPS_MAX_WAITERS	4	// max requests waiting for the same acquisition
+#define GPS_TTF_WEIGHT	0.25	// weight of the latest acquisition in the time to fix average
+
+/**
+ * @brief  GPS fix
+ */
+struct gps_fix {
+	float latitude;		//!< degrees, positive north
+	float longitude;	//!< degrees, positive east
+	float altitude;		//!< metres (0 without a 3D fix)
+	float accuracy;		//!< horizontal accuracy (metres, NAN if unknown)
+	bool is_3d;		//!< true if the altitude is known
+	uint16_t year;		//!< UTC date and time of the fix
+	uint8_t month;
+	uint16_t day;
+	uint8_t hour;
+	uint8_t min;
+	uint8_t sec;
+	float age;		//!< time since the fix was acquired (s)
+};
+
+/**
+ * @brief  Outcome of a GPS acquisition
+ */
+enum gps_fix_status {
+	GPS_FIX_NEW,		//!< a fix was acquired
+	GPS_FIX_CACHED,		//!< the cached fix was recent enough, no acquisition was made
+	GPS_FIX_LAST,		//!< deadline reached, the last good fix is passed instead
+	GPS_FIX_NONE,		//!< deadline reached and no fix was ever acquired
+};
+
+/**
+ * @brief  GPS acquisition completion callback
+ * @param[in] status
+ * @param[in] fix NULL if status is GPS_FIX_NONE
+ * @param[in] context as passed to gps_pos_async()
+ */
+typedef void (*gps_fix_handler_t)(enum gps_fix_status status, const struct gps_fix *fix,
+	void *context);
 
 /**
  * @brief  Compute hexadecimal payload to send GPS data overs ARGOS
@@ -39,23 +78,44 @@ int gpsframe_parser(uint16_t day, uint8_t hour, uint8_t min,
 		float longitude, float lat, float alt, uint8_t *gpsframe);
 
 /**
- * @brief  Get gps coordinates function (MangOH red).
- *         This function uses the gnss tools
- *         https://docs.legato.io/17_08/toolsTarget_gnss.html
- * @param[out] latitude
- * @param[out] longitude
- * @param[out] altitude
- * @param[out] dat_year
- * @param[out] dat_month
- * @param[out] dat_day
- * @param[out] dat_hour
- * @param[out] dat_min
- * @param[out] dat_sec
- * @retval 0 succeed ; 1 fail
- */
-int gps_pos(float *latitude, float *longitude, float *altitude,
-	uint16_t *dat_year, uint8_t *dat_month, uint16_t *dat_day,
-	uint8_t *dat_hour, uint8_t *dat_min, uint8_t *dat_sec);
+ * @brief  Start a GPS acquisition (MangOH red) without blocking.
+ *         The last good fix is cached, whether it was acquired by this function or put in
+ *         the cache with gps_cache_put(). If it is no older than max_age, and its accuracy
+ *         is known to be no worse than max_error, it is passed to the handler
+ *         (GPS_FIX_CACHED) without starting the receiver. The same accuracy limit applies
+ *         to the last good fix passed when the deadline is reached (GPS_FIX_LAST).
+ *         Otherwise, this function uses the Legato positioning service (le_pos and le_posCtrl
+ *         APIs), activating it until the acquisition completes and polling it every
+ *         TIMEOUT_PERIOD seconds from the Legato event loop.
+ *         The handler is called from the event loop, once, when a fix is available or the
+ *         deadline is reached. A request made while an acquisition is in progress joins it,
+ *         and shares its deadline.
+ * @param[in] timeout deadline (s)
+ * @param[in] max_age oldest cached fix that can be used (s), 0 to always acquire a new one
+ * @param[in] max_error least accurate cached or last good fix that can be used (m)
+ * @param[in] handler completion callback
+ * @param[in] context passed to the handler
+ * @retval 0 succeed ; 1 fail (handler will not be called)
+ */
+int gps_pos_async(unsigned int timeout, unsigned int max_age, float max_error,
+	gps_fix_handler_t handler, void *context);
+
+/**
+ * @brief  Put a fix acquired elsewhere (e.g., by the position sensor) in the fix cache.
+ *         It is ignored if the cache holds a more recent fix, or a more accurate one that
+ *         is no older than max_age. A fix of unknown accuracy is less accurate than any.
+ * @param[in] fix position and UTC time, age is how long ago it was acquired (s)
+ * @param[in] max_age oldest cached fix that can still be used (s)
+ */
+void gps_cache_put(const struct gps_fix *fix, unsigned int max_age);
+
+/**
+ * @brief  Get the time to fix of recent acquisitions.
+ *         This is a moving average of the time gps_pos_async() took to get new fixes,
+ *         acquisitions that reached their deadline counting as their timeout.
+ * @retval time to fix (s), NAN if no acquisition was made yet
+ */
+double gps_time_to_fix(void);
 #endif // GPSLIB_H
 
 // -------------------------------------------------------------------------- //
@@ -17,9 +17,10 @@
  * register for notification when new data arrives at those observations.  This can be throttled
  * to reduce the rate of reporting by changing the filtering and buffering parameters on the
  * Data Hub observations.  The default values for the buffer sizes can be found below.  Look for
- * _BUFFER_COUNT.  In addition, observations that receive numerical values have default "change-by"
- * thresholds. Look for _CHANGE_BY.  We also configure the polling periods of the sensors to
- * prevent excessive data generation and battery consumption.  Look for constants ending in _PERIOD.
+ * _BUFFER_COUNT.  In addition, sensors that produce numerical or x/y/z values have default
+ * "change-by" deadbands, which they apply before their samples reach the Data Hub. Look for _CHANGE_BY.
+ * We also configure the polling periods of the sensors to prevent excessive data generation and
+ * battery consumption.  Look for constants ending in _PERIOD.
  *
  * When there's an AirVantage session available, we can immediately push data when it arrives
  * from the Data Hub.  But, if the AV session goes down, then we have to wait until the session
@@ -48,6 +49,7 @@
 #define PRESSURE_PERIOD 10
 #define TEMP_PERIOD 10
 #define POS_PERIOD 10
+#define DEAD_RECKONING_PERIOD 60 // only used by the Argos publisher
 
 // Buffer sizes (# of samples):
 #define ACCEL_BUFFER_COUNT 100
@@ -57,11 +59,25 @@
 #define TEMP_BUFFER_COUNT 100
 #define POS_BUFFER_COUNT 100
 
-// Change-by thresholds:
-#define LIGHT_CHANGE_BY 200
+// Adaptive polling (min period and max period in seconds, sensitivity in the sensor's units):
+#define PRESSURE_MIN_PERIOD 10
+#define PRESSURE_MAX_PERIOD 320
+#define PRESSURE_SENSITIVITY 0.05 // kPa
+#define TEMP_MIN_PERIOD 10
+#define TEMP_MAX_PERIOD 320
+#define TEMP_SENSITIVITY 0.1 // degC
+
+// Deadband thresholds, applied by the sensors themselves before their samples reach the Data Hub
+// (to each of x, y and z for the accelerometer and gyro):
+#define ACCEL_CHANGE_BY 0.1 // m/s2
+#define GYRO_CHANGE_BY 0.02 // rad/s
+#define LIGHT_CHANGE_BY 50 // the light sensor averages a burst of readings per sample
 #define PRESSURE_CHANGE_BY 1.0 // kPa
 #define TEMP_CHANGE_BY 2.0  // degC
 
+// Longest time (seconds) a sensor can stay silent because of its deadband:
+#define DEADBAND_MAX_SILENCE 3600
+
 // Data Hub Observation resource paths:
 #define ACCEL_OBS_PATH "/obs/accel"
 #define GYRO_OBS_PATH "/obs/gyro"
@@ -77,6 +93,7 @@
 #define POS_SENSOR_INPUT_PATH       "/app/redSensor/position/value"
 #define PRESSURE_SENSOR_INPUT_PATH  "/app/redSensor/pressure/value"
 #define TEMP_SENSOR_INPUT_PATH      "/app/redSensor/pressure/temp/value"
+#define DEAD_RECKONING_INPUT_PATH   "/app/redSensor/deadReckoning/value"
 
 
 //--------------------------------------------------------------------------------------------------
@@ -1083,13 +1100,14 @@ static void CreateObservation
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Configure and enable a sensor whose 'value' input is at a given path.
+ * Build the path of a resource that is a sibling of a sensor's 'value' input (e.g., "period").
  */
 //--------------------------------------------------------------------------------------------------
-static void ConfigureSensor
+static void BuildSiblingPath
 (
+    char* path,             ///< [OUT] Buffer of DHUBIO_MAX_RESOURCE_PATH_LEN + 1 bytes.
     const char* inputPath,
-    double period ///< seconds
+    const char* siblingName
 )
 {
     const char* lastSlashPtr = strrchr(inputPath, '/');
@@ -1098,23 +1116,85 @@ static void ConfigureSensor
         LE_FATAL("No '/' found in path '%s'.", inputPath);
     }
 
-    char path[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
-
     size_t basePathLen = (lastSlashPtr - inputPath) + 1; // +1 to include the slash.
 
     // Buffer size check.
-    LE_ASSERT((basePathLen + sizeof("period")) < DHUBIO_MAX_RESOURCE_PATH_LEN);
+    LE_ASSERT((basePathLen + strlen(siblingName)) < DHUBIO_MAX_RESOURCE_PATH_LEN);
 
-    // Set the period.
     (void)strncpy(path, inputPath, basePathLen);    // WARNING: May not be null-terminated.
-    (void)strcpy(path + basePathLen, "period");   // Guaranteed to null-terminate.
+    (void)strcpy(path + basePathLen, siblingName);  // Guaranteed to null-terminate.
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Configure and enable a sensor whose 'value' input is at a given path.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ConfigureSensor
+(
+    const char* inputPath,
+    double period ///< seconds
+)
+{
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+
+    // Set the period.
+    BuildSiblingPath(path, inputPath, "period");
     dhubAdmin_SetNumericDefault(path, period);
 
     // Enable the sensor.
-    (void)strcpy(path + basePathLen, "enable");   // Guaranteed to null-terminate.
+    BuildSiblingPath(path, inputPath, "enable");
     dhubAdmin_PushBoolean(path, 0.0, true);
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Configure the adaptive polling period of a sensor whose 'value' input is at a given path.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ConfigureAdaptivePeriod
+(
+    const char* inputPath,
+    double minPeriod,   ///< seconds
+    double maxPeriod,   ///< seconds
+    double sensitivity  ///< sensor units
+)
+{
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+
+    BuildSiblingPath(path, inputPath, "minPeriod");
+    dhubAdmin_SetNumericDefault(path, minPeriod);
+
+    BuildSiblingPath(path, inputPath, "maxPeriod");
+    dhubAdmin_SetNumericDefault(path, maxPeriod);
+
+    BuildSiblingPath(path, inputPath, "sensitivity");
+    dhubAdmin_SetNumericDefault(path, sensitivity);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Configure the deadband of a sensor whose 'value' input is at a given path.  Samples that don't
+ * change by at least changeBy are dropped by the sensor itself, so they never cross into the
+ * Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ConfigureDeadband
+(
+    const char* inputPath,
+    double changeBy,    ///< sensor units
+    double maxSilence   ///< seconds
+)
+{
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+
+    BuildSiblingPath(path, inputPath, "deadband/absolute");
+    dhubAdmin_SetNumericDefault(path, changeBy);
+
+    BuildSiblingPath(path, inputPath, "deadband/maxSilence");
+    dhubAdmin_SetNumericDefault(path, maxSilence);
+}
+
 //--------------------------------------------------------------------------------------------------
 COMPONENT_INIT
 {
@@ -1137,9 +1217,9 @@ COMPONENT_INIT
     CreateObservation(&Accelerometer, ACCEL_BUFFER_COUNT, 0.0);
     CreateObservation(&Gyroscope, GYRO_BUFFER_COUNT, 0.0);
     CreateObservation(&PositionSensor, POS_BUFFER_COUNT, 0.0);
-    CreateObservation(&LightSensor, LIGHT_BUFFER_COUNT, LIGHT_CHANGE_BY);
-    CreateObservation(&PressureSensor, PRESSURE_BUFFER_COUNT, PRESSURE_CHANGE_BY);
-    CreateObservation(&Thermometer, TEMP_BUFFER_COUNT, TEMP_CHANGE_BY);
+    CreateObservation(&LightSensor, LIGHT_BUFFER_COUNT, 0.0);
+    CreateObservation(&PressureSensor, PRESSURE_BUFFER_COUNT, 0.0);
+    CreateObservation(&Thermometer, TEMP_BUFFER_COUNT, 0.0);
 
     // Register for notification when the observations receive updates.
     dhubAdmin_AddJsonPushHandler(Accelerometer.obsPath, HandleJsonUpdate, &Accelerometer);
@@ -1156,6 +1236,20 @@ COMPONENT_INIT
     ConfigureSensor(PRESSURE_SENSOR_INPUT_PATH, PRESSURE_PERIOD);
     ConfigureSensor(TEMP_SENSOR_INPUT_PATH, TEMP_PERIOD);
     ConfigureSensor(LIGHT_SENSOR_INPUT_PATH, LIGHT_PERIOD);
+    ConfigureSensor(DEAD_RECKONING_INPUT_PATH, DEAD_RECKONING_PERIOD);
+    ConfigureAdaptivePeriod(PRESSURE_SENSOR_INPUT_PATH,
+                            PRESSURE_MIN_PERIOD,
+                            PRESSURE_MAX_PERIOD,
+                            PRESSURE_SENSITIVITY);
+    ConfigureAdaptivePeriod(TEMP_SENSOR_INPUT_PATH,
+                            TEMP_MIN_PERIOD,
+                            TEMP_MAX_PERIOD,
+                            TEMP_SENSITIVITY);
+    ConfigureDeadband(ACCEL_SENSOR_INPUT_PATH, ACCEL_CHANGE_BY, DEADBAND_MAX_SILENCE);
+    ConfigureDeadband(GYRO_SENSOR_INPUT_PATH, GYRO_CHANGE_BY, DEADBAND_MAX_SILENCE);
+    ConfigureDeadband(LIGHT_SENSOR_INPUT_PATH, LIGHT_CHANGE_BY, DEADBAND_MAX_SILENCE);
+    ConfigureDeadband(PRESSURE_SENSOR_INPUT_PATH, PRESSURE_CHANGE_BY, DEADBAND_MAX_SILENCE);
+    ConfigureDeadband(TEMP_SENSOR_INPUT_PATH, TEMP_CHANGE_BY, DEADBAND_MAX_SILENCE);
 
     // Connect the observations to the sensor inputs in the Data Hub.
     dhubAdmin_SetSource(Accelerometer.obsPath, ACCEL_SENSOR_INPUT_PATH);
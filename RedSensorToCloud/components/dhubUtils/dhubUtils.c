@@ -0,0 +1,72 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Implementation of the Data Hub utilities.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "dhubUtils.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create an input resource in the Data Hub.  A resource that already exists is reused (with a
+ * warning); any other failure is fatal.
+ */
+//--------------------------------------------------------------------------------------------------
+void dhubUtils_CreateInput
+(
+    const char* path,   ///< Resource path at which to create the input.
+    dhubIO_DataType_t dataType, ///< Data type of the resource.
+    const char* units   ///< Units string of the resource.
+)
+{
+    le_result_t result = dhubIO_CreateInput(path, dataType, units);
+    if (result != LE_OK)
+    {
+        if (result == LE_DUPLICATE)
+        {
+            LE_WARN("An input already existed in the Data Hub at path '%s'.", path);
+        }
+        else
+        {
+            LE_FATAL("Failed to create Data Hub input '%s' (%s).", path, LE_RESULT_TXT(result));
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create an output resource in the Data Hub.  A resource that already exists is reused (with a
+ * warning); any other failure is fatal.
+ */
+//--------------------------------------------------------------------------------------------------
+void dhubUtils_CreateOutput
+(
+    const char* path,   ///< Resource path at which to create the output.
+    dhubIO_DataType_t dataType, ///< Data type of the resource.
+    const char* units   ///< Units string of the resource.
+)
+{
+    le_result_t result = dhubIO_CreateOutput(path, dataType, units);
+    if (result != LE_OK)
+    {
+        if (result == LE_DUPLICATE)
+        {
+            LE_WARN("An output already existed in the Data Hub at path '%s'.", path);
+        }
+        else
+        {
+            LE_FATAL("Failed to create Data Hub output '%s' (%s).", path, LE_RESULT_TXT(result));
+        }
+    }
+}
+
+
+COMPONENT_INIT
+{
+}
@@ -0,0 +1,50 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file dhubUtils.h
+ *
+ * Helpers for creating Data Hub resources.  Used by the components that add settings and inputs
+ * of their own next to the ones created by the Periodic Sensor component.
+ *
+ * The executable's .adef needs a binding like
+ *
+ * @verbatim
+    myExe.dhubUtils.dhubIO -> dataHub.io
+@endverbatim
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef DHUB_UTILS_H_INCLUDE_GUARD
+#define DHUB_UTILS_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create an input resource in the Data Hub.  A resource that already exists is reused (with a
+ * warning); any other failure is fatal.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void dhubUtils_CreateInput
+(
+    const char* path,   ///< Resource path at which to create the input.
+    dhubIO_DataType_t dataType, ///< Data type of the resource.
+    const char* units   ///< Units string of the resource.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create an output resource in the Data Hub.  A resource that already exists is reused (with a
+ * warning); any other failure is fatal.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void dhubUtils_CreateOutput
+(
+    const char* path,   ///< Resource path at which to create the output.
+    dhubIO_DataType_t dataType, ///< Data type of the resource.
+    const char* units   ///< Units string of the resource.
+);
+
+
+#endif // DHUB_UTILS_H_INCLUDE_GUARD
@@ -2,7 +2,7 @@
 /**
  * @file fileUtils.c
  *
- * Utility functions used to read numbers from sysfs files.
+ * Utility functions used to read and write sysfs files.
  *
  * Copyright (C) Sierra Wireless Inc.
  */
@@ -11,6 +11,435 @@
 #include "legato.h"
 #include "fileUtils.h"
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the buffer a sysfs attribute is read into.  Numeric attributes are much shorter.
+ */
+//--------------------------------------------------------------------------------------------------
+#define READ_BUFFER_BYTES 64
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * An open sysfs attribute.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct file_Handle
+{
+    int fd;                             ///< File descriptor, or -1 if not open.
+    char path[LIMIT_MAX_PATH_BYTES];
+    double maxAge;                      ///< Seconds a cached read stays valid (0 = no caching).
+    bool isCacheValid;                  ///< true if cache holds the file's contents.
+    le_clk_Time_t cacheTime;            ///< Relative time at which cache was read.
+    char cache[READ_BUFFER_BYTES];      ///< Contents of the file as of cacheTime.
+}
+Handle_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool from which Handle_t objects are allocated.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t HandlePool = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Skip over white space.
+ *
+ * @return Pointer to the first character that isn't white space.
+ */
+//--------------------------------------------------------------------------------------------------
+static const char* SkipSpace
+(
+    const char* cursor
+)
+{
+    while ((*cursor == ' ') || (*cursor == '\t') || (*cursor == '\n') || (*cursor == '\r'))
+    {
+        cursor++;
+    }
+
+    return cursor;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a signed decimal integer.  Unlike strtol() and scanf(), this never looks at the locale.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if the text isn't a decimal integer (surrounded by optional white space)
+ *    or is out of range.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseInt
+(
+    const char* text,
+    int* valuePtr
+)
+{
+    const char* cursor = SkipSpace(text);
+    bool isNegative = false;
+    int64_t value = 0;
+
+    if ((*cursor == '-') || (*cursor == '+'))
+    {
+        isNegative = (*cursor == '-');
+        cursor++;
+    }
+
+    const char* digitsPtr = cursor;
+    while ((*cursor >= '0') && (*cursor <= '9'))
+    {
+        value = (value * 10) + (*cursor - '0');
+        if (value > ((int64_t)INT_MAX + 1))
+        {
+            return LE_FORMAT_ERROR;
+        }
+        cursor++;
+    }
+
+    if ((cursor == digitsPtr) || (*SkipSpace(cursor) != '\0'))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    if (isNegative)
+    {
+        value = -value;
+    }
+    else if (value > INT_MAX)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    *valuePtr = (int)value;
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a decimal floating point number (e.g., "-12", "0.000598550" or "1.5e-3").  Unlike
+ * strtod() and scanf(), this never looks at the locale, so the decimal point is always '.'.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if the text isn't a number (surrounded by optional white space).
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseDouble
+(
+    const char* text,
+    double* valuePtr
+)
+{
+    const char* cursor = SkipSpace(text);
+    bool isNegative = false;
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    size_t digitCount = 0;
+
+    if ((*cursor == '-') || (*cursor == '+'))
+    {
+        isNegative = (*cursor == '-');
+        cursor++;
+    }
+
+    // Integer part.  Digits that don't fit in the mantissa only scale it.
+    while ((*cursor >= '0') && (*cursor <= '9'))
+    {
+        if (mantissa < (UINT64_MAX / 10))
+        {
+            mantissa = (mantissa * 10) + (uint64_t)(*cursor - '0');
+        }
+        else
+        {
+            exponent++;
+        }
+        digitCount++;
+        cursor++;
+    }
+
+    // Fraction part.  Digits that don't fit in the mantissa are dropped.
+    if (*cursor == '.')
+    {
+        cursor++;
+        while ((*cursor >= '0') && (*cursor <= '9'))
+        {
+            if (mantissa < (UINT64_MAX / 10))
+            {
+                mantissa = (mantissa * 10) + (uint64_t)(*cursor - '0');
+                exponent--;
+            }
+            digitCount++;
+            cursor++;
+        }
+    }
+
+    if (digitCount == 0)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    // Exponent part.
+    if ((*cursor == 'e') || (*cursor == 'E'))
+    {
+        int explicitExponent;
+        const char* expStartPtr = cursor + 1;
+        bool isExpNegative = false;
+
+        cursor = expStartPtr;
+        if ((*cursor == '-') || (*cursor == '+'))
+        {
+            isExpNegative = (*cursor == '-');
+            cursor++;
+        }
+
+        const char* expDigitsPtr = cursor;
+        explicitExponent = 0;
+        while ((*cursor >= '0') && (*cursor <= '9'))
+        {
+            if (explicitExponent < 10000)
+            {
+                explicitExponent = (explicitExponent * 10) + (*cursor - '0');
+            }
+            cursor++;
+        }
+
+        if (cursor == expDigitsPtr)
+        {
+            return LE_FORMAT_ERROR;
+        }
+
+        exponent += isExpNegative ? -explicitExponent : explicitExponent;
+    }
+
+    if (*SkipSpace(cursor) != '\0')
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    // Dividing by a power of ten (rather than multiplying by its inverse) keeps typical sysfs
+    // fractions exact to the last bit.
+    double value = (double)mantissa;
+    if (exponent < 0)
+    {
+        value /= pow(10.0, -exponent);
+    }
+    else if (exponent > 0)
+    {
+        value *= pow(10.0, exponent);
+    }
+
+    *valuePtr = isNegative ? -value : value;
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the whole contents of a file (from offset 0) into a null-terminated buffer.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be read.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadText
+(
+    int fd,
+    const char* filePath,   ///< For error messages.
+    char* buffer,
+    size_t bufferSize
+)
+{
+    ssize_t len;
+
+    do
+    {
+        len = pread(fd, buffer, bufferSize - 1, 0);
+    }
+    while ((len < 0) && (errno == EINTR));
+
+    if (len < 0)
+    {
+        int savedErrno = errno;   // Callers check errno to see whether to reopen the file.
+        LE_WARN("Couldn't read '%s' - %m", filePath);
+        errno = savedErrno;
+        return LE_IO_ERROR;
+    }
+
+    buffer[len] = '\0';
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a file for reading.
+ *
+ * @return The file descriptor, or -1 on failure.
+ */
+//--------------------------------------------------------------------------------------------------
+static int OpenFile
+(
+    const char* filePath
+)
+{
+    int fd;
+
+    do
+    {
+        fd = open(filePath, O_RDONLY | O_CLOEXEC);
+    }
+    while ((fd < 0) && (errno == EINTR));
+
+    if (fd < 0)
+    {
+        LE_WARN("Couldn't open '%s' - %m", filePath);
+    }
+
+    return fd;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the whole contents of a file once (open, read, close).
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadFileOnce
+(
+    const char* filePath,
+    char* buffer,
+    size_t bufferSize
+)
+{
+    int fd = OpenFile(filePath);
+    if (fd < 0)
+    {
+        return LE_IO_ERROR;
+    }
+
+    le_result_t r = ReadText(fd, filePath, buffer, bufferSize);
+
+    close(fd);
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the whole contents of an open sysfs attribute.  If the attribute's file descriptor has gone
+ * stale (e.g., because the device was unbound and re-bound), it is reopened and read again.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadAttribute
+(
+    Handle_t* handlePtr,
+    char* buffer,
+    size_t bufferSize
+)
+{
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        if (handlePtr->fd < 0)
+        {
+            handlePtr->fd = OpenFile(handlePtr->path);
+            if (handlePtr->fd < 0)
+            {
+                return LE_IO_ERROR;
+            }
+        }
+
+        if (ReadText(handlePtr->fd, handlePtr->path, buffer, bufferSize) == LE_OK)
+        {
+            return LE_OK;
+        }
+
+        bool isStale = (errno == ENODEV) || (errno == ESTALE) || (errno == EBADF);
+
+        // Drop the descriptor, so the next read (or the retry) opens the file afresh.
+        close(handlePtr->fd);
+        handlePtr->fd = -1;
+
+        if (!isStale)
+        {
+            break;
+        }
+    }
+
+    return LE_IO_ERROR;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the contents of a sysfs attribute opened using file_Open() or file_OpenCached().  A cached
+ * attribute is only read from the file if it has never been read, if it has been invalidated, or
+ * if its contents are older than its maximum age.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadHandle
+(
+    Handle_t* handlePtr,
+    char* buffer,
+    size_t bufferSize
+)
+{
+    if (handlePtr->maxAge <= 0.0)
+    {
+        return ReadAttribute(handlePtr, buffer, bufferSize);
+    }
+
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    if (handlePtr->isCacheValid)
+    {
+        le_clk_Time_t age = le_clk_Sub(now, handlePtr->cacheTime);
+
+        if (((double)age.sec + ((double)age.usec / 1000000.0)) >= handlePtr->maxAge)
+        {
+            handlePtr->isCacheValid = false;
+        }
+    }
+
+    if (!handlePtr->isCacheValid)
+    {
+        if (ReadAttribute(handlePtr, handlePtr->cache, sizeof(handlePtr->cache)) != LE_OK)
+        {
+            return LE_IO_ERROR;
+        }
+
+        handlePtr->isCacheValid = true;
+        handlePtr->cacheTime = now;
+    }
+
+    if (le_utf8_Copy(buffer, handlePtr->cache, bufferSize, NULL) != LE_OK)
+    {
+        return LE_IO_ERROR;
+    }
+
+    return LE_OK;
+}
+
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Read a signed integer from a sysfs file (convert the string contents to a number).
@@ -27,23 +456,14 @@ le_result_t file_ReadInt
     int *value
 )
 {
-    le_result_t r = LE_OK;
-    FILE *f = fopen(filePath, "r");
-    if (f == NULL)
-    {
-        LE_WARN("Couldn't open '%s' - %m", filePath);
-        r = LE_IO_ERROR;
-        goto done;
-    }
+    char buffer[READ_BUFFER_BYTES];
 
-    int numScanned = fscanf(f, "%d", value);
-    if (numScanned != 1)
+    le_result_t r = ReadFileOnce(filePath, buffer, sizeof(buffer));
+    if (r == LE_OK)
     {
-        r = LE_FORMAT_ERROR;
+        r = ParseInt(buffer, value);
     }
 
-    fclose(f);
-done:
     return r;
 }
 
@@ -64,27 +484,244 @@ le_result_t file_ReadDouble
     double *value
 )
 {
+    char buffer[READ_BUFFER_BYTES];
+
+    le_result_t r = ReadFileOnce(filePath, buffer, sizeof(buffer));
+    if (r == LE_OK)
+    {
+        r = ParseDouble(buffer, value);
+    }
+
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the contents of a sysfs file as a string, without the trailing newline.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t file_ReadString
+(
+    const char *filePath,
+    char *buffer,       ///< [OUT] Where the null-terminated contents will be put.
+    size_t bufferSize
+)
+{
+    le_result_t r = ReadFileOnce(filePath, buffer, bufferSize);
+    if (r == LE_OK)
+    {
+        buffer[strcspn(buffer, "\n")] = '\0';
+    }
+
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a string to a sysfs file (e.g., to enable or configure a device).
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or written.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t file_WriteString
+(
+    const char *filePath,
+    const char *value
+)
+{
+    int fd;
+
+    do
+    {
+        fd = open(filePath, O_WRONLY | O_CLOEXEC);
+    }
+    while ((fd < 0) && (errno == EINTR));
+
+    if (fd < 0)
+    {
+        LE_WARN("Couldn't open '%s' for writing - %m", filePath);
+        return LE_IO_ERROR;
+    }
+
     le_result_t r = LE_OK;
-    FILE *f = fopen(filePath, "r");
-    if (f == NULL)
+    size_t len = strlen(value);
+    ssize_t written;
+
+    do
     {
-        LE_WARN("Couldn't open '%s' - %m", filePath);
+        written = write(fd, value, len);
+    }
+    while ((written < 0) && (errno == EINTR));
+
+    if (written != (ssize_t)len)
+    {
+        LE_WARN("Couldn't write '%s' to '%s' - %m", value, filePath);
         r = LE_IO_ERROR;
-        goto done;
     }
 
-    int numScanned = fscanf(f, "%lf", value);
-    if (numScanned != 1)
+    close(fd);
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a sysfs file to be read repeatedly.  The file stays open until file_Close() is called, so
+ * each read costs a single pread() system call.
+ *
+ * If the file can't be opened now, opening is retried on each read.
+ *
+ * @return Reference to the file handle.
+ */
+//--------------------------------------------------------------------------------------------------
+file_Ref_t file_Open
+(
+    const char *filePath
+)
+{
+    Handle_t* handlePtr = le_mem_ForceAlloc(HandlePool);
+
+    if (le_utf8_Copy(handlePtr->path, filePath, sizeof(handlePtr->path), NULL) != LE_OK)
+    {
+        LE_FATAL("File path too long (%s)", filePath);
+    }
+
+    handlePtr->fd = OpenFile(filePath);
+    handlePtr->maxAge = 0.0;
+    handlePtr->isCacheValid = false;
+
+    return handlePtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a sysfs attribute whose value rarely changes (e.g., an IIO scale or offset) and cache it.
+ *
+ * Reads from the handle return the cached value without any system call.  The file is read again
+ * when the cached value is more than maxAge seconds old, or after file_Invalidate() is called.
+ * Most sysfs attributes don't report changes (they never signal inotify or poll), so this age
+ * limit bounds how long a change can go unnoticed.
+ *
+ * @return Reference to the file handle.
+ */
+//--------------------------------------------------------------------------------------------------
+file_Ref_t file_OpenCached
+(
+    const char *filePath,
+    double maxAge   ///< Seconds (must be > 0).
+)
+{
+    LE_ASSERT(maxAge > 0.0);
+
+    Handle_t* handlePtr = file_Open(filePath);
+    handlePtr->maxAge = maxAge;
+
+    return handlePtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Discard the cached value of a sysfs attribute opened using file_OpenCached(), so that the next
+ * read gets it from the file.  Call this after doing anything that changes the attribute (e.g.,
+ * changing the sensor's range).
+ */
+//--------------------------------------------------------------------------------------------------
+void file_Invalidate
+(
+    file_Ref_t file
+)
+{
+    file->isCacheValid = false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close a sysfs file opened using file_Open() or file_OpenCached().
+ */
+//--------------------------------------------------------------------------------------------------
+void file_Close
+(
+    file_Ref_t file
+)
+{
+    if (file->fd >= 0)
+    {
+        close(file->fd);
+    }
+
+    le_mem_Release(file);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a signed integer from a sysfs file opened using file_Open() or file_OpenCached().
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ *  - LE_FORMAT_ERROR if the file contents could not be converted into a signed integer.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t file_ReadIntFrom
+(
+    file_Ref_t file,
+    int *value
+)
+{
+    char buffer[READ_BUFFER_BYTES];
+
+    le_result_t r = ReadHandle(file, buffer, sizeof(buffer));
+    if (r == LE_OK)
+    {
+        r = ParseInt(buffer, value);
+    }
+
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a floating point number from a sysfs file opened using file_Open() or
+ * file_OpenCached().
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ *  - LE_FORMAT_ERROR if the file contents could not be converted into a number.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t file_ReadDoubleFrom
+(
+    file_Ref_t file,
+    double *value
+)
+{
+    char buffer[READ_BUFFER_BYTES];
+
+    le_result_t r = ReadHandle(file, buffer, sizeof(buffer));
+    if (r == LE_OK)
     {
-        r = LE_FORMAT_ERROR;
+        r = ParseDouble(buffer, value);
     }
 
-    fclose(f);
-done:
     return r;
 }
 
 
 COMPONENT_INIT
 {
+    HandlePool = le_mem_CreatePool("fileHandle", sizeof(Handle_t));
 }
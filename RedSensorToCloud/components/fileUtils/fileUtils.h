@@ -2,7 +2,7 @@
 /**
  * @file fileUtils.h
  *
- * Utility functions used to read numbers from sysfs files.
+ * Utility functions used to read and write sysfs files.
  *
  * Copyright (C) Sierra Wireless Inc.
  */
@@ -46,4 +46,136 @@ LE_SHARED le_result_t file_ReadDouble
 );
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the contents of a sysfs file as a string, without the trailing newline.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t file_ReadString
+(
+    const char *filePath,
+    char *buffer,       ///< [OUT] Where the null-terminated contents will be put.
+    size_t bufferSize
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a string to a sysfs file (e.g., to enable or configure a device).
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or written.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t file_WriteString
+(
+    const char *filePath,
+    const char *value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a sysfs file that is kept open to be read repeatedly.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct file_Handle* file_Ref_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a sysfs file to be read repeatedly.  The file stays open until file_Close() is called, so
+ * each read costs a single pread() system call.
+ *
+ * If the file can't be opened now, opening is retried on each read.
+ *
+ * @return Reference to the file handle.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED file_Ref_t file_Open
+(
+    const char *filePath
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a sysfs attribute whose value rarely changes (e.g., an IIO scale or offset) and cache it.
+ *
+ * Reads from the handle return the cached value without any system call.  The file is read again
+ * when the cached value is more than maxAge seconds old, or after file_Invalidate() is called.
+ *
+ * @return Reference to the file handle.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED file_Ref_t file_OpenCached
+(
+    const char *filePath,
+    double maxAge   ///< Seconds (must be > 0).
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Discard the cached value of a sysfs attribute opened using file_OpenCached(), so that the next
+ * read gets it from the file.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void file_Invalidate
+(
+    file_Ref_t file
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close a sysfs file opened using file_Open() or file_OpenCached().
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void file_Close
+(
+    file_Ref_t file
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a signed integer from a sysfs file opened using file_Open() or file_OpenCached().  If the
+ * file has gone stale (ENODEV or ESTALE), it is reopened and read again.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ *  - LE_FORMAT_ERROR if the file contents could not be converted into a signed integer.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t file_ReadIntFrom
+(
+    file_Ref_t file,
+    int *value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a floating point number from a sysfs file opened using file_Open() or file_OpenCached().
+ * If the file has gone stale (ENODEV or ESTALE), it is reopened and read again.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ *  - LE_FORMAT_ERROR if the file contents could not be converted into a number.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t file_ReadDoubleFrom
+(
+    file_Ref_t file,
+    double *value
+);
+
+
 #endif // FILE_UTILS_H_INCLUDE_GUARD
@@ -0,0 +1,838 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file fences.c
+ *
+ * Geofence set, spatial index and evaluation.
+ *
+ * Fences are circles (centre and radius) or simple polygons (lat/lon vertices).  To keep
+ * evaluation cheap with thousands of fences, they are indexed in a uniform grid of CELL_SIZE
+ * degree cells: each fence is listed under every cell its bounding box touches, and a position is
+ * only tested against the fences listed under its own cell.  The index is a single array of
+ * (cell, fence) entries sorted by cell, so a lookup is one binary search.  Fences too big to list
+ * cell by cell are kept aside and tested every time.
+ *
+ * Polygons that cross the antimeridian aren't supported.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+
+#include "fences.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Grid cell size (degrees).  About 1 km north-south.
+ */
+//--------------------------------------------------------------------------------------------------
+#define CELL_SIZE 0.01
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fences whose bounding box touches more cells than this aren't listed in the grid, but are
+ * tested against every position instead.
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_CELLS_PER_FENCE 1024
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mean Earth radius (m).
+ */
+//--------------------------------------------------------------------------------------------------
+#define EARTH_RADIUS 6371008.8
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Metres per degree of latitude.
+ */
+//--------------------------------------------------------------------------------------------------
+#define METRES_PER_DEGREE (EARTH_RADIUS * M_PI / 180.0)
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A fence.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    char id[FENCES_MAX_ID_BYTES];
+    enum
+    {
+        FENCE_CIRCLE,
+        FENCE_POLYGON,
+    }
+    type;
+    double minLat, maxLat, minLon, maxLon;  ///< Bounding box (degrees).
+    double lat, lon, radius;                ///< Circle centre (degrees) and radius (m).
+    size_t firstVertex, vertexCount;        ///< Polygon vertices.
+}
+Fence_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A polygon vertex (degrees).
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    double lat;
+    double lon;
+}
+Vertex_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A grid index entry: a fence listed under a cell.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t cell;
+    uint32_t fence;
+}
+IndexEntry_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A set of fences and its index.  All the arrays are heap-allocated.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    Fence_t* fences;
+    size_t fenceCount;
+    size_t fenceCapacity;
+    Vertex_t* vertices;
+    size_t vertexCount;
+    size_t vertexCapacity;
+    IndexEntry_t* index;    ///< Sorted by cell.
+    size_t indexCount;
+    size_t indexCapacity;
+    uint32_t* large;        ///< Fences that aren't in the index.
+    size_t largeCount;
+    size_t largeCapacity;
+}
+FenceSet_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The current set, and the evaluation state for each of its fences.  A fence is in the inside
+ * list if it contained the last position evaluated.  Stamp[i] is EvalCount if fence i contains
+ * the position being evaluated.
+ */
+//--------------------------------------------------------------------------------------------------
+static FenceSet_t Set;
+static bool* IsInside = NULL;
+static uint32_t* Stamp = NULL;
+static uint32_t* InsideList = NULL;
+static size_t InsideCount = 0;
+static uint32_t* NewInsideList = NULL;
+static uint32_t EvalCount = 0;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Make sure a heap array has room for a given number of elements, growing it if needed.
+ *
+ * @return true if successful, false if out of memory.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool Reserve
+(
+    void** arrayPtrPtr,
+    size_t* capacityPtr,
+    size_t needed,
+    size_t elementSize
+)
+{
+    if (needed <= *capacityPtr)
+    {
+        return true;
+    }
+
+    size_t capacity = (*capacityPtr > 0) ? *capacityPtr : 64;
+    while (capacity < needed)
+    {
+        capacity *= 2;
+    }
+
+    void* arrayPtr = realloc(*arrayPtrPtr, capacity * elementSize);
+    if (arrayPtr == NULL)
+    {
+        return false;
+    }
+
+    *arrayPtrPtr = arrayPtr;
+    *capacityPtr = capacity;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Free a fence set's arrays.
+ */
+//--------------------------------------------------------------------------------------------------
+static void FreeSet
+(
+    FenceSet_t* setPtr
+)
+{
+    free(setPtr->fences);
+    free(setPtr->vertices);
+    free(setPtr->index);
+    free(setPtr->large);
+    memset(setPtr, 0, sizeof(*setPtr));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Copy a fence set's fences and vertices (not its index) into an empty set.
+ *
+ * @return true if successful, false if out of memory.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool CopyFences
+(
+    FenceSet_t* destPtr,
+    const FenceSet_t* srcPtr
+)
+{
+    if (   !Reserve((void**)&destPtr->fences,
+                    &destPtr->fenceCapacity,
+                    srcPtr->fenceCount,
+                    sizeof(Fence_t))
+        || !Reserve((void**)&destPtr->vertices,
+                    &destPtr->vertexCapacity,
+                    srcPtr->vertexCount,
+                    sizeof(Vertex_t)))
+    {
+        return false;
+    }
+
+    if (srcPtr->fenceCount > 0)
+    {
+        memcpy(destPtr->fences, srcPtr->fences, srcPtr->fenceCount * sizeof(Fence_t));
+    }
+    if (srcPtr->vertexCount > 0)
+    {
+        memcpy(destPtr->vertices, srcPtr->vertices, srcPtr->vertexCount * sizeof(Vertex_t));
+    }
+    destPtr->fenceCount = srcPtr->fenceCount;
+    destPtr->vertexCount = srcPtr->vertexCount;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a fence by ID, skipping fences already marked as inside (IDs needn't be unique).
+ *
+ * @return The fence's index, or the set's fence count if not found.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t FindFence
+(
+    const FenceSet_t* setPtr,
+    const char* id,
+    const bool* isInside
+)
+{
+    size_t i;
+
+    for (i = 0; i < setPtr->fenceCount; i++)
+    {
+        if (!isInside[i] && (strcmp(setPtr->fences[i].id, id) == 0))
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a number token.
+ *
+ * @return true if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool ParseNumber
+(
+    const char* token,
+    double* valuePtr
+)
+{
+    if (token == NULL)
+    {
+        return false;
+    }
+
+    char* endPtr;
+    *valuePtr = strtod(token, &endPtr);
+
+    return ((endPtr != token) && (*endPtr == '\0') && isfinite(*valuePtr));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse one fence definition (already split at the first token) and add it to a set.
+ *
+ * @return LE_OK, LE_FORMAT_ERROR or LE_NO_MEMORY.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseFence
+(
+    FenceSet_t* setPtr,
+    const char* type,
+    char** savePtrPtr   ///< strtok_r() state for the rest of the line.
+)
+{
+    static const char delimiters[] = " \t,\r";
+
+    if (!Reserve((void**)&setPtr->fences,
+                 &setPtr->fenceCapacity,
+                 setPtr->fenceCount + 1,
+                 sizeof(Fence_t)))
+    {
+        return LE_NO_MEMORY;
+    }
+
+    Fence_t* fencePtr = &setPtr->fences[setPtr->fenceCount];
+    memset(fencePtr, 0, sizeof(*fencePtr));
+
+    const char* id = strtok_r(NULL, delimiters, savePtrPtr);
+    if ((id == NULL) || (le_utf8_Copy(fencePtr->id, id, sizeof(fencePtr->id), NULL) != LE_OK))
+    {
+        LE_ERROR("Missing or over-long fence ID.");
+        return LE_FORMAT_ERROR;
+    }
+
+    if (strcmp(type, "circle") == 0)
+    {
+        fencePtr->type = FENCE_CIRCLE;
+
+        if (   !ParseNumber(strtok_r(NULL, delimiters, savePtrPtr), &fencePtr->lat)
+            || !ParseNumber(strtok_r(NULL, delimiters, savePtrPtr), &fencePtr->lon)
+            || !ParseNumber(strtok_r(NULL, delimiters, savePtrPtr), &fencePtr->radius)
+            || (strtok_r(NULL, delimiters, savePtrPtr) != NULL)
+            || (fabs(fencePtr->lat) > 90.0)
+            || (fabs(fencePtr->lon) > 180.0)
+            || !(fencePtr->radius > 0.0))
+        {
+            LE_ERROR("Bad circle fence '%s'.", fencePtr->id);
+            return LE_FORMAT_ERROR;
+        }
+
+        double dLat = fencePtr->radius / METRES_PER_DEGREE;
+        double dLon = dLat / fmax(cos(fencePtr->lat * M_PI / 180.0), 0.01);
+
+        fencePtr->minLat = fencePtr->lat - dLat;
+        fencePtr->maxLat = fencePtr->lat + dLat;
+        fencePtr->minLon = fencePtr->lon - dLon;
+        fencePtr->maxLon = fencePtr->lon + dLon;
+    }
+    else if (strcmp(type, "polygon") == 0)
+    {
+        fencePtr->type = FENCE_POLYGON;
+        fencePtr->firstVertex = setPtr->vertexCount;
+        fencePtr->minLat = fencePtr->minLon = INFINITY;
+        fencePtr->maxLat = fencePtr->maxLon = -INFINITY;
+
+        const char* token;
+        while ((token = strtok_r(NULL, delimiters, savePtrPtr)) != NULL)
+        {
+            Vertex_t vertex;
+
+            if (   !ParseNumber(token, &vertex.lat)
+                || !ParseNumber(strtok_r(NULL, delimiters, savePtrPtr), &vertex.lon)
+                || (fabs(vertex.lat) > 90.0)
+                || (fabs(vertex.lon) > 180.0))
+            {
+                LE_ERROR("Bad vertex in polygon fence '%s'.", fencePtr->id);
+                return LE_FORMAT_ERROR;
+            }
+
+            if (!Reserve((void**)&setPtr->vertices,
+                         &setPtr->vertexCapacity,
+                         setPtr->vertexCount + 1,
+                         sizeof(Vertex_t)))
+            {
+                return LE_NO_MEMORY;
+            }
+            setPtr->vertices[setPtr->vertexCount++] = vertex;
+
+            fencePtr->minLat = fmin(fencePtr->minLat, vertex.lat);
+            fencePtr->maxLat = fmax(fencePtr->maxLat, vertex.lat);
+            fencePtr->minLon = fmin(fencePtr->minLon, vertex.lon);
+            fencePtr->maxLon = fmax(fencePtr->maxLon, vertex.lon);
+        }
+
+        fencePtr->vertexCount = setPtr->vertexCount - fencePtr->firstVertex;
+        if (fencePtr->vertexCount < 3)
+        {
+            LE_ERROR("Polygon fence '%s' has fewer than 3 vertices.", fencePtr->id);
+            return LE_FORMAT_ERROR;
+        }
+    }
+    else
+    {
+        LE_ERROR("Unknown fence type '%s'.", type);
+        return LE_FORMAT_ERROR;
+    }
+
+    setPtr->fenceCount++;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse fence definitions and add them to a set.
+ *
+ * @return LE_OK, LE_FORMAT_ERROR or LE_NO_MEMORY.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseFences
+(
+    FenceSet_t* setPtr,
+    const char* text
+)
+{
+    char* copy = strdup(text);
+    if (copy == NULL)
+    {
+        return LE_NO_MEMORY;
+    }
+
+    le_result_t result = LE_OK;
+    size_t lineNumber = 0;
+    char* nextPtr = copy;
+
+    // strsep() rather than strtok_r(), so that blank lines are counted too.
+    while ((nextPtr != NULL) && (result == LE_OK))
+    {
+        char* line = strsep(&nextPtr, "\n");
+        lineNumber++;
+
+        char* savePtr;
+        const char* type = strtok_r(line, " \t,\r", &savePtr);
+
+        if ((type != NULL) && (type[0] != '#'))
+        {
+            result = ParseFence(setPtr, type, &savePtr);
+            if (result == LE_FORMAT_ERROR)
+            {
+                LE_ERROR("Fence definition on line %zu is malformed.", lineNumber);
+            }
+        }
+    }
+
+    free(copy);
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the grid row or column of a latitude or longitude.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline uint32_t CellOf
+(
+    double degrees,     ///< Latitude or longitude.
+    double origin       ///< -90 for latitude, -180 for longitude.
+)
+{
+    double cell = floor((degrees - origin) / CELL_SIZE);
+
+    return (cell > 0.0) ? (uint32_t)cell : 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Combine a grid row and column into a cell key.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline uint64_t CellKey
+(
+    uint32_t row,
+    uint32_t column
+)
+{
+    return ((uint64_t)row << 32) | column;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compare two index entries by cell, for qsort().
+ */
+//--------------------------------------------------------------------------------------------------
+static int CompareEntries
+(
+    const void* aPtr,
+    const void* bPtr
+)
+{
+    uint64_t a = ((const IndexEntry_t*)aPtr)->cell;
+    uint64_t b = ((const IndexEntry_t*)bPtr)->cell;
+
+    return (a > b) - (a < b);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build a set's grid index from its fences.
+ *
+ * @return true if successful, false if out of memory.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool BuildIndex
+(
+    FenceSet_t* setPtr
+)
+{
+    setPtr->indexCount = 0;
+    setPtr->largeCount = 0;
+
+    for (size_t i = 0; i < setPtr->fenceCount; i++)
+    {
+        const Fence_t* fencePtr = &setPtr->fences[i];
+
+        uint32_t row0 = CellOf(fencePtr->minLat, -90.0);
+        uint32_t row1 = CellOf(fencePtr->maxLat, -90.0);
+        uint32_t col0 = CellOf(fencePtr->minLon, -180.0);
+        uint32_t col1 = CellOf(fencePtr->maxLon, -180.0);
+        uint64_t cells = (uint64_t)(row1 - row0 + 1) * (col1 - col0 + 1);
+
+        if (cells > MAX_CELLS_PER_FENCE)
+        {
+            if (!Reserve((void**)&setPtr->large,
+                         &setPtr->largeCapacity,
+                         setPtr->largeCount + 1,
+                         sizeof(uint32_t)))
+            {
+                return false;
+            }
+            setPtr->large[setPtr->largeCount++] = i;
+            continue;
+        }
+
+        if (!Reserve((void**)&setPtr->index,
+                     &setPtr->indexCapacity,
+                     setPtr->indexCount + cells,
+                     sizeof(IndexEntry_t)))
+        {
+            return false;
+        }
+
+        for (uint32_t row = row0; row <= row1; row++)
+        {
+            for (uint32_t col = col0; col <= col1; col++)
+            {
+                IndexEntry_t* entryPtr = &setPtr->index[setPtr->indexCount++];
+
+                entryPtr->cell = CellKey(row, col);
+                entryPtr->fence = i;
+            }
+        }
+    }
+
+    qsort(setPtr->index, setPtr->indexCount, sizeof(IndexEntry_t), CompareEntries);
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a fence contains a position.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool Contains
+(
+    const Fence_t* fencePtr,
+    double lat,
+    double lon
+)
+{
+    if (   (lat < fencePtr->minLat) || (lat > fencePtr->maxLat)
+        || (lon < fencePtr->minLon) || (lon > fencePtr->maxLon))
+    {
+        return false;
+    }
+
+    if (fencePtr->type == FENCE_CIRCLE)
+    {
+        // The fence is small enough for the equirectangular approximation.
+        double y = (lat - fencePtr->lat) * METRES_PER_DEGREE;
+        double x = (lon - fencePtr->lon) * METRES_PER_DEGREE * cos(fencePtr->lat * M_PI / 180.0);
+
+        return ((x * x) + (y * y)) <= (fencePtr->radius * fencePtr->radius);
+    }
+
+    // Even-odd ray casting, treating lat/lon as plane coordinates.
+    const Vertex_t* vertices = &Set.vertices[fencePtr->firstVertex];
+    size_t count = fencePtr->vertexCount;
+    bool isInside = false;
+
+    for (size_t i = 0, j = count - 1; i < count; j = i++)
+    {
+        if (   ((vertices[i].lat > lat) != (vertices[j].lat > lat))
+            && (lon < (vertices[j].lon - vertices[i].lon) * (lat - vertices[i].lat)
+                      / (vertices[j].lat - vertices[i].lat) + vertices[i].lon))
+        {
+            isInside = !isInside;
+        }
+    }
+
+    return isInside;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load fence definitions.  See fences.h for the format.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_FORMAT_ERROR if a definition is malformed (the current set is kept).
+ *  - LE_NO_MEMORY if there isn't enough memory (the current set is kept).
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t fences_Load
+(
+    const char* text,
+    bool append,
+    fences_EventFunc_t eventFunc,
+    void* contextPtr
+)
+{
+    FenceSet_t newSet;
+    memset(&newSet, 0, sizeof(newSet));
+
+    le_result_t result = LE_OK;
+
+    if (append && !CopyFences(&newSet, &Set))
+    {
+        result = LE_NO_MEMORY;
+    }
+
+    if (result == LE_OK)
+    {
+        result = ParseFences(&newSet, text);
+    }
+
+    if ((result == LE_OK) && !BuildIndex(&newSet))
+    {
+        result = LE_NO_MEMORY;
+    }
+
+    // Evaluation state, one element per fence.
+    size_t count = newSet.fenceCount;
+    bool* isInside = NULL;
+    uint32_t* stamp = NULL;
+    uint32_t* insideList = NULL;
+    uint32_t* newInsideList = NULL;
+
+    if ((result == LE_OK) && (count > 0))
+    {
+        isInside = calloc(count, sizeof(bool));
+        stamp = calloc(count, sizeof(uint32_t));
+        insideList = calloc(count, sizeof(uint32_t));
+        newInsideList = calloc(count, sizeof(uint32_t));
+
+        if (   (isInside == NULL)
+            || (stamp == NULL)
+            || (insideList == NULL)
+            || (newInsideList == NULL))
+        {
+            result = LE_NO_MEMORY;
+        }
+    }
+
+    if (result != LE_OK)
+    {
+        FreeSet(&newSet);
+        free(isInside);
+        free(stamp);
+        free(insideList);
+        free(newInsideList);
+        return result;
+    }
+
+    // Carry over the fences that contain the last position.  Appending keeps the current fences'
+    // indices; otherwise they are matched by ID, and those that are gone are exited.
+    size_t insideCount = 0;
+    for (size_t i = 0; i < InsideCount; i++)
+    {
+        uint32_t oldFence = InsideList[i];
+        size_t fence = append ? oldFence : FindFence(&newSet, Set.fences[oldFence].id, isInside);
+
+        if (fence < count)
+        {
+            isInside[fence] = true;
+            insideList[insideCount++] = fence;
+        }
+        else
+        {
+            eventFunc(Set.fences[oldFence].id, false, contextPtr);
+        }
+    }
+
+    FreeSet(&Set);
+    Set = newSet;
+
+    free(IsInside);
+    free(Stamp);
+    free(InsideList);
+    free(NewInsideList);
+    IsInside = isInside;
+    Stamp = stamp;
+    InsideList = insideList;
+    NewInsideList = newInsideList;
+    InsideCount = insideCount;
+    EvalCount = 0;
+
+    LE_INFO("%zu geofences loaded (%zu index entries, %zu unindexed).",
+            Set.fenceCount,
+            Set.indexCount,
+            Set.largeCount);
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of fences loaded.
+ */
+//--------------------------------------------------------------------------------------------------
+size_t fences_Count
+(
+    void
+)
+{
+    return Set.fenceCount;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Evaluate a position against the fences, calling eventFunc for each fence entered or exited
+ * since the last evaluation.
+ */
+//--------------------------------------------------------------------------------------------------
+void fences_Evaluate
+(
+    double lat,     ///< degrees
+    double lon,     ///< degrees
+    fences_EventFunc_t eventFunc,
+    void* contextPtr
+)
+{
+    if (Set.fenceCount == 0)
+    {
+        return;
+    }
+
+    // Stamps are compared with EvalCount, so skip 0, which every fence starts with.
+    if (++EvalCount == 0)
+    {
+        memset(Stamp, 0, Set.fenceCount * sizeof(uint32_t));
+        EvalCount = 1;
+    }
+
+    size_t newInsideCount = 0;
+
+    // Candidates from the position's cell: find the first entry for the cell by binary search.
+    uint64_t cell = CellKey(CellOf(lat, -90.0), CellOf(lon, -180.0));
+    size_t low = 0;
+    size_t high = Set.indexCount;
+    while (low < high)
+    {
+        size_t mid = low + ((high - low) / 2);
+
+        if (Set.index[mid].cell < cell)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    for (size_t i = low; (i < Set.indexCount) && (Set.index[i].cell == cell); i++)
+    {
+        uint32_t fence = Set.index[i].fence;
+
+        if (Contains(&Set.fences[fence], lat, lon))
+        {
+            Stamp[fence] = EvalCount;
+            NewInsideList[newInsideCount++] = fence;
+        }
+    }
+
+    for (size_t i = 0; i < Set.largeCount; i++)
+    {
+        uint32_t fence = Set.large[i];
+
+        if (Contains(&Set.fences[fence], lat, lon))
+        {
+            Stamp[fence] = EvalCount;
+            NewInsideList[newInsideCount++] = fence;
+        }
+    }
+
+    // Exits: fences that contained the last position, but not this one.
+    for (size_t i = 0; i < InsideCount; i++)
+    {
+        uint32_t fence = InsideList[i];
+
+        if (Stamp[fence] != EvalCount)
+        {
+            IsInside[fence] = false;
+            eventFunc(Set.fences[fence].id, false, contextPtr);
+        }
+    }
+
+    // Entries: fences that contain this position, but didn't contain the last one.
+    for (size_t i = 0; i < newInsideCount; i++)
+    {
+        uint32_t fence = NewInsideList[i];
+
+        if (!IsInside[fence])
+        {
+            IsInside[fence] = true;
+            eventFunc(Set.fences[fence].id, true, contextPtr);
+        }
+    }
+
+    uint32_t* listPtr = InsideList;
+    InsideList = NewInsideList;
+    NewInsideList = listPtr;
+    InsideCount = newInsideCount;
+}
@@ -0,0 +1,86 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file fences.h
+ *
+ * Geofence set, spatial index and evaluation.  Internal to the geofence component.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef FENCES_H_INCLUDE_GUARD
+#define FENCES_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of bytes in a fence ID (including null terminator).
+ */
+//--------------------------------------------------------------------------------------------------
+#define FENCES_MAX_ID_BYTES 32
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function called for each fence entered or exited.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*fences_EventFunc_t)(const char* id, bool isEnter, void* contextPtr);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load fence definitions, one per line:
+ *
+ * @verbatim
+circle <id> <lat> <lon> <radius in metres>
+polygon <id> <lat> <lon> <lat> <lon> <lat> <lon> ...
+@endverbatim
+ *
+ * Blank lines and lines starting with '#' are ignored.  The definitions replace the current set,
+ * or are added to it if append is true.  Fences that contained the last position evaluated stay
+ * entered if they're still in the set (matched by ID when the set is replaced); eventFunc is
+ * called to exit those that aren't.  New fences start off as not entered.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_FORMAT_ERROR if a definition is malformed (the current set is kept).
+ *  - LE_NO_MEMORY if there isn't enough memory (the current set is kept).
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t fences_Load
+(
+    const char* text,
+    bool append,
+    fences_EventFunc_t eventFunc,
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of fences loaded.
+ */
+//--------------------------------------------------------------------------------------------------
+size_t fences_Count
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Evaluate a position against the fences, calling eventFunc for each fence entered or exited
+ * since the last evaluation.
+ */
+//--------------------------------------------------------------------------------------------------
+void fences_Evaluate
+(
+    double lat,     ///< degrees
+    double lon,     ///< degrees
+    fences_EventFunc_t eventFunc,
+    void* contextPtr
+);
+
+
+#endif // FENCES_H_INCLUDE_GUARD
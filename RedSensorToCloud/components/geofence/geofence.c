@@ -0,0 +1,438 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file geofence.c
+ *
+ * Evaluates the mangOH Red's position against a set of geofences on the device, so that fixes
+ * don't have to go to the cloud to find out which fences the device has entered or left.
+ *
+ * Position samples are received from the position sensor through a Data Hub observation.  Each
+ * one is evaluated against the fences (see fences.h), and for each fence entered or exited:
+ * - the "geofence/enter" or "geofence/exit" trigger is pushed, and
+ * - "geofence/event" is pushed, like this:
+ *
+ *  {"id":"depot","event":"enter","lat":49.172350,"lon":-123.070987}
+ *
+ * Fences are loaded from the file named by the "geofence/file" output, whenever it's set, or by
+ * these AirVantage commands.  The app is sandboxed, so fence files must be in /geofences, which is
+ * bound to /mnt/flash/geofences on the device (see Component.cdef).
+ *
+ * The commands are:
+ * - /LoadGeofences (string argument "File") - replace the fences with those in a file.
+ * - /AddGeofence (string argument "Fence") - add one fence definition.
+ * - /ClearGeofences - remove all fences.
+ *
+ * The number of fences loaded is pushed to "geofence/count".
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "json.h"
+#include "dhubUtils.h"
+
+#include "fences.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data Hub paths.
+ */
+//--------------------------------------------------------------------------------------------------
+#define POS_SENSOR_INPUT_PATH   "/app/redSensor/position/value"
+#define POS_OBS_PATH            "/obs/geofence"
+#define FILE_PATH               "geofence/file"
+#define COUNT_PATH              "geofence/count"
+#define ENTER_PATH              "geofence/enter"
+#define EXIT_PATH               "geofence/exit"
+#define EVENT_PATH              "geofence/event"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * AirVantage commands and their arguments.
+ */
+//--------------------------------------------------------------------------------------------------
+#define LOAD_CMD_RES            "/LoadGeofences"
+#define LOAD_CMD_FILE_ARG       "File"
+#define ADD_CMD_RES             "/AddGeofence"
+#define ADD_CMD_FENCE_ARG       "Fence"
+#define CLEAR_CMD_RES           "/ClearGeofences"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Largest fence file (bytes) that will be loaded.
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_FILE_SIZE (16 * 1024 * 1024)
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Directory in the sandbox that fence files must be in.
+ */
+//--------------------------------------------------------------------------------------------------
+#define FENCE_DIR "/geofences"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Position being evaluated, for the event records.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    double timestamp;
+    double lat;
+    double lon;
+}
+Position_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Last position evaluated, where fences that are removed are exited.
+ */
+//--------------------------------------------------------------------------------------------------
+static Position_t LastPosition;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current relative (monotonic) time, in seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double Now
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Extract a numeric member from a JSON object.
+ *
+ * @return The number, or NAN if it couldn't be extracted.
+ */
+//--------------------------------------------------------------------------------------------------
+static double ExtractNumber
+(
+    const char* json,
+    const char* memberName
+)
+{
+    char member[32];
+    json_DataType_t dataType;
+
+    if (   (json_Extract(member, sizeof(member), json, memberName, &dataType) != LE_OK)
+        || (dataType != JSON_TYPE_NUMBER))
+    {
+        return NAN;
+    }
+
+    return json_ConvertToNumber(member);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish a fence being entered or exited.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleFenceEvent
+(
+    const char* id,
+    bool isEnter,
+    void* contextPtr    ///< Position_t*
+)
+{
+    const Position_t* positionPtr = contextPtr;
+    char json[256];
+
+    LE_INFO("%s geofence '%s'.", isEnter ? "Entered" : "Exited", id);
+
+    // Fence IDs are single tokens, but may still contain characters that need escaping in JSON.
+    char escapedId[(FENCES_MAX_ID_BYTES * 2) + 1];
+    size_t len = 0;
+    for (const char* cPtr = id; *cPtr != '\0'; cPtr++)
+    {
+        if ((*cPtr == '"') || (*cPtr == '\\'))
+        {
+            escapedId[len++] = '\\';
+        }
+        escapedId[len++] = *cPtr;
+    }
+    escapedId[len] = '\0';
+
+    int jsonLen = snprintf(json,
+                           sizeof(json),
+                           "{\"id\":\"%s\",\"event\":\"%s\",\"lat\":%.6f,\"lon\":%.6f}",
+                           escapedId,
+                           isEnter ? "enter" : "exit",
+                           positionPtr->lat,
+                           positionPtr->lon);
+    LE_ASSERT(jsonLen < sizeof(json));
+
+    dhubIO_PushTrigger(isEnter ? ENTER_PATH : EXIT_PATH, positionPtr->timestamp);
+    dhubIO_PushJson(EVENT_PATH, positionPtr->timestamp, json);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Evaluate each position sample received from the position sensor.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandlePositionUpdate
+(
+    double timestamp,
+    const char* value,
+    void* contextPtr
+)
+{
+    Position_t position;
+
+    position.timestamp = timestamp;
+    position.lat = ExtractNumber(value, "lat");
+    position.lon = ExtractNumber(value, "lon");
+
+    if (isnan(position.lat) || isnan(position.lon))
+    {
+        LE_ERROR("Failed to decode position value '%s'.", value);
+        return;
+    }
+
+    double start = Now();
+
+    fences_Evaluate(position.lat, position.lon, HandleFenceEvent, &position);
+    LastPosition = position;
+
+    LE_DEBUG("Evaluated %zu geofences in %.3lf ms.", fences_Count(), (Now() - start) * 1000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load fence definitions from text and report the new number of fences.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t LoadText
+(
+    const char* text,
+    bool append
+)
+{
+    // Fences that are removed while the device is inside them are exited now.
+    Position_t position = LastPosition;
+    position.timestamp = DHUBIO_NOW;
+
+    le_result_t result = fences_Load(text, append, HandleFenceEvent, &position);
+
+    if (result == LE_OK)
+    {
+        dhubIO_PushNumeric(COUNT_PATH, DHUBIO_NOW, (double)fences_Count());
+    }
+    else
+    {
+        LE_ERROR("Failed to load geofences (%s).", LE_RESULT_TXT(result));
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Replace the fences with those defined in a file.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t LoadFile
+(
+    const char* filePath
+)
+{
+    FILE* filePtr = fopen(filePath, "r");
+    if (filePtr == NULL)
+    {
+        LE_ERROR("Can't open geofence file '%s' (%m).  Fence files must be in " FENCE_DIR ".",
+                 filePath);
+        return LE_NOT_FOUND;
+    }
+
+    le_result_t result = LE_OK;
+    char* text = NULL;
+    long size;
+
+    if (   (fseek(filePtr, 0, SEEK_END) != 0)
+        || ((size = ftell(filePtr)) < 0)
+        || (fseek(filePtr, 0, SEEK_SET) != 0))
+    {
+        LE_ERROR("Can't read geofence file '%s' (%m).", filePath);
+        result = LE_FAULT;
+    }
+    else if (size > MAX_FILE_SIZE)
+    {
+        LE_ERROR("Geofence file '%s' is too big (%ld bytes).", filePath, size);
+        result = LE_OVERFLOW;
+    }
+    else if ((text = malloc(size + 1)) == NULL)
+    {
+        result = LE_NO_MEMORY;
+    }
+    else if (fread(text, 1, size, filePtr) != (size_t)size)
+    {
+        LE_ERROR("Can't read geofence file '%s'.", filePath);
+        result = LE_FAULT;
+    }
+    else
+    {
+        text[size] = '\0';
+        result = LoadText(text, false);
+    }
+
+    free(text);
+    fclose(filePtr);
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an update to the fence file path by loading the file.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleFilePush
+(
+    double timestamp,
+    const char* filePath,
+    void* contextPtr
+)
+{
+    if (filePath[0] != '\0')
+    {
+        LoadFile(filePath);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * AirVantage command to replace the fences with those in a file.
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadGeofencesCmd
+(
+    const char* path,
+    le_avdata_AccessType_t accessType,
+    le_avdata_ArgumentListRef_t argumentList,
+    void* contextPtr
+)
+{
+    char filePath[LE_AVDATA_STRING_VALUE_LEN + 1];
+
+    le_result_t result = le_avdata_GetStringArg(argumentList,
+                                                LOAD_CMD_FILE_ARG,
+                                                filePath,
+                                                sizeof(filePath));
+    if (result != LE_OK)
+    {
+        LE_ERROR("le_avdata_GetStringArg('%s') failed(%d)", LOAD_CMD_FILE_ARG, result);
+    }
+    else
+    {
+        result = LoadFile(filePath);
+    }
+
+    le_avdata_ReplyExecResult(argumentList, result);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * AirVantage command to add one fence.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddGeofenceCmd
+(
+    const char* path,
+    le_avdata_AccessType_t accessType,
+    le_avdata_ArgumentListRef_t argumentList,
+    void* contextPtr
+)
+{
+    char fence[LE_AVDATA_STRING_VALUE_LEN + 1];
+
+    le_result_t result = le_avdata_GetStringArg(argumentList,
+                                                ADD_CMD_FENCE_ARG,
+                                                fence,
+                                                sizeof(fence));
+    if (result != LE_OK)
+    {
+        LE_ERROR("le_avdata_GetStringArg('%s') failed(%d)", ADD_CMD_FENCE_ARG, result);
+    }
+    else
+    {
+        result = LoadText(fence, true);
+    }
+
+    le_avdata_ReplyExecResult(argumentList, result);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * AirVantage command to remove all fences.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ClearGeofencesCmd
+(
+    const char* path,
+    le_avdata_AccessType_t accessType,
+    le_avdata_ArgumentListRef_t argumentList,
+    void* contextPtr
+)
+{
+    le_avdata_ReplyExecResult(argumentList, LoadText("", false));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    dhubUtils_CreateInput(COUNT_PATH, DHUBIO_DATA_TYPE_NUMERIC, "");
+    dhubUtils_CreateInput(ENTER_PATH, DHUBIO_DATA_TYPE_TRIGGER, "");
+    dhubUtils_CreateInput(EXIT_PATH, DHUBIO_DATA_TYPE_TRIGGER, "");
+    dhubUtils_CreateInput(EVENT_PATH, DHUBIO_DATA_TYPE_JSON, "");
+    dhubIO_SetJsonExample(EVENT_PATH,
+                          "{\"id\":\"depot\",\"event\":\"enter\",\"lat\":49.17,\"lon\":-123.07}");
+
+    dhubUtils_CreateOutput(FILE_PATH, DHUBIO_DATA_TYPE_STRING, "");
+    dhubIO_AddStringPushHandler(FILE_PATH, HandleFilePush, NULL);
+    dhubIO_MarkOptional(FILE_PATH);
+
+    le_avdata_CreateResource(LOAD_CMD_RES, LE_AVDATA_ACCESS_COMMAND);
+    le_avdata_AddResourceEventHandler(LOAD_CMD_RES, LoadGeofencesCmd, NULL);
+    le_avdata_CreateResource(ADD_CMD_RES, LE_AVDATA_ACCESS_COMMAND);
+    le_avdata_AddResourceEventHandler(ADD_CMD_RES, AddGeofenceCmd, NULL);
+    le_avdata_CreateResource(CLEAR_CMD_RES, LE_AVDATA_ACCESS_COMMAND);
+    le_avdata_AddResourceEventHandler(CLEAR_CMD_RES, ClearGeofencesCmd, NULL);
+
+    // Receive the position sensor's samples through an observation of our own.
+    le_result_t result = dhubAdmin_CreateObs(POS_OBS_PATH);
+    if (result != LE_OK)
+    {
+        LE_FATAL("Failed to create Data Hub observation at path '%s' (%s).",
+                 POS_OBS_PATH,
+                 LE_RESULT_TXT(result));
+    }
+    dhubAdmin_AddJsonPushHandler(POS_OBS_PATH, HandlePositionUpdate, NULL);
+    dhubAdmin_SetSource(POS_OBS_PATH, POS_SENSOR_INPUT_PATH);
+}
@@ -11,6 +11,146 @@
 #include "periodicSensor.h"
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of buckets in a timing histogram.  Bucket 0 counts times under 1 ms, bucket i counts
+ * times in [2^(i-1), 2^i) ms, and the last bucket counts everything from 2^(N-2) ms up.
+ */
+//--------------------------------------------------------------------------------------------------
+#define HISTOGRAM_BUCKETS 12
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * How often (seconds) a sensor's statistics are pushed to the Data Hub.  The push piggybacks on
+ * one of the sensor's own samples, so it never causes a wakeup of its own.
+ */
+//--------------------------------------------------------------------------------------------------
+#define STATS_PUBLISH_INTERVAL 60.0
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timing histogram.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t count;
+    double sum;     ///< ms
+    double max;     ///< ms
+    uint32_t buckets[HISTOGRAM_BUCKETS];
+}
+Histogram_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Per-sensor sampling statistics.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    Histogram_t lateness;       ///< How late the scheduler ran the sample function.
+    Histogram_t sampleTime;     ///< How long the sample function took.
+    Histogram_t pushLatency;    ///< How long each push to the Data Hub took.
+    uint32_t missedPeriods;     ///< Sample periods skipped because we fell behind.
+    double lastPublished;       ///< Relative time the statistics were last pushed.
+}
+Stats_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Weight given to each new sample by the adaptive period's moving average and variance.
+ */
+//--------------------------------------------------------------------------------------------------
+#define ADAPTIVE_ALPHA 0.2
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of consecutive flat samples after which the adaptive period is doubled.
+ */
+//--------------------------------------------------------------------------------------------------
+#define ADAPTIVE_STRETCH_AFTER 3
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of numeric members considered in a JSON sample (e.g., x, y and z of a vector).
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_VECTOR_MEMBERS 8
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Adaptive sampling period state.
+ *
+ * The active period is always minPeriod * 2^level (capped at maxPeriod), so that it stays
+ * harmonic with the other sensors and keeps sharing their wakeups.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool isCreated;         ///< true if the Data Hub resources have been created.
+    double minPeriod;       ///< seconds (0 = not set)
+    double maxPeriod;       ///< seconds (0 = not set)
+    double sensitivity;     ///< Signal deviation that counts as movement (0 = not set).
+    double mean;            ///< Exponentially weighted moving average of the signal.
+    double variance;        ///< Exponentially weighted moving variance of the signal.
+    bool isPrimed;          ///< true once the average has been seeded with a sample.
+    unsigned int level;     ///< Active period is minPeriod * 2^level.
+    unsigned int flatCount; ///< Consecutive samples in which the signal was flat.
+    dhubIO_NumericPushHandlerRef_t minHandlerRef;
+    dhubIO_NumericPushHandlerRef_t maxHandlerRef;
+    dhubIO_NumericPushHandlerRef_t sensitivityHandlerRef;
+}
+Adaptive_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deadband filter state.  A sample is only passed on to the Data Hub if it differs from the last
+ * sample passed on by more than max(absolute, relative * |last value|), or if nothing has been
+ * passed on for maxSilence seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool isCreated;         ///< true if the Data Hub resources have been created.
+    psensor_DeadbandMode_t mode;
+    double absolute;        ///< In the sensor's units (0 = not set).
+    double relative;        ///< Fraction of the last value passed on (0 = not set).
+    double maxSilence;      ///< seconds (0 = no limit)
+    bool hasLast;           ///< true if last[] holds the values of the last sample passed on.
+    size_t lastCount;       ///< Number of values in last[].
+    double last[MAX_VECTOR_MEMBERS];
+    double lastPassed;      ///< Relative time (seconds) at which a sample was last passed on.
+    uint32_t suppressed;    ///< Number of samples that have been filtered out.
+    dhubIO_NumericPushHandlerRef_t absoluteHandlerRef;
+    dhubIO_NumericPushHandlerRef_t relativeHandlerRef;
+    dhubIO_NumericPushHandlerRef_t maxSilenceHandlerRef;
+}
+Deadband_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Motion gating state.  While the device is stationary, the sensor is sampled no more often than
+ * every stationaryPeriod seconds, or not at all if stationaryPeriod is 0.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool isCreated;             ///< true if the Data Hub resource has been created.
+    double stationaryPeriod;    ///< seconds (0 = suspend while stationary)
+    dhubIO_NumericPushHandlerRef_t stationaryPeriodHandlerRef;
+}
+MotionGate_t;
+
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Sensor Scaffold object.
@@ -18,14 +158,38 @@
 //--------------------------------------------------------------------------------------------------
 typedef struct psensor
 {
+    le_dls_Link_t link;     ///< Link in the scheduler's list of sensors.
     bool isEnabled;
     double period;  ///< seconds (0.0 = not set yet)
-    le_timer_Ref_t timer;
+    double nextDue; ///< Relative time (seconds) at which the next sample is due.
     void (*sampleFunc)(psensor_Ref_t, void *);
     void *sampleFuncContext;
     char name[PSENSOR_MAX_NAME_BYTES];
+    char valuePath[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];   ///< Path of the "value" resource.
+
+    uint32_t batchMaxCount; ///< Flush after this many samples are batched (0 = not batching).
+    double batchMaxAge;     ///< Flush when the oldest batched sample is this old (seconds).
+    uint32_t batchCount;    ///< Number of samples currently in the batch.
+    double batchDeadline;   ///< Relative time at which the batch must be flushed.
+    le_sls_List_t batch;    ///< Batched samples (Sample_t), oldest first.
+
+    Stats_t stats;
+    bool areStatsCreated;   ///< true once the "stats/..." inputs have been created.
+    Adaptive_t adaptive;
+    Deadband_t deadband;
+    MotionGate_t motionGate;
+
+    struct psensor_Group* groupPtr; ///< Group the sensor is sampled with (NULL = none).
+    le_dls_Link_t groupLink;        ///< Link in the group's list of members.
+    bool isGroupDue;                ///< true = sample this member in the group's next pass.
+
+    bool isBlocking;        ///< true = sample function runs on a worker thread.
+    bool isInFlight;        ///< true = a worker is running the sample function right now.
+    bool isDestroyed;       ///< true = psensor_Destroy() was called while a sample was in flight.
+    double workerSampleTime;///< Time (seconds) the worker spent in the sample function.
 
     dhubIO_TriggerPushHandlerRef_t triggerHandlerRef;
+    dhubIO_TriggerPushHandlerRef_t statsResetHandlerRef;
     dhubIO_NumericPushHandlerRef_t periodHandlerRef;
     dhubIO_BooleanPushHandlerRef_t enableHandlerRef;
 }
@@ -34,440 +198,2769 @@ Sensor_t;
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Pool from which Sensor_t objects are allocated.
+ * Sensor group object.  All the members of a group are sampled by one call to the group's
+ * sample function.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct psensor_Group
+{
+    le_dls_Link_t link;     ///< Link in the list of all groups.
+    void (*sampleFunc)(psensor_GroupRef_t, void *);
+    void *sampleFuncContext;
+    le_dls_List_t members;  ///< Member sensors (Sensor_t, linked through groupLink).
+    bool isDue;             ///< true = at least one member is due in the current wakeup.
+    bool isSampling;        ///< true = the group's sample function is running.
+    double passTimestamp;   ///< Timestamp shared by all the samples pushed in one pass.
+}
+Group_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool from which Group_t objects are allocated.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t GroupPool = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * List of all sensor groups (Group_t objects).
+ */
+//--------------------------------------------------------------------------------------------------
+static le_dls_List_t GroupList = LE_DLS_LIST_INIT;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool from which Sensor_t objects are allocated.  Its PSENSOR_MAX_SENSORS blocks are statically
+ * allocated, so the memory used by the sensors is known at build time.
  */
 //--------------------------------------------------------------------------------------------------
+LE_MEM_DEFINE_STATIC_POOL(psensor, PSENSOR_MAX_SENSORS, sizeof(Sensor_t));
 static le_mem_PoolRef_t SensorPool = NULL;
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Timer expiry handler function.
+ * A sample held in a sensor's batch, waiting to be flushed to the Data Hub.
  */
 //--------------------------------------------------------------------------------------------------
-static void HandleTimerExpiry
+typedef struct
+{
+    le_sls_Link_t link;     ///< Link in the sensor's batch list.
+    dhubIO_DataType_t dataType;
+    double timestamp;       ///< Always a real timestamp (never DHUBIO_NOW).
+    union
+    {
+        bool boolean;
+        double numeric;
+        char string[PSENSOR_MAX_BATCH_VALUE_BYTES]; ///< Short string or JSON value.
+    }
+    value;
+    char* stringPtr;        ///< String or JSON value: value.string, or a heap copy if too long.
+}
+Sample_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool from which Sample_t objects are allocated.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t SamplePool = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of worker threads that run the sample functions of blocking sensors.
+ */
+//--------------------------------------------------------------------------------------------------
+#define WORKER_COUNT 2
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of functions that can be registered with psensor_AddWorkerInitHandler().
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_WORKER_INIT_HANDLERS 4
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Worker thread.  Sample jobs are queued to the worker with the fewest jobs pending.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    le_thread_Ref_t thread;
+    uint32_t pendingJobs;   ///< Only touched by the main thread.
+}
+Worker_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The worker pool.  The threads are started the first time a sensor is made blocking.
+ */
+//--------------------------------------------------------------------------------------------------
+static Worker_t Workers[WORKER_COUNT];
+static bool WorkersStarted = false;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Functions to be run once on each worker thread before it runs any sample functions.
+ */
+//--------------------------------------------------------------------------------------------------
+static psensor_WorkerInitFunc_t WorkerInitHandlers[MAX_WORKER_INIT_HANDLERS];
+static size_t WorkerInitHandlerCount = 0;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The thread that runs the scheduler and owns all sensor state (the thread that initialized
+ * this component).
+ */
+//--------------------------------------------------------------------------------------------------
+static le_thread_Ref_t MainThread = NULL;
+
+
+static void Reschedule(void);
+static void Deliver(Sensor_t* sensorPtr, Sample_t* samplePtr);
+static double AbsoluteNow(void);
+static void CreateInput(const char* path, dhubIO_DataType_t dataType, const char* units);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * List of all sensors (Sensor_t objects) owned by the scheduler.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_dls_List_t SensorList = LE_DLS_LIST_INIT;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The one timer shared by all sensors.  It is always armed (one-shot) for the earliest due time
+ * of any enabled sensor, or stopped if no sensor is running.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_timer_Ref_t SchedulerTimer = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Relative time (seconds) used as the phase origin for all sensors.  Sample times are aligned to
+ * whole multiples of each sensor's period from this point, so sensors with the same or harmonic
+ * periods fall due at exactly the same instants and are served by the same wakeup.
+ */
+//--------------------------------------------------------------------------------------------------
+static double SchedulerEpoch = 0.0;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Slack window (seconds).  When the timer fires, every sensor due within this window is sampled
+ * in the same wakeup, rather than waking up again a moment later.
+ */
+//--------------------------------------------------------------------------------------------------
+static double SchedulerSlack = PSENSOR_DEFAULT_SLACK;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wakeup accounting.  The number of scheduler wakeups in the last full hour is pushed to the
+ * Data Hub (at WAKEUPS_RESOURCE) each time an hour rolls over.
+ */
+//--------------------------------------------------------------------------------------------------
+#define WAKEUPS_RESOURCE "psensor/wakeupsPerHour"
+#define WAKEUP_WINDOW 3600.0 // seconds
+static uint32_t WakeupCount = 0;   ///< Wakeups counted since WakeupWindowStart.
+static double WakeupWindowStart = 0.0;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of functions that can be registered with psensor_AddMotionHandler().
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_MOTION_HANDLERS 4
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Whether the device is stationary (see psensor_SetStationary()), and the functions to call when
+ * that changes.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsStationary = false;
+static struct
+{
+    psensor_MotionHandlerFunc_t func;
+    void* contextPtr;
+}
+MotionHandlers[MAX_MOTION_HANDLERS];
+static size_t MotionHandlerCount = 0;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build up the path to a resource from the sensor name and the resource (leaf) name.
+ */
+//--------------------------------------------------------------------------------------------------
+static void BuildResourcePath
 (
-    le_timer_Ref_t timer
+    char* pathBuffPtr,  ///< Ptr to the buffer into which the path will be built.
+    size_t pathBuffSize,    ///< Size (in bytes) of the buffer pointed to by pathBuffPtr.
+    Sensor_t* sensorPtr, ///< Ptr to the Sensor scaffold object.
+    const char* resourceName  ///< E.g., "value" or "enable"
 )
 //--------------------------------------------------------------------------------------------------
 {
-    Sensor_t* sensorPtr = le_timer_GetContextPtr(timer);
+    if (sensorPtr->name[0] == '\0')
+    {
+        LE_ASSERT(LE_OK == le_utf8_Copy(pathBuffPtr, resourceName, pathBuffSize, NULL));
+    }
+    else
+    {
+        LE_ASSERT(snprintf(pathBuffPtr, pathBuffSize, "%s/%s", sensorPtr->name, resourceName)
+                  < pathBuffSize);
+    }
+}
 
-    sensorPtr->sampleFunc(sensorPtr, sensorPtr->sampleFuncContext);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current relative (monotonic) time, in seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double Now
+(
+    void
+)
+//--------------------------------------------------------------------------------------------------
+{
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Handle an "enable" update from the Data Hub.
+ * Check whether a sensor's motion gating currently applies to it.
  */
 //--------------------------------------------------------------------------------------------------
-static void HandleEnablePush
+static inline bool IsGated
 (
-    double timestamp,   ///< Don't care about this.
-    bool enable,
-    void* contextPtr
+    const Sensor_t* sensorPtr
 )
 //--------------------------------------------------------------------------------------------------
 {
-    Sensor_t* sensorPtr = contextPtr;
+    return (IsStationary && sensorPtr->motionGate.isCreated);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a sensor is suspended because the device is stationary.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline bool IsSuspended
+(
+    const Sensor_t* sensorPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    return (IsGated(sensorPtr) && (sensorPtr->motionGate.stationaryPeriod == 0.0));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a sensor is currently being sampled periodically by the scheduler.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline bool IsRunning
+(
+    const Sensor_t* sensorPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    return (sensorPtr->isEnabled && (sensorPtr->period > 0.0) && !IsSuspended(sensorPtr));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a sensor's adaptive period is fully configured and in effect.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline bool IsAdaptive
+(
+    const Sensor_t* sensorPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    const Adaptive_t* adaptivePtr = &sensorPtr->adaptive;
+
+    return (   (adaptivePtr->minPeriod > 0.0)
+            && (adaptivePtr->maxPeriod >= adaptivePtr->minPeriod)
+            && (adaptivePtr->sensitivity > 0.0));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the period (seconds) the scheduler is currently sampling a sensor at.  This is the
+ * configured "period", unless the sensor's adaptive period is in effect, stretched to the
+ * sensor's "stationaryPeriod" while the device is stationary.
+ */
+//--------------------------------------------------------------------------------------------------
+static double ActivePeriod
+(
+    const Sensor_t* sensorPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    double period = sensorPtr->period;
+
+    if (IsAdaptive(sensorPtr))
+    {
+        const Adaptive_t* adaptivePtr = &sensorPtr->adaptive;
+
+        period = fmin(ldexp(adaptivePtr->minPeriod, adaptivePtr->level), adaptivePtr->maxPeriod);
+    }
+
+    if (IsGated(sensorPtr))
+    {
+        period = fmax(period, sensorPtr->motionGate.stationaryPeriod);
+    }
+
+    return period;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the first sample time on the sensor's period grid that is strictly after a given time.
+ */
+//--------------------------------------------------------------------------------------------------
+static double NextGridTime
+(
+    const Sensor_t* sensorPtr,
+    double after    ///< Relative time (seconds).
+)
+//--------------------------------------------------------------------------------------------------
+{
+    double period = ActivePeriod(sensorPtr);
+    double periods = floor((after - SchedulerEpoch) / period) + 1.0;
+
+    return SchedulerEpoch + (periods * period);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a time in a histogram.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RecordTime
+(
+    Histogram_t* histPtr,
+    double seconds
+)
+//--------------------------------------------------------------------------------------------------
+{
+    double ms = seconds * 1000.0;
+
+    if (ms < 0.0)
+    {
+        ms = 0.0;
+    }
+
+    size_t i = 0;
+    double limit = 1.0;
+    while ((ms >= limit) && (i < (HISTOGRAM_BUCKETS - 1)))
+    {
+        i++;
+        limit *= 2;
+    }
+
+    histPtr->buckets[i]++;
+    histPtr->count++;
+    histPtr->sum += ms;
+    if (ms > histPtr->max)
+    {
+        histPtr->max = ms;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a histogram to the Data Hub as a JSON value, e.g.,
+ *
+ * {"count":12,"mean":0.41,"max":1.20,"hist":[11,1,0,0,0,0,0,0,0,0,0,0]}
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushHistogram
+(
+    Sensor_t* sensorPtr,
+    const char* resourceName,
+    const Histogram_t* histPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
+    char json[256];
+
+    BuildResourcePath(path, sizeof(path), sensorPtr, resourceName);
+
+    size_t len = snprintf(json,
+                          sizeof(json),
+                          "{\"count\":%u,\"mean\":%.3lf,\"max\":%.3lf,\"hist\":[",
+                          histPtr->count,
+                          (histPtr->count > 0) ? (histPtr->sum / histPtr->count) : 0.0,
+                          histPtr->max);
+
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        len += snprintf(json + len,
+                        sizeof(json) - len,
+                        (i == 0) ? "%u" : ",%u",
+                        histPtr->buckets[i]);
+    }
+
+    len += snprintf(json + len, sizeof(json) - len, "]}");
+    LE_ASSERT(len < sizeof(json));
+
+    dhubIO_PushJson(path, DHUBIO_NOW, json);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a sensor's statistics to its "stats/..." resources in the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PublishStats
+(
+    Sensor_t* sensorPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
+
+    // The inputs aren't created until they're needed, to keep sensor creation quick.
+    if (!sensorPtr->areStatsCreated)
+    {
+        BuildResourcePath(path, sizeof(path), sensorPtr, "stats/lateness");
+        CreateInput(path, DHUBIO_DATA_TYPE_JSON, "");
+        BuildResourcePath(path, sizeof(path), sensorPtr, "stats/sampleTime");
+        CreateInput(path, DHUBIO_DATA_TYPE_JSON, "");
+        BuildResourcePath(path, sizeof(path), sensorPtr, "stats/pushLatency");
+        CreateInput(path, DHUBIO_DATA_TYPE_JSON, "");
+        BuildResourcePath(path, sizeof(path), sensorPtr, "stats/missed");
+        CreateInput(path, DHUBIO_DATA_TYPE_NUMERIC, "");
+
+        sensorPtr->areStatsCreated = true;
+    }
+
+    PushHistogram(sensorPtr, "stats/lateness", &sensorPtr->stats.lateness);
+    PushHistogram(sensorPtr, "stats/sampleTime", &sensorPtr->stats.sampleTime);
+    PushHistogram(sensorPtr, "stats/pushLatency", &sensorPtr->stats.pushLatency);
+
+    BuildResourcePath(path, sizeof(path), sensorPtr, "stats/missed");
+    dhubIO_PushNumeric(path, DHUBIO_NOW, sensorPtr->stats.missedPeriods);
+
+    if (sensorPtr->deadband.isCreated)
+    {
+        BuildResourcePath(path, sizeof(path), sensorPtr, "deadband/suppressed");
+        dhubIO_PushNumeric(path, DHUBIO_NOW, sensorPtr->deadband.suppressed);
+    }
+
+    sensorPtr->stats.lastPublished = Now();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Extract the numeric member values of a flat JSON object, such as {"x":0.1, "y":0.2, "z":0.3},
+ * in the order they appear.  Non-numeric members are skipped.
+ *
+ * @return The number of values extracted (at most maxCount).
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t ExtractJsonNumbers
+(
+    const char* json,
+    double* valuesPtr,  ///< [OUT] Array into which the values will be put.
+    size_t maxCount     ///< Number of entries in the valuesPtr array.
+)
+//--------------------------------------------------------------------------------------------------
+{
+    size_t count = 0;
+    const char* cursor = json;
+
+    while ((count < maxCount) && ((cursor = strchr(cursor, ':')) != NULL))
+    {
+        char* endPtr;
+
+        cursor++;
+        double value = strtod(cursor, &endPtr);
+        if (endPtr != cursor)
+        {
+            valuesPtr[count++] = value;
+            cursor = endPtr;
+        }
+    }
+
+    return count;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reduce a sample to a single number that can be used to judge how much the signal is changing.
+ * JSON vectors are reduced to their magnitude.
+ *
+ * @return The number, or NAN if the sample has no numeric content.
+ */
+//--------------------------------------------------------------------------------------------------
+static double SampleToScalar
+(
+    const Sample_t* samplePtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    switch (samplePtr->dataType)
+    {
+        case DHUBIO_DATA_TYPE_BOOLEAN:
+            return samplePtr->value.boolean ? 1.0 : 0.0;
+
+        case DHUBIO_DATA_TYPE_NUMERIC:
+            return samplePtr->value.numeric;
+
+        case DHUBIO_DATA_TYPE_JSON:
+        {
+            double members[MAX_VECTOR_MEMBERS];
+            size_t count = ExtractJsonNumbers(samplePtr->stringPtr,
+                                              members,
+                                              NUM_ARRAY_MEMBERS(members));
+            if (count == 0)
+            {
+                return NAN;
+            }
+
+            double sumOfSquares = 0.0;
+            for (size_t i = 0; i < count; i++)
+            {
+                sumOfSquares += members[i] * members[i];
+            }
+            return sqrt(sumOfSquares);
+        }
+
+        default:
+            return NAN;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check a sample against a sensor's deadband.  If the sample is passed, it becomes the new
+ * reference that later samples are compared with.
+ *
+ * @return true if the sample should be passed on to the Data Hub, false if it should be dropped.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool PassesDeadband
+(
+    Sensor_t* sensorPtr,
+    const Sample_t* samplePtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Deadband_t* deadbandPtr = &sensorPtr->deadband;
+    double values[MAX_VECTOR_MEMBERS];
+    size_t count;
+
+    // Until a threshold is set, everything passes.
+    if ((deadbandPtr->absolute == 0.0) && (deadbandPtr->relative == 0.0))
+    {
+        return true;
+    }
+
+    switch (samplePtr->dataType)
+    {
+        case DHUBIO_DATA_TYPE_BOOLEAN:
+        case DHUBIO_DATA_TYPE_NUMERIC:
+            values[0] = SampleToScalar(samplePtr);
+            count = 1;
+            break;
+
+        case DHUBIO_DATA_TYPE_JSON:
+            if (deadbandPtr->mode == PSENSOR_DEADBAND_MAGNITUDE)
+            {
+                values[0] = SampleToScalar(samplePtr);
+                count = 1;
+            }
+            else
+            {
+                count = ExtractJsonNumbers(samplePtr->stringPtr, values, MAX_VECTOR_MEMBERS);
+            }
+            break;
+
+        default:
+            // Strings carry no magnitude to compare.
+            return true;
+    }
+
+    double now = Now();
+
+    bool isChanged = (!deadbandPtr->hasLast)
+                  || (count == 0)
+                  || (count != deadbandPtr->lastCount)
+                  || ((deadbandPtr->maxSilence > 0.0)
+                      && ((now - deadbandPtr->lastPassed) >= deadbandPtr->maxSilence));
+
+    for (size_t i = 0; (i < count) && !isChanged; i++)
+    {
+        double threshold = fmax(deadbandPtr->absolute,
+                                deadbandPtr->relative * fabs(deadbandPtr->last[i]));
+
+        // Written this way so that a NAN always counts as a change.
+        isChanged = !(fabs(values[i] - deadbandPtr->last[i]) <= threshold);
+    }
+
+    if (!isChanged)
+    {
+        deadbandPtr->suppressed++;
+        return false;
+    }
+
+    memcpy(deadbandPtr->last, values, count * sizeof(values[0]));
+    deadbandPtr->lastCount = count;
+    deadbandPtr->hasLast = true;
+    deadbandPtr->lastPassed = now;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Feed a new sample into a sensor's adaptive period.
+ *
+ * The sample is compared with the moving average and the moving standard deviation.  If either
+ * the sample's deviation from the average or the standard deviation exceeds the sensitivity,
+ * the signal is moving and the period drops straight to the minimum.  Otherwise, after a few
+ * consecutive flat samples the period is doubled, up to the maximum.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Adapt
+(
+    Sensor_t* sensorPtr,
+    double value
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Adaptive_t* adaptivePtr = &sensorPtr->adaptive;
+
+    if (isnan(value))
+    {
+        return;
+    }
+
+    if (!adaptivePtr->isPrimed)
+    {
+        adaptivePtr->mean = value;
+        adaptivePtr->variance = 0.0;
+        adaptivePtr->isPrimed = true;
+        return;
+    }
+
+    double deviation = value - adaptivePtr->mean;
+    adaptivePtr->mean += ADAPTIVE_ALPHA * deviation;
+    adaptivePtr->variance = (1.0 - ADAPTIVE_ALPHA)
+                          * (adaptivePtr->variance + (ADAPTIVE_ALPHA * deviation * deviation));
+
+    if (!IsAdaptive(sensorPtr))
+    {
+        return;
+    }
+
+    double oldPeriod = ActivePeriod(sensorPtr);
+
+    if (   (fabs(deviation) > adaptivePtr->sensitivity)
+        || (sqrt(adaptivePtr->variance) > adaptivePtr->sensitivity))
+    {
+        adaptivePtr->level = 0;
+        adaptivePtr->flatCount = 0;
+    }
+    else if (++(adaptivePtr->flatCount) >= ADAPTIVE_STRETCH_AFTER)
+    {
+        adaptivePtr->flatCount = 0;
+        if (ldexp(adaptivePtr->minPeriod, adaptivePtr->level) < adaptivePtr->maxPeriod)
+        {
+            adaptivePtr->level++;
+        }
+    }
+
+    double newPeriod = ActivePeriod(sensorPtr);
+
+    if (newPeriod != oldPeriod)
+    {
+        LE_DEBUG("Sensor '%s' period %lf s -> %lf s.", sensorPtr->name, oldPeriod, newPeriod);
+
+        // Move the next sample onto the new period's grid.  If it's being stretched, the sample
+        // that was already scheduled still happens, so a change will be caught just as quickly.
+        if (newPeriod < oldPeriod)
+        {
+            sensorPtr->nextDue = NextGridTime(sensorPtr, Now());
+            Reschedule();
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a single sample straight to the sensor's "value" resource in the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushToHub
+(
+    Sensor_t* sensorPtr,
+    const Sample_t* samplePtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    const char* path = sensorPtr->valuePath;
+    double start = Now();
+
+    switch (samplePtr->dataType)
+    {
+        case DHUBIO_DATA_TYPE_BOOLEAN:
+            dhubIO_PushBoolean(path, samplePtr->timestamp, samplePtr->value.boolean);
+            break;
+
+        case DHUBIO_DATA_TYPE_NUMERIC:
+            dhubIO_PushNumeric(path, samplePtr->timestamp, samplePtr->value.numeric);
+            break;
+
+        case DHUBIO_DATA_TYPE_STRING:
+            dhubIO_PushString(path, samplePtr->timestamp, samplePtr->stringPtr);
+            break;
+
+        case DHUBIO_DATA_TYPE_JSON:
+            dhubIO_PushJson(path, samplePtr->timestamp, samplePtr->stringPtr);
+            break;
+
+        default:
+            LE_FATAL("Unexpected data type %d for sensor '%s'.",
+                     samplePtr->dataType,
+                     sensorPtr->name);
+    }
+
+    RecordTime(&sensorPtr->stats.pushLatency, Now() - start);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push all of a sensor's batched samples to the Data Hub, oldest first, in one burst.
+ */
+//--------------------------------------------------------------------------------------------------
+static void FlushBatch
+(
+    Sensor_t* sensorPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    le_sls_Link_t* linkPtr;
+
+    while ((linkPtr = le_sls_Pop(&sensorPtr->batch)) != NULL)
+    {
+        Sample_t* samplePtr = CONTAINER_OF(linkPtr, Sample_t, link);
+
+        PushToHub(sensorPtr, samplePtr);
+
+        le_mem_Release(samplePtr);
+    }
+
+    sensorPtr->batchCount = 0;
+    sensorPtr->batchDeadline = INFINITY;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Re-arm the shared timer for the earliest due time of all running sensors and pending batch
+ * flushes, or stop it if there's nothing to wait for.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Reschedule
+(
+    void
+)
+//--------------------------------------------------------------------------------------------------
+{
+    double earliest = INFINITY;
+
+    le_dls_Link_t* linkPtr = le_dls_Peek(&SensorList);
+    while (linkPtr != NULL)
+    {
+        Sensor_t* sensorPtr = CONTAINER_OF(linkPtr, Sensor_t, link);
+
+        if (IsRunning(sensorPtr) && (sensorPtr->nextDue < earliest))
+        {
+            earliest = sensorPtr->nextDue;
+        }
+
+        if (sensorPtr->batchDeadline < earliest)
+        {
+            earliest = sensorPtr->batchDeadline;
+        }
+
+        linkPtr = le_dls_PeekNext(&SensorList, linkPtr);
+    }
+
+    le_timer_Stop(SchedulerTimer);
+
+    if (earliest != INFINITY)
+    {
+        double delay = earliest - Now();
+        if (delay < 0.0)
+        {
+            delay = 0.0;
+        }
+
+        le_clk_Time_t interval;
+        interval.sec = (time_t)delay;
+        interval.usec = (delay - interval.sec) * 1000000;
+        le_timer_SetInterval(SchedulerTimer, interval);
+        le_timer_Start(SchedulerTimer);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count a scheduler wakeup and, if an hour has passed, report the wakeups for that hour.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CountWakeup
+(
+    double now
+)
+//--------------------------------------------------------------------------------------------------
+{
+    WakeupCount++;
+
+    if ((now - WakeupWindowStart) >= WAKEUP_WINDOW)
+    {
+        double perHour = WakeupCount * (WAKEUP_WINDOW / (now - WakeupWindowStart));
+
+        LE_INFO("%u scheduler wakeups in the last %.0lf s (%.1lf per hour).",
+                WakeupCount,
+                now - WakeupWindowStart,
+                perHour);
+
+        dhubIO_PushNumeric(WAKEUPS_RESOURCE, DHUBIO_NOW, perHour);
+
+        WakeupCount = 0;
+        WakeupWindowStart = now;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record how long a sample function took, and push the sensor's statistics if it's time to.
+ */
+//--------------------------------------------------------------------------------------------------
+static void FinishSample
+(
+    Sensor_t* sensorPtr,
+    double sampleTime   ///< seconds
+)
+//--------------------------------------------------------------------------------------------------
+{
+    RecordTime(&sensorPtr->stats.sampleTime, sampleTime);
+
+    if ((Now() - sensorPtr->stats.lastPublished) >= STATS_PUBLISH_INTERVAL)
+    {
+        PublishStats(sensorPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Finish off a sample job after the worker is done with it.  Runs on the main thread.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CompleteSampleJob
+(
+    void* param1Ptr,    ///< Sensor_t*
+    void* param2Ptr     ///< Worker_t*
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = param1Ptr;
+    Worker_t* workerPtr = param2Ptr;
+
+    workerPtr->pendingJobs--;
+    sensorPtr->isInFlight = false;
+
+    if (!sensorPtr->isDestroyed)
+    {
+        FinishSample(sensorPtr, sensorPtr->workerSampleTime);
+    }
+
+    // Drop the reference taken by DispatchSample().
+    le_mem_Release(sensorPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run a blocking sensor's sample function.  Runs on a worker thread.
+ *
+ * Anything the sample function pushes is queued to the main thread, followed by
+ * CompleteSampleJob(), so the job completes after all of its samples have been delivered.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunSampleJob
+(
+    void* param1Ptr,    ///< Sensor_t*
+    void* param2Ptr     ///< Worker_t*
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = param1Ptr;
+
+    double start = Now();
+
+    sensorPtr->sampleFunc(sensorPtr, sensorPtr->sampleFuncContext);
+
+    sensorPtr->workerSampleTime = Now() - start;
+
+    le_event_QueueFunctionToThread(MainThread, CompleteSampleJob, sensorPtr, param2Ptr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hand a blocking sensor's sample function to the least busy worker.  A sensor never has more
+ * than one sample in flight; if the previous one hasn't finished, this sample is skipped and
+ * counted as a missed period.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DispatchSample
+(
+    Sensor_t* sensorPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    if (sensorPtr->isInFlight)
+    {
+        sensorPtr->stats.missedPeriods++;
+        return;
+    }
+
+    Worker_t* workerPtr = &Workers[0];
+    for (size_t i = 1; i < WORKER_COUNT; i++)
+    {
+        if (Workers[i].pendingJobs < workerPtr->pendingJobs)
+        {
+            workerPtr = &Workers[i];
+        }
+    }
+
+    // The job holds a reference so the sensor outlives it, even if it gets destroyed meanwhile.
+    le_mem_AddRef(sensorPtr);
+    sensorPtr->isInFlight = true;
+    workerPtr->pendingJobs++;
+
+    le_event_QueueFunctionToThread(workerPtr->thread, RunSampleJob, sensorPtr, workerPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run a group's sample function once for all of its members that are due.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SampleGroup
+(
+    Group_t* groupPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    groupPtr->isDue = false;
+    groupPtr->isSampling = true;
+    groupPtr->passTimestamp = AbsoluteNow();
+
+    double start = Now();
+
+    groupPtr->sampleFunc(groupPtr, groupPtr->sampleFuncContext);
+
+    double sampleTime = Now() - start;
+
+    groupPtr->isSampling = false;
+
+    le_dls_Link_t* linkPtr = le_dls_Peek(&groupPtr->members);
+    while (linkPtr != NULL)
+    {
+        Sensor_t* sensorPtr = CONTAINER_OF(linkPtr, Sensor_t, groupLink);
+
+        if (sensorPtr->isGroupDue)
+        {
+            sensorPtr->isGroupDue = false;
+            FinishSample(sensorPtr, sampleTime);
+        }
+
+        linkPtr = le_dls_PeekNext(&groupPtr->members, linkPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call a sensor's sample function, timing it, and push the sensor's statistics if it's time to.
+ * The sample function of a blocking sensor is handed to a worker thread instead, and a group
+ * member is sampled by a pass of its group's sample function.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TakeSample
+(
+    Sensor_t* sensorPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    if (sensorPtr->groupPtr != NULL)
+    {
+        sensorPtr->isGroupDue = true;
+        SampleGroup(sensorPtr->groupPtr);
+        return;
+    }
+
+    if (sensorPtr->sampleFunc == NULL)
+    {
+        return;
+    }
+
+    if (sensorPtr->isBlocking)
+    {
+        DispatchSample(sensorPtr);
+        return;
+    }
+
+    double start = Now();
+
+    sensorPtr->sampleFunc(sensorPtr, sensorPtr->sampleFuncContext);
+
+    FinishSample(sensorPtr, Now() - start);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer expiry handler function.  Samples every running sensor that is due now or within the
+ * slack window and flushes any batches that are old enough, then re-arms the timer for the next
+ * earliest due time.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleTimerExpiry
+(
+    le_timer_Ref_t timer
+)
+//--------------------------------------------------------------------------------------------------
+{
+    double now = Now();
+
+    CountWakeup(now);
+
+    le_dls_Link_t* linkPtr = le_dls_Peek(&SensorList);
+    while (linkPtr != NULL)
+    {
+        Sensor_t* sensorPtr = CONTAINER_OF(linkPtr, Sensor_t, link);
+
+        // Get the next link now, in case the sample function destroys this sensor.
+        linkPtr = le_dls_PeekNext(&SensorList, linkPtr);
+
+        // Batches whose age limit falls in this wakeup are flushed now.
+        if (sensorPtr->batchDeadline <= (now + SchedulerSlack))
+        {
+            FlushBatch(sensorPtr);
+        }
+
+        // Never pull a sample in by more than half its period, no matter how big the slack is.
+        double period = ActivePeriod(sensorPtr);
+        double slack = fmin(SchedulerSlack, period / 2);
+
+        if (IsRunning(sensorPtr) && (sensorPtr->nextDue <= (now + slack)))
+        {
+            RecordTime(&sensorPtr->stats.lateness, now - sensorPtr->nextDue);
+
+            sensorPtr->nextDue += period;
+
+            // If we've fallen more than a period behind, skip ahead rather than catching up.
+            if (sensorPtr->nextDue <= now)
+            {
+                double next = NextGridTime(sensorPtr, now);
+
+                sensorPtr->stats.missedPeriods +=
+                    (uint32_t)round((next - sensorPtr->nextDue) / period);
+                sensorPtr->nextDue = next;
+            }
+
+            // Group members are sampled together, once all the due members are known.
+            if (sensorPtr->groupPtr != NULL)
+            {
+                sensorPtr->isGroupDue = true;
+                sensorPtr->groupPtr->isDue = true;
+            }
+            else
+            {
+                TakeSample(sensorPtr);
+            }
+        }
+    }
+
+    linkPtr = le_dls_Peek(&GroupList);
+    while (linkPtr != NULL)
+    {
+        Group_t* groupPtr = CONTAINER_OF(linkPtr, Group_t, link);
+
+        linkPtr = le_dls_PeekNext(&GroupList, linkPtr);
+
+        if (groupPtr->isDue)
+        {
+            SampleGroup(groupPtr);
+        }
+    }
+
+    Reschedule();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Take a sample now and start periodic sampling of a sensor on its period grid.
+ *
+ * The first periodic sample is the first grid point at least half a period away, so the sensor
+ * joins the shared phase without taking two samples back-to-back.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartSensor
+(
+    Sensor_t* sensorPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    sensorPtr->nextDue = NextGridTime(sensorPtr, Now() + (ActivePeriod(sensorPtr) / 2));
+
+    if (!IsSuspended(sensorPtr))
+    {
+        TakeSample(sensorPtr);
+    }
+
+    Reschedule();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an "enable" update from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleEnablePush
+(
+    double timestamp,   ///< Don't care about this.
+    bool enable,
+    void* contextPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = contextPtr;
+
+    if (sensorPtr->isEnabled != enable)
+    {
+        sensorPtr->isEnabled = enable;
+
+        if (enable)
+        {
+            // If the period has been set, take a sample and start sampling periodically.
+            if (sensorPtr->period > 0.0)
+            {
+                StartSensor(sensorPtr);
+            }
+        }
+        else
+        {
+            FlushBatch(sensorPtr);
+            Reschedule();
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a "period" update from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandlePeriodPush
+(
+    double timestamp,   ///< Don't care about this.
+    double period,      ///< seconds
+    void* contextPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = contextPtr;
+
+    // If the new value is the same as the old value, ignore the push.
+    if (sensorPtr->period != period)
+    {
+        // Sanity check the period.
+        // If it's invalid, stop sampling and set the period to 0.0.
+        if ((period <= 0.0) || isnan(period))
+        {
+            LE_ERROR("Timer period %lf is out of range. Must be > 0.", period);
+            sensorPtr->period = 0.0;
+            Reschedule();
+        }
+        else if (period > (double)(0x7FFFFFFF)) // Don't know how big time_t is, assume 32-bits.
+        {
+            LE_ERROR("Timer period %lf is too high.", period);
+            sensorPtr->period = 0.0;
+            Reschedule();
+        }
+        else
+        {
+            // The new period is good.
+            double oldPeriod = sensorPtr->period;
+            sensorPtr->period = period;
+
+            if (sensorPtr->isEnabled)
+            {
+                if (oldPeriod == 0)
+                {
+                    // If the old value was zero, take a sample and start sampling now.
+                    StartSensor(sensorPtr);
+                }
+                else
+                {
+                    // Otherwise, move the next sample onto the new period's grid.
+                    sensorPtr->nextDue = NextGridTime(sensorPtr, Now());
+                    Reschedule();
+                }
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a "trigger" update from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleTriggerPush
+(
+    double timestamp,   ///< Don't care about this.
+    void* contextPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = contextPtr;
+
+    if (sensorPtr->isEnabled && !IsSuspended(sensorPtr))
+    {
+        TakeSample(sensorPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a "stats/reset" trigger from the Data Hub.  Clears the sensor's statistics and pushes
+ * the cleared values.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleStatsResetPush
+(
+    double timestamp,   ///< Don't care about this.
+    void* contextPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = contextPtr;
+
+    memset(&sensorPtr->stats, 0, sizeof(sensorPtr->stats));
+
+    PublishStats(sensorPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply a change to a sensor's adaptive period settings.  The period restarts at the minimum,
+ * so the new settings take effect right away.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RestartAdaptivePeriod
+(
+    Sensor_t* sensorPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    sensorPtr->adaptive.level = 0;
+    sensorPtr->adaptive.flatCount = 0;
+
+    if (IsRunning(sensorPtr))
+    {
+        sensorPtr->nextDue = NextGridTime(sensorPtr, Now());
+        Reschedule();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a "minPeriod" update from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleMinPeriodPush
+(
+    double timestamp,   ///< Don't care about this.
+    double period,      ///< seconds
+    void* contextPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = contextPtr;
+
+    if (!(period >= 0.0))  // Also catches NAN.
+    {
+        LE_ERROR("Minimum period %lf is out of range. Must be >= 0.", period);
+        period = 0.0;
+    }
+
+    sensorPtr->adaptive.minPeriod = period;
+    RestartAdaptivePeriod(sensorPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a "maxPeriod" update from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleMaxPeriodPush
+(
+    double timestamp,   ///< Don't care about this.
+    double period,      ///< seconds
+    void* contextPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = contextPtr;
+
+    if (!(period >= 0.0) || (period > (double)(0x7FFFFFFF)))
+    {
+        LE_ERROR("Maximum period %lf is out of range.", period);
+        period = 0.0;
+    }
+
+    sensorPtr->adaptive.maxPeriod = period;
+    RestartAdaptivePeriod(sensorPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a "sensitivity" update from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleSensitivityPush
+(
+    double timestamp,   ///< Don't care about this.
+    double sensitivity, ///< In the sensor's units.
+    void* contextPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = contextPtr;
+
+    if (!(sensitivity >= 0.0))
+    {
+        LE_ERROR("Sensitivity %lf is out of range. Must be >= 0.", sensitivity);
+        sensitivity = 0.0;
+    }
+
+    sensorPtr->adaptive.sensitivity = sensitivity;
+    RestartAdaptivePeriod(sensorPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply a new deadband setting.  The next sample is always passed on, so that it becomes the
+ * reference for the new setting.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetDeadbandParam
+(
+    Sensor_t* sensorPtr,
+    double* paramPtr,
+    const char* paramName,
+    double value
+)
+//--------------------------------------------------------------------------------------------------
+{
+    if (!(value >= 0.0))  // Also catches NAN.
+    {
+        LE_ERROR("Deadband %s %lf is out of range. Must be >= 0.", paramName, value);
+        value = 0.0;
+    }
+
+    *paramPtr = value;
+    sensorPtr->deadband.hasLast = false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a "deadband/absolute" update from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleDeadbandAbsolutePush
+(
+    double timestamp,   ///< Don't care about this.
+    double value,       ///< In the sensor's units.
+    void* contextPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = contextPtr;
+
+    SetDeadbandParam(sensorPtr, &sensorPtr->deadband.absolute, "absolute", value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a "deadband/relative" update from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleDeadbandRelativePush
+(
+    double timestamp,   ///< Don't care about this.
+    double value,       ///< Fraction of the last value passed on.
+    void* contextPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = contextPtr;
+
+    SetDeadbandParam(sensorPtr, &sensorPtr->deadband.relative, "relative", value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a "deadband/maxSilence" update from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleDeadbandMaxSilencePush
+(
+    double timestamp,   ///< Don't care about this.
+    double value,       ///< seconds
+    void* contextPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = contextPtr;
+
+    SetDeadbandParam(sensorPtr, &sensorPtr->deadband.maxSilence, "maxSilence", value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a "stationaryPeriod" update from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleStationaryPeriodPush
+(
+    double timestamp,   ///< Don't care about this.
+    double value,       ///< seconds
+    void* contextPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = contextPtr;
+
+    if (!(value >= 0.0))  // Also catches NAN.
+    {
+        LE_ERROR("Stationary period %lf is out of range. Must be >= 0.", value);
+        return;
+    }
+
+    sensorPtr->motionGate.stationaryPeriod = value;
+
+    // If it's in effect, move the next sample onto the new period's grid.
+    if (IsGated(sensorPtr) && IsRunning(sensorPtr))
+    {
+        sensorPtr->nextDue = NextGridTime(sensorPtr, Now());
+        Reschedule();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create an input resource.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CreateInput
+(
+    const char* path,   ///< Resource path at which to create the input.
+    dhubIO_DataType_t dataType, ///< Data type of the resource.
+    const char* units   ///< Units string of the resource.
+)
+//--------------------------------------------------------------------------------------------------
+{
+    le_result_t result = dhubIO_CreateInput(path, dataType, units);
+    if (result != LE_OK)
+    {
+        if (result == LE_DUPLICATE)
+        {
+            LE_WARN("An input already existed in the Data Hub at path '%s'.", path);
+        }
+        else
+        {
+            LE_FATAL("Failed to create Data Hub input '%s' (%s).", path, LE_RESULT_TXT(result));
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create an output resource.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CreateOutput
+(
+    const char* path,   ///< Resource path at which to create the output.
+    dhubIO_DataType_t dataType, ///< Data type of the resource.
+    const char* units   ///< Units string of the resource.
+)
+//--------------------------------------------------------------------------------------------------
+{
+    le_result_t result = dhubIO_CreateOutput(path, dataType, units);
+    if (result != LE_OK)
+    {
+        if (result == LE_DUPLICATE)
+        {
+            LE_WARN("An output already existed in the Data Hub at path '%s'.", path);
+        }
+        else
+        {
+            LE_FATAL("Failed to create Data Hub output '%s' (%s).", path, LE_RESULT_TXT(result));
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Creates a periodic sensor scaffold for a sensor with a given name.
+ *
+ * This makes the sensor appear in the Data Hub and adds it to the shared sampling scheduler.
+ * The sampleFunc will be called whenever it's time to take a sample.  The sampleFunc must
+ * call one of the psensor_PushX() functions below.  A sensor that will be added to a group
+ * (see psensor_AddToGroup()) doesn't need a sampleFunc of its own, so it can be NULL.
+ *
+ * @return Reference to the new periodic sensor scaffold.
+ */
+//--------------------------------------------------------------------------------------------------
+psensor_Ref_t psensor_Create
+(
+    const char* name,   ///< Name of the periodic sensor, or "" if the app name is sufficient.
+    dhubIO_DataType_t dataType,
+    const char* units,
+    void (*sampleFunc)(psensor_Ref_t ref,
+                       void *context), ///< Sample function to be called back periodically.
+    void *sampleFuncContext  ///< Context pointer to be passed to the sample function
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = le_mem_ForceAlloc(SensorPool);
+
+    sensorPtr->link = LE_DLS_LINK_INIT;
+    sensorPtr->isEnabled = false;
+    sensorPtr->period = 0.0;
+    sensorPtr->nextDue = 0.0;
+
+    sensorPtr->sampleFunc = sampleFunc;
+    sensorPtr->sampleFuncContext = sampleFuncContext;
+
+    if (le_utf8_Copy(sensorPtr->name, name, sizeof(sensorPtr->name), NULL) != LE_OK)
+    {
+        LE_FATAL("Sensor name too long (%s)", name);
+    }
+
+    BuildResourcePath(sensorPtr->valuePath, sizeof(sensorPtr->valuePath), sensorPtr, "value");
+
+    sensorPtr->batchMaxCount = 0;
+    sensorPtr->batchMaxAge = 0.0;
+    sensorPtr->batchCount = 0;
+    sensorPtr->batchDeadline = INFINITY;
+    sensorPtr->batch = LE_SLS_LIST_INIT;
+
+    le_dls_Queue(&SensorList, &sensorPtr->link);
+
+    memset(&sensorPtr->stats, 0, sizeof(sensorPtr->stats));
+    sensorPtr->areStatsCreated = false;
+    memset(&sensorPtr->adaptive, 0, sizeof(sensorPtr->adaptive));
+    memset(&sensorPtr->deadband, 0, sizeof(sensorPtr->deadband));
+    memset(&sensorPtr->motionGate, 0, sizeof(sensorPtr->motionGate));
+
+    sensorPtr->groupPtr = NULL;
+    sensorPtr->groupLink = LE_DLS_LINK_INIT;
+    sensorPtr->isGroupDue = false;
+
+    sensorPtr->isBlocking = false;
+    sensorPtr->isInFlight = false;
+    sensorPtr->isDestroyed = false;
+    sensorPtr->workerSampleTime = 0.0;
+
+    // Create the Data Hub resources "value", "enable", "period", and "trigger" for this sensor.
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
+    CreateInput(sensorPtr->valuePath, dataType, units);
+
+    BuildResourcePath(path, sizeof(path), sensorPtr, "enable");
+    CreateOutput(path, DHUBIO_DATA_TYPE_BOOLEAN, "");
+    sensorPtr->enableHandlerRef = dhubIO_AddBooleanPushHandler(path, HandleEnablePush, sensorPtr);
+
+    BuildResourcePath(path, sizeof(path), sensorPtr, "period");
+    CreateOutput(path, DHUBIO_DATA_TYPE_NUMERIC, "s");
+    sensorPtr->periodHandlerRef = dhubIO_AddNumericPushHandler(path, HandlePeriodPush, sensorPtr);
+
+    BuildResourcePath(path, sizeof(path), sensorPtr, "trigger");
+    CreateOutput(path, DHUBIO_DATA_TYPE_TRIGGER, "");
+    sensorPtr->triggerHandlerRef = dhubIO_AddTriggerPushHandler(path, HandleTriggerPush, sensorPtr);
+    dhubIO_MarkOptional(path);
+
+    // Create the "stats/reset" output.  The "stats/..." inputs are created when first published.
+    BuildResourcePath(path, sizeof(path), sensorPtr, "stats/reset");
+    CreateOutput(path, DHUBIO_DATA_TYPE_TRIGGER, "");
+    sensorPtr->statsResetHandlerRef = dhubIO_AddTriggerPushHandler(path,
+                                                                  HandleStatsResetPush,
+                                                                  sensorPtr);
+    dhubIO_MarkOptional(path);
+
+    return sensorPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Creates a periodic sensor scaffold for a sensor with a given name that produces JSON samples.
+ *
+ * This makes the sensor appear in the Data Hub and adds it to the shared sampling scheduler.
+ * The sampleFunc will be called whenever it's time to take a sample.  The sampleFunc is supposed
+ * to call psensor_PushJson() to push the JSON sample.
+ *
+ * @return Reference to the new periodic sensor scaffold.
+ */
+//--------------------------------------------------------------------------------------------------
+psensor_Ref_t psensor_CreateJson
+(
+    const char* name,   ///< Name of the periodic sensor, or "" if the app name is sufficient.
+    const char* jsonExample,    ///< String containing example JSON value.
+    void (*sampleFunc)(psensor_Ref_t ref,
+                       void *context), ///< Sample function to be called back periodically.
+    void *sampleFuncContext  ///< Context pointer to be passed to the sample function
+)
+//--------------------------------------------------------------------------------------------------
+{
+    psensor_Ref_t ref = psensor_Create(name,
+                                       DHUBIO_DATA_TYPE_JSON,
+                                       "", // units
+                                       sampleFunc,
+                                       sampleFuncContext);
+
+    dhubIO_SetJsonExample(ref->valuePath, jsonExample);
+
+    return ref;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Creates periodic sensor scaffolds for all the sensors described in a table, in one pass.
+ *
+ * Each sensor is created as if by psensor_Create() (or psensor_CreateJson(), if the descriptor
+ * has a jsonExample), and is given the descriptor's default period, if any.
+ */
+//--------------------------------------------------------------------------------------------------
+void psensor_CreateFromTable
+(
+    const psensor_Descriptor_t* table,  ///< Array of sensor descriptors.
+    size_t count,                       ///< Number of entries in the table.
+    psensor_Ref_t* refs                 ///< [OUT] Array of count references (or NULL).
+)
+//--------------------------------------------------------------------------------------------------
+{
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const psensor_Descriptor_t* descPtr = &table[i];
+
+        Sensor_t* sensorPtr = psensor_Create(descPtr->name,
+                                             descPtr->dataType,
+                                             (descPtr->units != NULL) ? descPtr->units : "",
+                                             descPtr->sampleFunc,
+                                             descPtr->sampleFuncContext);
+
+        if (descPtr->jsonExample != NULL)
+        {
+            dhubIO_SetJsonExample(sensorPtr->valuePath, descPtr->jsonExample);
+        }
+
+        if (descPtr->defaultPeriod > 0.0)
+        {
+            BuildResourcePath(path, sizeof(path), sensorPtr, "period");
+            dhubIO_SetNumericDefault(path, descPtr->defaultPeriod);
+        }
+
+        if (refs != NULL)
+        {
+            refs[i] = sensorPtr;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Removes a periodic sensor scaffold and all associated resources
+ */
+//--------------------------------------------------------------------------------------------------
+void psensor_Destroy
+(
+    psensor_Ref_t *ref
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr;
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
+
+    LE_ASSERT(NULL != ref);
+
+    sensorPtr = *ref;
+    *ref = NULL;
+
+    if (sensorPtr)
+    {
+        sensorPtr->isEnabled = false;
+
+        // Deliver anything still batched, then remove it from the scheduler.
+        FlushBatch(sensorPtr);
+        le_dls_Remove(&SensorList, &sensorPtr->link);
+        Reschedule();
+
+        if (sensorPtr->groupPtr != NULL)
+        {
+            le_dls_Remove(&sensorPtr->groupPtr->members, &sensorPtr->groupLink);
+            sensorPtr->groupPtr = NULL;
+        }
+
+        // Deregister handlers and remove resources
+        if (sensorPtr->adaptive.isCreated)
+        {
+            BuildResourcePath(path, sizeof(path), sensorPtr, "minPeriod");
+            dhubIO_RemoveNumericPushHandler(sensorPtr->adaptive.minHandlerRef);
+            dhubIO_DeleteResource(path);
+
+            BuildResourcePath(path, sizeof(path), sensorPtr, "maxPeriod");
+            dhubIO_RemoveNumericPushHandler(sensorPtr->adaptive.maxHandlerRef);
+            dhubIO_DeleteResource(path);
+
+            BuildResourcePath(path, sizeof(path), sensorPtr, "sensitivity");
+            dhubIO_RemoveNumericPushHandler(sensorPtr->adaptive.sensitivityHandlerRef);
+            dhubIO_DeleteResource(path);
+        }
+
+        if (sensorPtr->deadband.isCreated)
+        {
+            BuildResourcePath(path, sizeof(path), sensorPtr, "deadband/absolute");
+            dhubIO_RemoveNumericPushHandler(sensorPtr->deadband.absoluteHandlerRef);
+            dhubIO_DeleteResource(path);
+
+            BuildResourcePath(path, sizeof(path), sensorPtr, "deadband/relative");
+            dhubIO_RemoveNumericPushHandler(sensorPtr->deadband.relativeHandlerRef);
+            dhubIO_DeleteResource(path);
+
+            BuildResourcePath(path, sizeof(path), sensorPtr, "deadband/maxSilence");
+            dhubIO_RemoveNumericPushHandler(sensorPtr->deadband.maxSilenceHandlerRef);
+            dhubIO_DeleteResource(path);
+
+            BuildResourcePath(path, sizeof(path), sensorPtr, "deadband/suppressed");
+            dhubIO_DeleteResource(path);
+        }
+
+        if (sensorPtr->motionGate.isCreated)
+        {
+            BuildResourcePath(path, sizeof(path), sensorPtr, "stationaryPeriod");
+            dhubIO_RemoveNumericPushHandler(sensorPtr->motionGate.stationaryPeriodHandlerRef);
+            dhubIO_DeleteResource(path);
+        }
+
+        BuildResourcePath(path, sizeof(path), sensorPtr, "stats/reset");
+        dhubIO_RemoveTriggerPushHandler(sensorPtr->statsResetHandlerRef);
+        dhubIO_DeleteResource(path);
+
+        if (sensorPtr->areStatsCreated)
+        {
+            BuildResourcePath(path, sizeof(path), sensorPtr, "stats/lateness");
+            dhubIO_DeleteResource(path);
+            BuildResourcePath(path, sizeof(path), sensorPtr, "stats/sampleTime");
+            dhubIO_DeleteResource(path);
+            BuildResourcePath(path, sizeof(path), sensorPtr, "stats/pushLatency");
+            dhubIO_DeleteResource(path);
+            BuildResourcePath(path, sizeof(path), sensorPtr, "stats/missed");
+            dhubIO_DeleteResource(path);
+        }
+
+        BuildResourcePath(path, sizeof(path), sensorPtr, "trigger");
+        dhubIO_RemoveTriggerPushHandler(sensorPtr->triggerHandlerRef);
+        dhubIO_DeleteResource(path);
+
+        BuildResourcePath(path, sizeof(path), sensorPtr, "period");
+        dhubIO_RemoveNumericPushHandler(sensorPtr->periodHandlerRef);
+        dhubIO_DeleteResource(path);
+
+        BuildResourcePath(path, sizeof(path), sensorPtr, "enable");
+        dhubIO_RemoveBooleanPushHandler(sensorPtr->enableHandlerRef);
+        dhubIO_DeleteResource(path);
+
+        dhubIO_DeleteResource(sensorPtr->valuePath);
+
+        // A sample job still in flight holds its own reference, and will drop anything the
+        // sample function pushes from now on.
+        sensorPtr->isDestroyed = true;
+        le_mem_Release(sensorPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current absolute time, in seconds since the Epoch.
+ */
+//--------------------------------------------------------------------------------------------------
+static double AbsoluteNow
+(
+    void
+)
+//--------------------------------------------------------------------------------------------------
+{
+    le_clk_Time_t now = le_clk_GetAbsoluteTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deliver a sample that a worker thread queued to the main thread.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DeliverQueued
+(
+    void* param1Ptr,    ///< Sensor_t*
+    void* param2Ptr     ///< Sample_t*
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = param1Ptr;
+    Sample_t* samplePtr = param2Ptr;
+
+    if (sensorPtr->isDestroyed)
+    {
+        le_mem_Release(samplePtr);
+    }
+    else
+    {
+        Deliver(sensorPtr, samplePtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deliver a sample pushed by the client from whichever thread it was pushed on.  Samples pushed
+ * by a blocking sensor's sample function (on a worker thread) are queued to the main thread,
+ * which owns all the sensor state.
+ *
+ * @note The sample object is consumed by this function.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DeliverFromAnyThread
+(
+    Sensor_t* sensorPtr,
+    Sample_t* samplePtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    if (le_thread_GetCurrent() == MainThread)
+    {
+        Group_t* groupPtr = sensorPtr->groupPtr;
+
+        if ((groupPtr != NULL) && groupPtr->isSampling)
+        {
+            // Members that aren't due in this pass keep to their own periods.
+            if (!sensorPtr->isGroupDue)
+            {
+                le_mem_Release(samplePtr);
+                return;
+            }
+
+            // Everything pushed in one pass gets the same timestamp.
+            if (samplePtr->timestamp == DHUBIO_NOW)
+            {
+                samplePtr->timestamp = groupPtr->passTimestamp;
+            }
+        }
+
+        Deliver(sensorPtr, samplePtr);
+    }
+    else
+    {
+        // "Now" has to be captured before the sample waits in the main thread's queue.
+        if (samplePtr->timestamp == DHUBIO_NOW)
+        {
+            samplePtr->timestamp = AbsoluteNow();
+        }
+
+        le_event_QueueFunctionToThread(MainThread, DeliverQueued, sensorPtr, samplePtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deliver a sample pushed by the client.  If the sensor is batching, the sample is added to the
+ * batch (and the batch is flushed if full), otherwise it goes straight to the Data Hub.
+ *
+ * @note The sample object is consumed (queued or released) by this function.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Deliver
+(
+    Sensor_t* sensorPtr,
+    Sample_t* samplePtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    // A sample that was already on its way when the sensor was suspended goes no further.
+    if (IsSuspended(sensorPtr))
+    {
+        le_mem_Release(samplePtr);
+        return;
+    }
+
+    if (sensorPtr->adaptive.isCreated)
+    {
+        Adapt(sensorPtr, SampleToScalar(samplePtr));
+    }
+
+    // Samples that don't clear the deadband never leave this process.
+    if (sensorPtr->deadband.isCreated && !PassesDeadband(sensorPtr, samplePtr))
+    {
+        le_mem_Release(samplePtr);
+        return;
+    }
+
+    if (sensorPtr->batchMaxCount == 0)
+    {
+        PushToHub(sensorPtr, samplePtr);
+        le_mem_Release(samplePtr);
+        return;
+    }
+
+    // Batched samples are pushed later, so "now" has to be captured now.
+    if (samplePtr->timestamp == DHUBIO_NOW)
+    {
+        samplePtr->timestamp = AbsoluteNow();
+    }
+
+    le_sls_Queue(&sensorPtr->batch, &samplePtr->link);
+    sensorPtr->batchCount++;
+
+    if (sensorPtr->batchCount >= sensorPtr->batchMaxCount)
+    {
+        FlushBatch(sensorPtr);
+        Reschedule();
+    }
+    else if (sensorPtr->batchCount == 1)
+    {
+        // First sample in the batch starts the age limit clock.
+        sensorPtr->batchDeadline = Now() + sensorPtr->batchMaxAge;
+        Reschedule();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Free a sample's heap copy of a long string or JSON value, when the sample is released.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SampleDestructor
+(
+    void* objPtr    ///< Sample_t*
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sample_t* samplePtr = objPtr;
+
+    if ((samplePtr->stringPtr != NULL) && (samplePtr->stringPtr != samplePtr->value.string))
+    {
+        free(samplePtr->stringPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deliver a string or JSON sample pushed by the client.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DeliverString
+(
+    Sensor_t* sensorPtr,
+    dhubIO_DataType_t dataType,
+    double timestamp,
+    const char* value
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sample_t* samplePtr = le_mem_ForceAlloc(SamplePool);
+
+    samplePtr->link = LE_SLS_LINK_INIT;
+    samplePtr->dataType = dataType;
+    samplePtr->timestamp = timestamp;
+    samplePtr->stringPtr = samplePtr->value.string;
+
+    if (le_utf8_Copy(samplePtr->value.string, value, sizeof(samplePtr->value.string), NULL)
+        != LE_OK)
+    {
+        // Too long to hold in the sample itself.  The copy is freed with the sample (see
+        // SampleDestructor()), so it takes the same path as any other sample.
+        samplePtr->stringPtr = strdup(value);
+        LE_ASSERT(samplePtr->stringPtr != NULL);
+    }
+
+    DeliverFromAnyThread(sensorPtr, samplePtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a boolean sample to the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+void psensor_PushBoolean
+(
+    psensor_Ref_t ref,  ///< Reference returned by psensor_Create().
+    double timestamp,   ///< Timestamp (or 0 = now).
+    bool value
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sample_t* samplePtr = le_mem_ForceAlloc(SamplePool);
+
+    samplePtr->link = LE_SLS_LINK_INIT;
+    samplePtr->dataType = DHUBIO_DATA_TYPE_BOOLEAN;
+    samplePtr->timestamp = timestamp;
+    samplePtr->value.boolean = value;
+    samplePtr->stringPtr = NULL;
+
+    DeliverFromAnyThread(ref, samplePtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a numeric sample to the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+void psensor_PushNumeric
+(
+    psensor_Ref_t ref,  ///< Reference returned by psensor_Create().
+    double timestamp,   ///< Timestamp (or 0 = now).
+    double value
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sample_t* samplePtr = le_mem_ForceAlloc(SamplePool);
+
+    samplePtr->link = LE_SLS_LINK_INIT;
+    samplePtr->dataType = DHUBIO_DATA_TYPE_NUMERIC;
+    samplePtr->timestamp = timestamp;
+    samplePtr->value.numeric = value;
+    samplePtr->stringPtr = NULL;
+
+    DeliverFromAnyThread(ref, samplePtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a string sample to the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+void psensor_PushString
+(
+    psensor_Ref_t ref,  ///< Reference returned by psensor_Create().
+    double timestamp,   ///< Timestamp (or 0 = now).
+    const char* value
+)
+//--------------------------------------------------------------------------------------------------
+{
+    DeliverString(ref, DHUBIO_DATA_TYPE_STRING, timestamp, value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a JSON sample to the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+void psensor_PushJson
+(
+    psensor_Ref_t ref,  ///< Reference returned by psensor_Create().
+    double timestamp,   ///< Timestamp (or 0 = now).
+    const char* value
+)
+//--------------------------------------------------------------------------------------------------
+{
+    DeliverString(ref, DHUBIO_DATA_TYPE_JSON, timestamp, value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Enable or disable batching of a sensor's samples.
+ *
+ * While batching, pushed samples are held (with their timestamps) and delivered to the Data Hub
+ * in one burst when maxCount samples have accumulated or the oldest sample is maxAgeMs old,
+ * whichever comes first.  A maxCount of 0 or 1 disables batching (flushing anything pending).
+ */
+//--------------------------------------------------------------------------------------------------
+void psensor_SetBatching
+(
+    psensor_Ref_t ref,  ///< Reference returned by psensor_Create().
+    uint32_t maxCount,  ///< Maximum number of samples per batch.
+    uint32_t maxAgeMs   ///< Maximum age (ms) of the oldest sample in a batch.
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = ref;
+
+    FlushBatch(sensorPtr);
+
+    sensorPtr->batchMaxCount = (maxCount > 1) ? maxCount : 0;
+    sensorPtr->batchMaxAge = maxAgeMs / 1000.0;
+
+    Reschedule();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Immediately push any batched samples to the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+void psensor_Flush
+(
+    psensor_Ref_t ref   ///< Reference returned by psensor_Create().
+)
+//--------------------------------------------------------------------------------------------------
+{
+    FlushBatch(ref);
+    Reschedule();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give a sensor an adaptive sampling period.
+ *
+ * Creates the @b "minPeriod", @b "maxPeriod" (both in seconds) and @b "sensitivity" outputs for
+ * the sensor.  Once all three have been set, the sensor is sampled as slowly as maxPeriod while
+ * its signal is flat and as quickly as minPeriod while its signal is moving by more than the
+ * sensitivity (in the sensor's units; for JSON vector samples, in units of vector magnitude).
+ * Until then, the sensor is sampled at its regular period.
+ */
+//--------------------------------------------------------------------------------------------------
+void psensor_EnableAdaptivePeriod
+(
+    psensor_Ref_t ref   ///< Reference returned by psensor_Create().
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = ref;
+    Adaptive_t* adaptivePtr = &sensorPtr->adaptive;
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
+
+    if (adaptivePtr->isCreated)
+    {
+        return;
+    }
+
+    BuildResourcePath(path, sizeof(path), sensorPtr, "minPeriod");
+    CreateOutput(path, DHUBIO_DATA_TYPE_NUMERIC, "s");
+    adaptivePtr->minHandlerRef = dhubIO_AddNumericPushHandler(path,
+                                                              HandleMinPeriodPush,
+                                                              sensorPtr);
+    dhubIO_MarkOptional(path);
+
+    BuildResourcePath(path, sizeof(path), sensorPtr, "maxPeriod");
+    CreateOutput(path, DHUBIO_DATA_TYPE_NUMERIC, "s");
+    adaptivePtr->maxHandlerRef = dhubIO_AddNumericPushHandler(path,
+                                                              HandleMaxPeriodPush,
+                                                              sensorPtr);
+    dhubIO_MarkOptional(path);
+
+    BuildResourcePath(path, sizeof(path), sensorPtr, "sensitivity");
+    CreateOutput(path, DHUBIO_DATA_TYPE_NUMERIC, "");
+    adaptivePtr->sensitivityHandlerRef = dhubIO_AddNumericPushHandler(path,
+                                                                      HandleSensitivityPush,
+                                                                      sensorPtr);
+    dhubIO_MarkOptional(path);
+
+    adaptivePtr->isCreated = true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give a sensor a deadband filter, so that samples that carry no significant change are dropped
+ * before they are pushed to the Data Hub.
+ *
+ * Creates the @b "deadband/absolute" (in the sensor's units), @b "deadband/relative" (fraction
+ * of the last value pushed) and @b "deadband/maxSilence" (seconds) outputs, and the
+ * @b "deadband/suppressed" input that counts the samples dropped.  Until absolute or relative is
+ * set, every sample is pushed.
+ */
+//--------------------------------------------------------------------------------------------------
+void psensor_EnableDeadband
+(
+    psensor_Ref_t ref,              ///< Reference returned by psensor_Create().
+    psensor_DeadbandMode_t mode     ///< How JSON vector samples are compared.
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = ref;
+    Deadband_t* deadbandPtr = &sensorPtr->deadband;
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
+
+    deadbandPtr->mode = mode;
+    deadbandPtr->hasLast = false;
+
+    if (deadbandPtr->isCreated)
+    {
+        return;
+    }
+
+    BuildResourcePath(path, sizeof(path), sensorPtr, "deadband/absolute");
+    CreateOutput(path, DHUBIO_DATA_TYPE_NUMERIC, "");
+    deadbandPtr->absoluteHandlerRef = dhubIO_AddNumericPushHandler(path,
+                                                                   HandleDeadbandAbsolutePush,
+                                                                   sensorPtr);
+    dhubIO_MarkOptional(path);
+
+    BuildResourcePath(path, sizeof(path), sensorPtr, "deadband/relative");
+    CreateOutput(path, DHUBIO_DATA_TYPE_NUMERIC, "");
+    deadbandPtr->relativeHandlerRef = dhubIO_AddNumericPushHandler(path,
+                                                                   HandleDeadbandRelativePush,
+                                                                   sensorPtr);
+    dhubIO_MarkOptional(path);
+
+    BuildResourcePath(path, sizeof(path), sensorPtr, "deadband/maxSilence");
+    CreateOutput(path, DHUBIO_DATA_TYPE_NUMERIC, "s");
+    deadbandPtr->maxSilenceHandlerRef = dhubIO_AddNumericPushHandler(path,
+                                                                     HandleDeadbandMaxSilencePush,
+                                                                     sensorPtr);
+    dhubIO_MarkOptional(path);
+
+    BuildResourcePath(path, sizeof(path), sensorPtr, "deadband/suppressed");
+    CreateInput(path, DHUBIO_DATA_TYPE_NUMERIC, "");
+
+    deadbandPtr->isCreated = true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Throttle a sensor while the device is stationary (see psensor_SetStationary()).
+ *
+ * Creates the @b "stationaryPeriod" output (seconds).  While the device is stationary, the sensor
+ * is sampled at the longer of its active period and stationaryPeriod, or, if stationaryPeriod is
+ * 0, not sampled at all and its pushes are dropped.
+ */
+//--------------------------------------------------------------------------------------------------
+void psensor_EnableMotionGating
+(
+    psensor_Ref_t ref,              ///< Reference returned by psensor_Create().
+    double defaultStationaryPeriod  ///< Default for "stationaryPeriod" (seconds, 0 = suspend).
+)
+//--------------------------------------------------------------------------------------------------
+{
+    Sensor_t* sensorPtr = ref;
+    MotionGate_t* gatePtr = &sensorPtr->motionGate;
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
+
+    if (gatePtr->isCreated)
+    {
+        return;
+    }
+
+    LE_ASSERT(defaultStationaryPeriod >= 0.0);
+    gatePtr->stationaryPeriod = defaultStationaryPeriod;
+
+    BuildResourcePath(path, sizeof(path), sensorPtr, "stationaryPeriod");
+    CreateOutput(path, DHUBIO_DATA_TYPE_NUMERIC, "s");
+    gatePtr->stationaryPeriodHandlerRef = dhubIO_AddNumericPushHandler(path,
+                                                                      HandleStationaryPeriodPush,
+                                                                      sensorPtr);
+    dhubIO_SetNumericDefault(path, defaultStationaryPeriod);
+    dhubIO_MarkOptional(path);
+
+    gatePtr->isCreated = true;
+
+    if (IsStationary && IsRunning(sensorPtr))
+    {
+        sensorPtr->nextDue = NextGridTime(sensorPtr, Now());
+        Reschedule();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tell the scheduler whether the device is stationary.  Motion-gated sensors are throttled while
+ * it is, and the motion handlers are called whenever this changes.
+ *
+ * Gated sensors are moved onto their new period's grid.  When the device starts moving, the
+ * motion handlers are called first, so that anything the sensors need is back before they are
+ * next sampled.
+ */
+//--------------------------------------------------------------------------------------------------
+void psensor_SetStationary
+(
+    bool isStationary
+)
+//--------------------------------------------------------------------------------------------------
+{
+    if (isStationary == IsStationary)
+    {
+        return;
+    }
+
+    LE_INFO("Device is %s.", isStationary ? "stationary" : "moving");
+
+    IsStationary = isStationary;
+
+    for (size_t i = 0; i < MotionHandlerCount; i++)
+    {
+        MotionHandlers[i].func(isStationary, MotionHandlers[i].contextPtr);
+    }
 
-    if (sensorPtr->isEnabled != enable)
+    double now = Now();
+
+    le_dls_Link_t* linkPtr = le_dls_Peek(&SensorList);
+    while (linkPtr != NULL)
     {
-        sensorPtr->isEnabled = enable;
+        Sensor_t* sensorPtr = CONTAINER_OF(linkPtr, Sensor_t, link);
 
-        if (enable)
+        if (sensorPtr->motionGate.isCreated)
         {
-            // If the period has been set, take a sample and start the timer.
-            if (sensorPtr->period > 0.0)
+            // Anything batched while moving is delivered before the sensor goes quiet.
+            if (isStationary)
             {
-                sensorPtr->sampleFunc(sensorPtr, sensorPtr->sampleFuncContext);
-                le_timer_Start(sensorPtr->timer);
+                FlushBatch(sensorPtr);
+            }
+
+            if (IsRunning(sensorPtr))
+            {
+                sensorPtr->nextDue = NextGridTime(sensorPtr, now);
             }
         }
-        else
-        {
-            le_timer_Stop(sensorPtr->timer);
-        }
+
+        linkPtr = le_dls_PeekNext(&SensorList, linkPtr);
     }
+
+    Reschedule();
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Handle a "period" update from the Data Hub.
+ * Check whether the device is stationary, as last set by psensor_SetStationary().
+ *
+ * @return true if the device is stationary.
  */
 //--------------------------------------------------------------------------------------------------
-static void HandlePeriodPush
+bool psensor_IsStationary
 (
-    double timestamp,   ///< Don't care about this.
-    double period,      ///< seconds
-    void* contextPtr
+    void
 )
 //--------------------------------------------------------------------------------------------------
 {
-    Sensor_t* sensorPtr = contextPtr;
-
-    // If the new value is the same as the old value, ignore the push.
-    if (sensorPtr->period != period)
-    {
-        // Sanity check the period.
-        // If it's invalid, stop the timer and set the period to 0.0.
-        if ((period <= 0.0) || isnan(period))
-        {
-            LE_ERROR("Timer period %lf is out of range. Must be > 0.", period);
-            le_timer_Stop(sensorPtr->timer);
-            sensorPtr->period = 0.0;
-        }
-        else if (period > (double)(0x7FFFFFFF)) // Don't know how big time_t is, assume 32-bits.
-        {
-            LE_ERROR("Timer period %lf is too high.", period);
-            le_timer_Stop(sensorPtr->timer);
-            sensorPtr->period = 0.0;
-        }
-        else
-        {
-            // The new period is good.
-            // Set the timer's interval to the period.
-            le_clk_Time_t interval;
-            interval.sec = (time_t)period;
-            interval.usec = (period - interval.sec) * 1000000;
-            le_timer_SetInterval(sensorPtr->timer, interval);
-
-            // If the old value was zero and the sensor is enabled, take a sample and
-            // start the timer now.
-            if ((sensorPtr->period == 0) && sensorPtr->isEnabled)
-            {
-                sensorPtr->sampleFunc(sensorPtr, sensorPtr->sampleFuncContext);
-                le_timer_Start(sensorPtr->timer);
-            }
-
-            sensorPtr->period = period;
-        }
-    }
+    return IsStationary;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Handle a "trigger" update from the Data Hub.
+ * Register a function to be called (on the main thread) whenever psensor_SetStationary() changes
+ * the device's state.
  */
 //--------------------------------------------------------------------------------------------------
-static void HandleTriggerPush
+void psensor_AddMotionHandler
 (
-    double timestamp,   ///< Don't care about this.
+    psensor_MotionHandlerFunc_t handlerFunc,
     void* contextPtr
 )
 //--------------------------------------------------------------------------------------------------
 {
-    Sensor_t* sensorPtr = contextPtr;
+    LE_ASSERT(handlerFunc != NULL);
+    LE_ASSERT(MotionHandlerCount < MAX_MOTION_HANDLERS);
 
-    if (sensorPtr->isEnabled)
-    {
-        sensorPtr->sampleFunc(sensorPtr, sensorPtr->sampleFuncContext);
-    }
+    MotionHandlers[MotionHandlerCount].func = handlerFunc;
+    MotionHandlers[MotionHandlerCount].contextPtr = contextPtr;
+    MotionHandlerCount++;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Build up the path to a resource from the sensor name and the resource (leaf) name.
+ * Creates a sensor group.
+ *
+ * Sensors added to the group (using psensor_AddToGroup()) keep their own Data Hub resources,
+ * periods and enables, but instead of each having its sample function called, the group's
+ * sampleFunc is called once for all the members that are due in the same wakeup.  It should read
+ * the members in a single pass and push a sample to each of them.  Samples pushed with a
+ * timestamp of 0 (now) during the pass all get the same timestamp.
+ *
+ * @return Reference to the new group.
  */
 //--------------------------------------------------------------------------------------------------
-static void BuildResourcePath
+psensor_GroupRef_t psensor_CreateGroup
 (
-    char* pathBuffPtr,  ///< Ptr to the buffer into which the path will be built.
-    size_t pathBuffSize,    ///< Size (in bytes) of the buffer pointed to by pathBuffPtr.
-    Sensor_t* sensorPtr, ///< Ptr to the Sensor scaffold object.
-    const char* resourceName  ///< E.g., "value" or "enable"
+    void (*sampleFunc)(psensor_GroupRef_t group,
+                       void *context), ///< Sample function to be called back for each pass.
+    void *sampleFuncContext  ///< Context pointer to be passed to the sample function
 )
 //--------------------------------------------------------------------------------------------------
 {
-    if (sensorPtr->name[0] == '\0')
-    {
-        LE_ASSERT(LE_OK == le_utf8_Copy(pathBuffPtr, resourceName, pathBuffSize, NULL));
-    }
-    else
-    {
-        LE_ASSERT(snprintf(pathBuffPtr, pathBuffSize, "%s/%s", sensorPtr->name, resourceName)
-                  < pathBuffSize);
-    }
+    Group_t* groupPtr = le_mem_ForceAlloc(GroupPool);
+
+    groupPtr->link = LE_DLS_LINK_INIT;
+    groupPtr->sampleFunc = sampleFunc;
+    groupPtr->sampleFuncContext = sampleFuncContext;
+    groupPtr->members = LE_DLS_LIST_INIT;
+    groupPtr->isDue = false;
+    groupPtr->isSampling = false;
+    groupPtr->passTimestamp = 0.0;
+
+    le_dls_Queue(&GroupList, &groupPtr->link);
+
+    return groupPtr;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Create an output resource.
+ * Adds a sensor to a group.  A sensor can only be in one group, and group members can't be
+ * blocking (see psensor_SetBlocking()).
  */
 //--------------------------------------------------------------------------------------------------
-static void CreateOutput
+void psensor_AddToGroup
 (
-    const char* path,   ///< Resource path at which to create the output.
-    dhubIO_DataType_t dataType, ///< Data type of the resource.
-    const char* units   ///< Units string of the resource.
+    psensor_GroupRef_t group,   ///< Reference returned by psensor_CreateGroup().
+    psensor_Ref_t ref           ///< Reference returned by psensor_Create().
 )
 //--------------------------------------------------------------------------------------------------
 {
-    le_result_t result = dhubIO_CreateOutput(path, dataType, units);
-    if (result != LE_OK)
-    {
-        if (result == LE_DUPLICATE)
-        {
-            LE_WARN("An output already existed in the Data Hub at path '%s'.", path);
-        }
-        else
-        {
-            LE_FATAL("Failed to create Data Hub output '%s' (%s).", path, LE_RESULT_TXT(result));
-        }
-    }
+    Sensor_t* sensorPtr = ref;
+
+    LE_ASSERT(sensorPtr->groupPtr == NULL);
+    LE_ASSERT(!sensorPtr->isBlocking);
+
+    sensorPtr->groupPtr = group;
+    le_dls_Queue(&group->members, &sensorPtr->groupLink);
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Creates a periodic sensor scaffold for a sensor with a given name.
+ * Check whether a group member is being sampled in the group's current pass.  A group's sample
+ * function can use this to skip reading members that aren't due (anything pushed to them is
+ * dropped anyway).
  *
- * This makes the sensor appear in the Data Hub and creates a timer for that sensor.
- * The sampleFunc will be called whenever it's time to take a sample.  The sampleFunc must
- * call one of the psensor_PushX() functions below.
- *
- * @return Reference to the new periodic sensor scaffold.
+ * @return true if the sensor should be sampled now.
  */
 //--------------------------------------------------------------------------------------------------
-psensor_Ref_t psensor_Create
+bool psensor_IsSampling
 (
-    const char* name,   ///< Name of the periodic sensor, or "" if the app name is sufficient.
-    dhubIO_DataType_t dataType,
-    const char* units,
-    void (*sampleFunc)(psensor_Ref_t ref,
-                       void *context), ///< Sample function to be called back periodically.
-    void *sampleFuncContext  ///< Context pointer to be passed to the sample function
+    psensor_Ref_t ref   ///< Reference returned by psensor_Create().
 )
 //--------------------------------------------------------------------------------------------------
 {
-    Sensor_t* sensorPtr = le_mem_ForceAlloc(SensorPool);
+    Sensor_t* sensorPtr = ref;
 
-    sensorPtr->isEnabled = false;
-    sensorPtr->period = 0.0;
+    return (sensorPtr->groupPtr == NULL) || sensorPtr->isGroupDue;
+}
 
-    sensorPtr->timer = le_timer_Create(name);
-    le_timer_SetRepeat(sensorPtr->timer, 0); // Repeat an infinite number of times.
-    le_timer_SetHandler(sensorPtr->timer, HandleTimerExpiry);
-    le_timer_SetContextPtr(sensorPtr->timer, sensorPtr);
 
-    sensorPtr->sampleFunc = sampleFunc;
-    sensorPtr->sampleFuncContext = sampleFuncContext;
+//--------------------------------------------------------------------------------------------------
+/**
+ * Removes a sensor group.  Its members are not destroyed, but are left without a sample function
+ * until they are destroyed or added to another group.
+ */
+//--------------------------------------------------------------------------------------------------
+void psensor_DestroyGroup
+(
+    psensor_GroupRef_t* groupPtrPtr
+)
+//--------------------------------------------------------------------------------------------------
+{
+    LE_ASSERT(NULL != groupPtrPtr);
 
-    if (le_utf8_Copy(sensorPtr->name, name, sizeof(sensorPtr->name), NULL) != LE_OK)
-    {
-        LE_FATAL("Sensor name too long (%s)", name);
-    }
+    Group_t* groupPtr = *groupPtrPtr;
+    *groupPtrPtr = NULL;
 
-    // Create the Data Hub resources "value", "enable", "period", and "trigger" for this sensor.
-    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
-    BuildResourcePath(path, sizeof(path), sensorPtr, "value");
-    le_result_t result = dhubIO_CreateInput(path, dataType, units);
-    if (result != LE_OK)
+    if (groupPtr)
     {
-        if (result == LE_DUPLICATE)
-        {
-            LE_WARN("An input already existed in the Data Hub at path '%s'.", path);
-        }
-        else
+        le_dls_Link_t* linkPtr;
+        while ((linkPtr = le_dls_Pop(&groupPtr->members)) != NULL)
         {
-            LE_FATAL("Failed to create Data Hub input '%s' (%s).", path, LE_RESULT_TXT(result));
+            Sensor_t* sensorPtr = CONTAINER_OF(linkPtr, Sensor_t, groupLink);
+            sensorPtr->groupPtr = NULL;
+            sensorPtr->isGroupDue = false;
         }
-    }
-
-    BuildResourcePath(path, sizeof(path), sensorPtr, "enable");
-    CreateOutput(path, DHUBIO_DATA_TYPE_BOOLEAN, "");
-    sensorPtr->enableHandlerRef = dhubIO_AddBooleanPushHandler(path, HandleEnablePush, sensorPtr);
-
-    BuildResourcePath(path, sizeof(path), sensorPtr, "period");
-    CreateOutput(path, DHUBIO_DATA_TYPE_NUMERIC, "s");
-    sensorPtr->periodHandlerRef = dhubIO_AddNumericPushHandler(path, HandlePeriodPush, sensorPtr);
-
-    BuildResourcePath(path, sizeof(path), sensorPtr, "trigger");
-    CreateOutput(path, DHUBIO_DATA_TYPE_TRIGGER, "");
-    sensorPtr->triggerHandlerRef = dhubIO_AddTriggerPushHandler(path, HandleTriggerPush, sensorPtr);
-    dhubIO_MarkOptional(path);
 
-    return sensorPtr;
+        le_dls_Remove(&GroupList, &groupPtr->link);
+        le_mem_Release(groupPtr);
+    }
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Creates a periodic sensor scaffold for a sensor with a given name that produces JSON samples.
- *
- * This makes the sensor appear in the Data Hub and creates a timer for that sensor.
- * The sampleFunc will be called whenever it's time to take a sample.  The sampleFunc is supposed
- * to call psensor_PushJson() to push the JSON sample.
- *
- * @return Reference to the new periodic sensor scaffold.
+ * Worker thread main function.
  */
 //--------------------------------------------------------------------------------------------------
-psensor_Ref_t psensor_CreateJson
+static void* WorkerMain
 (
-    const char* name,   ///< Name of the periodic sensor, or "" if the app name is sufficient.
-    const char* jsonExample,    ///< String containing example JSON value.
-    void (*sampleFunc)(psensor_Ref_t ref,
-                       void *context), ///< Sample function to be called back periodically.
-    void *sampleFuncContext  ///< Context pointer to be passed to the sample function
+    void* contextPtr
 )
 //--------------------------------------------------------------------------------------------------
 {
-    psensor_Ref_t ref = psensor_Create(name,
-                                       DHUBIO_DATA_TYPE_JSON,
-                                       "", // units
-                                       sampleFunc,
-                                       sampleFuncContext);
-
-    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
-    BuildResourcePath(path, sizeof(path), ref, "value");
-    dhubIO_SetJsonExample(path, jsonExample);
+    le_event_RunLoop();
 
-    return ref;
+    return NULL;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Removes a periodic sensor scaffold and all associated resources
+ * Run one of the worker init handlers.  Runs on a worker thread.
  */
 //--------------------------------------------------------------------------------------------------
-void psensor_Destroy
+static void RunWorkerInitHandler
 (
-    psensor_Ref_t *ref
+    void* param1Ptr,    ///< Index into WorkerInitHandlers[].
+    void* param2Ptr
 )
 //--------------------------------------------------------------------------------------------------
 {
-    Sensor_t* sensorPtr;
-    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
-
-    LE_ASSERT(NULL != ref);
-
-    sensorPtr = *ref;
-    *ref = NULL;
-
-    if (sensorPtr)
-    {
-        sensorPtr->isEnabled = false;
-
-        // Stop and delete timer
-        (void)le_timer_Stop (sensorPtr->timer);
-        le_timer_Delete(sensorPtr->timer);
-
-        // Deregister handlers and remove resources
-        BuildResourcePath(path, sizeof(path), sensorPtr, "trigger");
-        dhubIO_RemoveTriggerPushHandler(sensorPtr->triggerHandlerRef);
-        dhubIO_DeleteResource(path);
-
-        BuildResourcePath(path, sizeof(path), sensorPtr, "period");
-        dhubIO_RemoveNumericPushHandler(sensorPtr->periodHandlerRef);
-        dhubIO_DeleteResource(path);
-
-        BuildResourcePath(path, sizeof(path), sensorPtr, "enable");
-        dhubIO_RemoveBooleanPushHandler(sensorPtr->enableHandlerRef);
-        dhubIO_DeleteResource(path);
-
-        BuildResourcePath(path, sizeof(path), sensorPtr, "value");
-        dhubIO_DeleteResource(path);
-
-        le_mem_Release(sensorPtr);
-    }
+    WorkerInitHandlers[(size_t)param1Ptr]();
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Push a boolean sample to the Data Hub.
+ * Start the worker threads, if they aren't running yet.
  */
 //--------------------------------------------------------------------------------------------------
-void psensor_PushBoolean
+static void StartWorkers
 (
-    psensor_Ref_t ref,  ///< Reference returned by psensor_Create().
-    double timestamp,   ///< Timestamp (or 0 = now).
-    bool value
+    void
 )
 //--------------------------------------------------------------------------------------------------
 {
-    Sensor_t* sensorPtr = ref;
+    if (WorkersStarted)
+    {
+        return;
+    }
 
-    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
-    LE_ASSERT(snprintf(path, sizeof(path), "%s/value", sensorPtr->name) < sizeof(path));
+    for (size_t i = 0; i < WORKER_COUNT; i++)
+    {
+        char name[LIMIT_MAX_THREAD_NAME_BYTES];
+        (void)snprintf(name, sizeof(name), "psensor%zu", i);
+
+        Workers[i].thread = le_thread_Create(name, WorkerMain, NULL);
+        Workers[i].pendingJobs = 0;
+        le_thread_Start(Workers[i].thread);
+
+        // These are queued ahead of any sample jobs, so they run first.
+        for (size_t h = 0; h < WorkerInitHandlerCount; h++)
+        {
+            le_event_QueueFunctionToThread(Workers[i].thread,
+                                           RunWorkerInitHandler,
+                                           (void*)h,
+                                           NULL);
+        }
+    }
 
-    dhubIO_PushBoolean(path, timestamp, value);
+    WorkersStarted = true;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Push a numeric sample to the Data Hub.
+ * Mark a sensor as blocking (or not).
+ *
+ * The sample function of a blocking sensor is run on a worker thread, so a slow sample function
+ * (e.g., one that makes a slow IPC call or reads a stalled device) doesn't delay other sensors or
+ * Data Hub handlers.  Its pushes are passed back to the main thread.  A blocking sensor never has
+ * more than one sample in flight; if its sample function is still running when the next sample
+ * is due, that sample is skipped and counted in @b "stats/missed".
+ *
+ * @warning A blocking sensor's sample function must not call anything in this API other than
+ *          the psensor_PushX() functions.  Any IPC APIs it uses must be connected on the worker
+ *          threads (see psensor_AddWorkerInitHandler()).
  */
 //--------------------------------------------------------------------------------------------------
-void psensor_PushNumeric
+void psensor_SetBlocking
 (
     psensor_Ref_t ref,  ///< Reference returned by psensor_Create().
-    double timestamp,   ///< Timestamp (or 0 = now).
-    double value
+    bool isBlocking
 )
 //--------------------------------------------------------------------------------------------------
 {
     Sensor_t* sensorPtr = ref;
 
-    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
-    LE_ASSERT(snprintf(path, sizeof(path), "%s/value", sensorPtr->name) < sizeof(path));
+    if (isBlocking && (sensorPtr->groupPtr != NULL))
+    {
+        LE_ERROR("Sensor '%s' is in a group, so it can't be made blocking.", sensorPtr->name);
+        return;
+    }
+
+    if (isBlocking)
+    {
+        StartWorkers();
+    }
 
-    dhubIO_PushNumeric(path, timestamp, value);
+    sensorPtr->isBlocking = isBlocking;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Push a string sample to the Data Hub.
+ * Register a function to be called once on each worker thread before it runs any sample
+ * functions.  Typically used to connect the IPC APIs that blocking sample functions use
+ * (e.g., le_pos_ConnectService()).
  */
 //--------------------------------------------------------------------------------------------------
-void psensor_PushString
+void psensor_AddWorkerInitHandler
 (
-    psensor_Ref_t ref,  ///< Reference returned by psensor_Create().
-    double timestamp,   ///< Timestamp (or 0 = now).
-    const char* value
+    psensor_WorkerInitFunc_t initFunc
 )
 //--------------------------------------------------------------------------------------------------
 {
-    Sensor_t* sensorPtr = ref;
+    LE_ASSERT(WorkerInitHandlerCount < MAX_WORKER_INIT_HANDLERS);
 
-    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
-    LE_ASSERT(snprintf(path, sizeof(path), "%s/value", sensorPtr->name) < sizeof(path));
+    size_t index = WorkerInitHandlerCount++;
+    WorkerInitHandlers[index] = initFunc;
 
-    dhubIO_PushString(path, timestamp, value);
+    if (WorkersStarted)
+    {
+        for (size_t i = 0; i < WORKER_COUNT; i++)
+        {
+            le_event_QueueFunctionToThread(Workers[i].thread,
+                                           RunWorkerInitHandler,
+                                           (void*)index,
+                                           NULL);
+        }
+    }
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Push a JSON sample to the Data Hub.
+ * Set the scheduler's slack window.
+ *
+ * Whenever the scheduler wakes up to take a sample, any other sensor that is due within this
+ * many seconds is sampled in the same wakeup.  A sensor is never sampled more than half its
+ * period early.
  */
 //--------------------------------------------------------------------------------------------------
-void psensor_PushJson
+void psensor_SetSlack
 (
-    psensor_Ref_t ref,  ///< Reference returned by psensor_Create().
-    double timestamp,   ///< Timestamp (or 0 = now).
-    const char* value
+    double slack    ///< seconds (>= 0)
 )
 //--------------------------------------------------------------------------------------------------
 {
-    Sensor_t* sensorPtr = ref;
-
-    char path[DHUBIO_MAX_RESOURCE_PATH_LEN];
-    LE_ASSERT(snprintf(path, sizeof(path), "%s/value", sensorPtr->name) < sizeof(path));
+    if ((slack < 0.0) || isnan(slack))
+    {
+        LE_ERROR("Scheduler slack %lf is out of range. Must be >= 0.", slack);
+        return;
+    }
 
-    dhubIO_PushJson(path, timestamp, value);
+    SchedulerSlack = slack;
 }
 
 
 COMPONENT_INIT
 {
-    SensorPool = le_mem_CreatePool("psensor", sizeof(Sensor_t));
+    SensorPool = le_mem_InitStaticPool(psensor, PSENSOR_MAX_SENSORS, sizeof(Sensor_t));
+    SamplePool = le_mem_CreatePool("psensorSample", sizeof(Sample_t));
+    le_mem_SetDestructor(SamplePool, SampleDestructor);
+    GroupPool = le_mem_CreatePool("psensorGroup", sizeof(Group_t));
+
+    MainThread = le_thread_GetCurrent();
+
+    SchedulerTimer = le_timer_Create("psensor");
+    le_timer_SetRepeat(SchedulerTimer, 1); // One-shot.  Re-armed by Reschedule().
+    le_timer_SetHandler(SchedulerTimer, HandleTimerExpiry);
+
+    SchedulerEpoch = Now();
+    WakeupWindowStart = SchedulerEpoch;
+
+    le_result_t result = dhubIO_CreateInput(WAKEUPS_RESOURCE, DHUBIO_DATA_TYPE_NUMERIC, "");
+    if ((result != LE_OK) && (result != LE_DUPLICATE))
+    {
+        LE_ERROR("Failed to create Data Hub input '%s' (%s).",
+                 WAKEUPS_RESOURCE,
+                 LE_RESULT_TXT(result));
+    }
 }
@@ -49,6 +49,11 @@ bindings:
  *
  * psensor_CreateJson() can be used to create a sensor that delivers JSON samples to the Data Hub.
  *
+ * A component with several sensors can instead describe them all in a constant table of
+ * psensor_Descriptor_t (name, data type, units, sample function, default period and example
+ * JSON value) and create them in one pass with psensor_CreateFromTable().  Storage for the first
+ * @ref PSENSOR_MAX_SENSORS sensors in a process is statically allocated.
+ *
  * @section c_periodicSensorPush Pushing a Sensor Reading to the Data Hub
  *
  * Both psensor_Create() and psensor_CreateJson() take a callback function that is called back
@@ -59,6 +64,105 @@ bindings:
  * - psensor_PushString()
  * - psensor_PushJson()
  *
+ * @section c_periodicSensorAdaptive Adaptive Sampling Period
+ *
+ * A sensor whose signal is flat most of the time can be given an adaptive period by calling
+ * psensor_EnableAdaptivePeriod().  This adds three more outputs:
+ * - @b "minPeriod" - the shortest sampling period (seconds), used while the signal is moving.
+ * - @b "maxPeriod" - the longest sampling period (seconds), used while the signal is flat.
+ * - @b "sensitivity" - how far (in the sensor's units) the signal must deviate from its moving
+ *   average, or how large its moving standard deviation must be, to count as moving.
+ *
+ * Once all three are set, the period drops to minPeriod as soon as the signal moves, and is
+ * doubled after every few consecutive flat samples until it reaches maxPeriod.  Periods are
+ * kept to minPeriod times a power of two so they stay harmonic with other sensors.
+ *
+ * @section c_periodicSensorDeadband Deadband Filtering
+ *
+ * psensor_EnableDeadband() gives a sensor a deadband filter, so that samples that carry no
+ * significant change are dropped before they cross the IPC boundary into the Data Hub.  This
+ * adds the following outputs:
+ * - @b "deadband/absolute" - smallest change (in the sensor's units) that is passed on.
+ * - @b "deadband/relative" - smallest change, as a fraction of the last value passed on.
+ * - @b "deadband/maxSilence" - a sample is passed on regardless if nothing has been passed on
+ *   for this many seconds (0 = no limit).
+ *
+ * and a @b "deadband/suppressed" input that counts the samples dropped (updated along with the
+ * @ref c_periodicSensorStats "stats").  A sample is passed on if it differs from the last one
+ * passed on by more than the larger of the two thresholds.  JSON vector samples are compared
+ * either member by member or by magnitude, depending on the mode given.
+ *
+ * @section c_periodicSensorMotion Motion Gating
+ *
+ * Sensors whose readings don't change while the device is standing still can be throttled
+ * whenever it is.  Something in the process that can tell (e.g., an accelerometer) calls
+ * psensor_SetStationary() as the device stops and starts moving.  psensor_EnableMotionGating()
+ * gives a sensor a @b "stationaryPeriod" output (seconds).  While the device is stationary, the
+ * sensor is sampled no more often than that, or not at all (and nothing it pushes is passed on)
+ * if it is 0.  Normal sampling resumes as soon as the device moves.
+ *
+ * psensor_AddMotionHandler() registers a function to be called whenever the state changes, so
+ * that, e.g., a positioning service can be released while the device is stationary.
+ *
+ * @section c_periodicSensorBatching Batching Samples
+ *
+ * By default, each push results in one Data Hub update.  psensor_SetBatching() can be used to
+ * have a sensor collect up to N samples (or T milliseconds of samples), each with its own
+ * timestamp, and deliver them to the Data Hub together.  This is useful for sensors that are
+ * sampled at high rates, because the wakeup and IPC overhead is then paid once per batch.
+ * psensor_Flush() delivers any batched samples immediately.
+ *
+ * @section c_periodicSensorGroups Sensor Groups
+ *
+ * Sensors that are read from the same device can be put in a group, so that they are read in one
+ * pass instead of separately.  psensor_CreateGroup() creates a group with a single sample
+ * function, and psensor_AddToGroup() adds sensors to it.  Each member keeps its own resources,
+ * period and enable, but whenever any members are due, the group's sample function is called
+ * once for all of them.  It pushes a sample to each member, and all samples pushed in the same
+ * pass with a timestamp of 0 (now) get the same timestamp.  psensor_IsSampling() tells the
+ * group's sample function which members are due; samples pushed to other members are dropped.
+ *
+ * @section c_periodicSensorBlocking Blocking Sample Functions
+ *
+ * Sample functions normally run on the thread that runs the scheduler, so a sample function that
+ * blocks (e.g., on a slow IPC call or a stalled device read) delays every other sensor in the
+ * process.  psensor_SetBlocking() marks a sensor as blocking, after which its sample function
+ * is run on a small pool of worker threads and its pushes are passed back to the main thread.
+ * A blocking sensor never has more than one sample in flight.
+ *
+ * IPC client APIs are connected per thread, so any APIs a blocking sample function uses must be
+ * connected on the worker threads too.  Use psensor_AddWorkerInitHandler() to do that.
+ *
+ * @section c_periodicSensorScheduling Sample Scheduling
+ *
+ * All sensors in a process share a single timer.  Each sensor's samples are aligned to whole
+ * multiples of its period from a common origin, so sensors with the same or harmonic periods
+ * (e.g., 10 s and 30 s) fall due at the same instant and are sampled in the same wakeup.
+ * Sensors that fall due within a small slack window of each other are also sampled together.
+ * The slack window can be changed using psensor_SetSlack().
+ *
+ * The number of scheduler wakeups per hour is pushed to the @b "psensor/wakeupsPerHour" input
+ * once an hour.
+ *
+ * @section c_periodicSensorStats Sampling Statistics
+ *
+ * Each sensor also gets a set of @b "stats" inputs that show how well it is being sampled:
+ * - @b "stats/lateness" - histogram of how late the sample function was called (JSON).
+ * - @b "stats/sampleTime" - histogram of how long the sample function took to run (JSON).
+ * - @b "stats/pushLatency" - histogram of how long each push to the Data Hub took (JSON).
+ * - @b "stats/missed" - number of sample periods skipped because sampling fell behind.
+ *
+ * The histograms look like this (times in milliseconds):
+ *
+ * @verbatim
+{"count":12,"mean":0.41,"max":1.20,"hist":[11,1,0,0,0,0,0,0,0,0,0,0]}
+@endverbatim
+ *
+ * where @c hist[0] counts times under 1 ms, @c hist[i] counts times from 2^(i-1) up to 2^i ms,
+ * and the last bucket counts everything over 1 s.  The statistics are pushed about once a
+ * minute, along with one of the sensor's regular samples.  They accumulate until the
+ * @b "stats/reset" trigger output is triggered.
+ *
  * @section c_periodicSensorDestroy Destroying a Periodic Sensor Interface
  *
  * psensor_Destroy() can be used to destroy a previously created sensor interface.
@@ -96,6 +200,7 @@ bindings:
 /app/myApp/mySensor/enable = Boolean output
 /app/myApp/mySensor/period = numeric output, units = 's'
 /app/myApp/mySensor/trigger = trigger output
+/app/myApp/mySensor/stats/... = statistics inputs (see @ref c_periodicSensorStats)
 @endverbatim
  *
  * If the app only has one sensor in it, and the app name is already the same as the name of
@@ -117,6 +222,7 @@ bindings:
 /app/temperature/enable = Boolean output
 /app/temperature/period = numeric output, units = 's'
 /app/temperature/trigger = trigger output
+/app/temperature/stats/... = statistics inputs (see @ref c_periodicSensorStats)
 @endverbatim
  *
  * <hr>
@@ -146,6 +252,32 @@ extern "C" {
 #define PSENSOR_MAX_NAME_BYTES  32
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default slack window (in seconds) within which sensor expiries are coalesced into one wakeup.
+ */
+//--------------------------------------------------------------------------------------------------
+#define PSENSOR_DEFAULT_SLACK   0.5
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of bytes (including null terminator) of a string or JSON sample held in the sample
+ * itself.  Bigger samples are copied to the heap, but otherwise handled the same way.
+ */
+//--------------------------------------------------------------------------------------------------
+#define PSENSOR_MAX_BATCH_VALUE_BYTES   256
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of sensors whose storage is statically allocated.  Creating more than this many sensors
+ * in one process still works, but the extra ones are allocated from the heap.
+ */
+//--------------------------------------------------------------------------------------------------
+#define PSENSOR_MAX_SENSORS   16
+
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Reference to a periodic sensor scaffold.
@@ -154,14 +286,33 @@ extern "C" {
 typedef struct psensor* psensor_Ref_t;
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sensor descriptor, for use with psensor_CreateFromTable().
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char* name;               ///< Name of the sensor, or "" if the app name is sufficient.
+    dhubIO_DataType_t dataType;
+    const char* units;              ///< Units of the "value" resource (NULL = none).
+    void (*sampleFunc)(psensor_Ref_t ref,
+                       void *context); ///< Sample function (NULL for group members).
+    void *sampleFuncContext;        ///< Context pointer to be passed to the sample function.
+    double defaultPeriod;           ///< Default sampling period in seconds (0 = none).
+    const char* jsonExample;        ///< Example JSON value (NULL = none).
+}
+psensor_Descriptor_t;
+
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Creates a periodic sensor scaffold for a sensor with a given name.
  *
- * This makes the sensor appear in the Data Hub and creates a timer for that sensor.
+ * This makes the sensor appear in the Data Hub and adds it to the shared sampling scheduler.
  * The sampleFunc will be called whenever it's time to take a sample.  The sampleFunc should
  * call one of the psensor_PushX() functions defined in this API to push its sample to the
- * Data Hub.
+ * Data Hub.  The sampleFunc can be NULL for a sensor that will be added to a group.
  *
  * @return Reference to the new periodic sensor scaffold.
  */
@@ -181,7 +332,7 @@ LE_SHARED psensor_Ref_t psensor_Create
 /**
  * Creates a periodic sensor scaffold for a sensor with a given name that produces JSON samples.
  *
- * This makes the sensor appear in the Data Hub and creates a timer for that sensor.
+ * This makes the sensor appear in the Data Hub and adds it to the shared sampling scheduler.
  * The sampleFunc will be called whenever it's time to take a sample.  The sampleFunc is supposed
  * to call psensor_PushJson() to push the JSON sample.
  *
@@ -198,6 +349,22 @@ LE_SHARED psensor_Ref_t psensor_CreateJson
 );
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Creates periodic sensor scaffolds for all the sensors described in a table, in one pass.
+ *
+ * Each sensor is created as if by psensor_Create() (or psensor_CreateJson(), if the descriptor
+ * has a jsonExample), and is given the descriptor's default period, if any.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void psensor_CreateFromTable
+(
+    const psensor_Descriptor_t* table,  ///< Array of sensor descriptors.
+    size_t count,                       ///< Number of entries in the table.
+    psensor_Ref_t* refs                 ///< [OUT] Array of count references (or NULL).
+);
+
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Removes a periodic sensor scaffold and all associated resources
@@ -260,6 +427,262 @@ LE_SHARED void psensor_PushJson
     const char* value
 );
 
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give a sensor an adaptive sampling period.
+ *
+ * Creates the @b "minPeriod", @b "maxPeriod" (both in seconds) and @b "sensitivity" outputs for
+ * the sensor.  Once all three have been set, the sensor is sampled as slowly as maxPeriod while
+ * its signal is flat and as quickly as minPeriod while its signal is moving by more than the
+ * sensitivity (in the sensor's units; for JSON vector samples, in units of vector magnitude).
+ * Until then, the sensor is sampled at its regular period.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void psensor_EnableAdaptivePeriod
+(
+    psensor_Ref_t ref   ///< Reference returned by psensor_Create().
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a group of sensors that are sampled together.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct psensor_Group* psensor_GroupRef_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Creates a sensor group, whose sampleFunc is called once for all of its members that are due in
+ * the same wakeup.  Samples pushed with a timestamp of 0 (now) during one call all get the same
+ * timestamp.
+ *
+ * @return Reference to the new group.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED psensor_GroupRef_t psensor_CreateGroup
+(
+    void (*sampleFunc)(psensor_GroupRef_t group,
+                       void *context), ///< Sample function to be called back for each pass.
+    void *sampleFuncContext  ///< Context pointer to be passed to the sample function
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Adds a sensor to a group.  A sensor can only be in one group, and group members can't be
+ * blocking.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void psensor_AddToGroup
+(
+    psensor_GroupRef_t group,   ///< Reference returned by psensor_CreateGroup().
+    psensor_Ref_t ref           ///< Reference returned by psensor_Create().
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a group member is being sampled in the group's current pass.
+ *
+ * @return true if the sensor should be sampled now.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED bool psensor_IsSampling
+(
+    psensor_Ref_t ref   ///< Reference returned by psensor_Create().
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Removes a sensor group.  Its members are not destroyed.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void psensor_DestroyGroup
+(
+    psensor_GroupRef_t* groupPtrPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * How a deadband compares JSON vector samples (e.g., {"x":1.0,"y":2.0,"z":3.0}).
+ * Boolean and numeric samples are compared by value either way.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    PSENSOR_DEADBAND_PER_MEMBER,    ///< Passed if any numeric member changes by enough.
+    PSENSOR_DEADBAND_MAGNITUDE,     ///< Passed if the vector's magnitude changes by enough.
+}
+psensor_DeadbandMode_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give a sensor a deadband filter, so that samples that carry no significant change are dropped
+ * before they are pushed to the Data Hub.
+ *
+ * Creates the @b "deadband/absolute", @b "deadband/relative" and @b "deadband/maxSilence"
+ * outputs and the @b "deadband/suppressed" input.  Until absolute or relative is set, every
+ * sample is pushed.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void psensor_EnableDeadband
+(
+    psensor_Ref_t ref,              ///< Reference returned by psensor_Create().
+    psensor_DeadbandMode_t mode     ///< How JSON vector samples are compared.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Throttle a sensor while the device is stationary (see psensor_SetStationary()).
+ *
+ * Creates the @b "stationaryPeriod" output (seconds).  While the device is stationary, the sensor
+ * is sampled at the longer of its active period and stationaryPeriod, or, if stationaryPeriod is
+ * 0, not sampled at all and its pushes are dropped.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void psensor_EnableMotionGating
+(
+    psensor_Ref_t ref,              ///< Reference returned by psensor_Create().
+    double defaultStationaryPeriod  ///< Default for "stationaryPeriod" (seconds, 0 = suspend).
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tell the scheduler whether the device is stationary.  Motion-gated sensors are throttled while
+ * it is, and the motion handlers are called whenever this changes.  The device is assumed to be
+ * moving until this is called.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void psensor_SetStationary
+(
+    bool isStationary
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether the device is stationary, as last set by psensor_SetStationary().
+ *
+ * @return true if the device is stationary.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED bool psensor_IsStationary
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function to be called when the device stops or starts moving.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*psensor_MotionHandlerFunc_t)(bool isStationary, void* contextPtr);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register a function to be called (on the main thread) whenever psensor_SetStationary() changes
+ * the device's state.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void psensor_AddMotionHandler
+(
+    psensor_MotionHandlerFunc_t handlerFunc,
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function to be called once on each worker thread before it runs any sample functions.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*psensor_WorkerInitFunc_t)(void);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mark a sensor as blocking (or not).
+ *
+ * The sample function of a blocking sensor is run on a worker thread, so a slow sample function
+ * doesn't delay other sensors or Data Hub handlers.  If its sample function is still running
+ * when the next sample is due, that sample is skipped and counted in @b "stats/missed".
+ *
+ * @warning A blocking sensor's sample function must not call anything in this API other than
+ *          the psensor_PushX() functions.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void psensor_SetBlocking
+(
+    psensor_Ref_t ref,  ///< Reference returned by psensor_Create().
+    bool isBlocking
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register a function to be called once on each worker thread before it runs any sample
+ * functions.  Typically used to connect the IPC APIs that blocking sample functions use
+ * (e.g., le_pos_ConnectService()).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void psensor_AddWorkerInitHandler
+(
+    psensor_WorkerInitFunc_t initFunc
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Enable or disable batching of a sensor's samples.
+ *
+ * While batching, pushed samples are held (with their timestamps) and delivered to the Data Hub
+ * in one burst when maxCount samples have accumulated or the oldest sample is maxAgeMs old,
+ * whichever comes first.  A maxCount of 0 or 1 disables batching (flushing anything pending).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void psensor_SetBatching
+(
+    psensor_Ref_t ref,  ///< Reference returned by psensor_Create().
+    uint32_t maxCount,  ///< Maximum number of samples per batch.
+    uint32_t maxAgeMs   ///< Maximum age (ms) of the oldest sample in a batch.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Immediately push any batched samples to the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void psensor_Flush
+(
+    psensor_Ref_t ref   ///< Reference returned by psensor_Create().
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the scheduler's slack window.
+ *
+ * Whenever the scheduler wakes up to take a sample, any other sensor that is due within this
+ * many seconds is sampled in the same wakeup.  A sensor is never sampled more than half its
+ * period early.  Defaults to PSENSOR_DEFAULT_SLACK.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void psensor_SetSlack
+(
+    double slack    ///< seconds (>= 0)
+);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,576 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file deadReckoning.c
+ *
+ * Dead reckoning from the last position fix, so a position (with an error bound) is available
+ * while GNSS is off or can't get a fix.
+ *
+ * The IMU component feeds each step of its orientation filter to deadReckoning_Step(), which
+ * rotates the accelerometer reading into the filter's level frame, where the horizontal
+ * components are the device's horizontal acceleration, and integrates them twice into a
+ * displacement from the fix.  The filter's frame has no absolute heading (there's no
+ * magnetometer), so the heading offset is learned by comparing the integrated displacement
+ * between two fixes with the distance and bearing between them; until then the displacement can't
+ * be placed on the map, and only its length counts towards the error bound.  The IMU only keeps
+ * the filter running while the deadReckoning sensor is enabled, so movement is only tracked then.
+ * Fixes come from the position component, and barometric altitude from the pressure component.
+ *
+ * Accelerometer bias and attitude errors make the velocity error grow linearly, and the position
+ * error quadratically, while the device moves.  While the device is stationary (see
+ * psensor_IsStationary()) its velocity is known to be zero, so the velocity error is reset and
+ * the position error stops growing.  Altitude is the fix's, corrected by the change in
+ * barometric altitude since the fix when the pressure component supplies it.
+ *
+ * The estimate is published to "deadReckoning/value" through the Periodic Sensor component, as
+ * JSON in the same units as the position sensor:
+ *
+ *  {"lat":degrees,"lon":degrees,"hAcc":metres,"alt":metres,"vAcc":metres,"reckoned":seconds}
+ *
+ * where hAcc and vAcc are the error bounds and "reckoned" is the time since the fix.  Nothing is
+ * published once the horizontal error bound is larger than "deadReckoning/maxError" (metres).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "deadReckoning.h"
+#include "periodicSensor.h"
+#include "dhubUtils.h"
+
+#include <math.h>
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data Hub resource paths.
+ */
+//--------------------------------------------------------------------------------------------------
+#define SENSOR_NAME         "deadReckoning"
+#define MAX_ERROR_PATH      "deadReckoning/maxError"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default largest horizontal error bound (metres) that is published, and longest sampling period
+ * (seconds) while the device is stationary.
+ */
+//--------------------------------------------------------------------------------------------------
+#define DEFAULT_MAX_ERROR   1000.0
+#define STATIONARY_PERIOD   600.0
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Horizontal acceleration error (m/s2): accelerometer bias plus gravity let through by a tilt
+ * error of about a degree.
+ */
+//--------------------------------------------------------------------------------------------------
+#define ACCEL_ERROR 0.2
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Velocity error (m/s) assumed when the device is moving at a fix and its velocity isn't known.
+ */
+//--------------------------------------------------------------------------------------------------
+#define UNKNOWN_VELOCITY_ERROR 5.0
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Longest time (seconds) between two fixes for the distance between them to give the velocity
+ * and heading.
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_FIX_INTERVAL 60.0
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The heading is only learned from fixes at least MIN_ALIGN_DISTANCE (metres) apart, and only if
+ * the error in the distance between them is less than ALIGN_ERROR_RATIO of it.  The heading is
+ * then good to about ALIGN_ERROR_RATIO radians, which is also how much of the displacement's
+ * length counts towards the error bound.
+ */
+//--------------------------------------------------------------------------------------------------
+#define MIN_ALIGN_DISTANCE  20.0
+#define ALIGN_ERROR_RATIO   0.25
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Drift (m/s) of the barometric altitude with the weather.
+ */
+//--------------------------------------------------------------------------------------------------
+#define BARO_DRIFT (10.0 / 3600.0)
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Longest time (seconds) without a filter step while the device is moving.  After a longer gap
+ * the reckoning is abandoned until the next fix.
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_UPDATE_GAP 2.0
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mean radius of the Earth (metres).
+ */
+//--------------------------------------------------------------------------------------------------
+#define EARTH_RADIUS 6371000.0
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The fix being reckoned from.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool HasFix = false;
+static struct
+{
+    double timestamp;   ///< seconds since the Epoch
+    double lat;         ///< degrees
+    double lon;         ///< degrees
+    double hAccuracy;   ///< metres
+    double alt;         ///< metres (NAN = unknown)
+    double vAccuracy;   ///< metres
+    double baroAlt;     ///< barometric altitude at the fix (NAN = unknown)
+}
+Fix;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reckoning state.  Velocity and displacement are in the orientation filter's level frame (x, y).
+ */
+//--------------------------------------------------------------------------------------------------
+static double Velocity[2];          ///< m/s
+static double FixVelocity[2];       ///< Velocity (m/s) at the fix.
+static double Displacement[2];      ///< metres since the fix
+static double VelocityError;        ///< m/s
+static double PositionError;        ///< metres, accumulated since the fix
+static double Heading = NAN;        ///< Angle (radians) from the filter's frame to east-north.
+static double BaroAltitude = NAN;   ///< Latest barometric altitude (metres).
+static double LastUpdate;           ///< Time of the last filter step (seconds, relative clock).
+static double MaxError = DEFAULT_MAX_ERROR;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current relative time, in seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double RelativeNow
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current absolute time, in seconds since the Epoch.
+ */
+//--------------------------------------------------------------------------------------------------
+static double AbsoluteNow
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetAbsoluteTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Abandon the reckoning if the filter has stopped stepping while the device is moving, since the
+ * movement during the gap is unknown.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CheckGap
+(
+    void
+)
+{
+    if (HasFix && !psensor_IsStationary() && (RelativeNow() - LastUpdate > MAX_UPDATE_GAP))
+    {
+        LE_WARN("No IMU readings for %.1lf s; dead reckoning lost.", RelativeNow() - LastUpdate);
+        HasFix = false;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Put the displacement since the fix on the map.
+ *
+ * @return The error (metres) this adds: a fraction of the distance if the heading is known,
+ *         otherwise all of it (and the displacement is taken as zero).
+ */
+//--------------------------------------------------------------------------------------------------
+static double PlaceDisplacement
+(
+    double* eastPtr,    ///< [OUT] metres
+    double* northPtr    ///< [OUT] metres
+)
+{
+    double distance = hypot(Displacement[0], Displacement[1]);
+
+    if (isnan(Heading))
+    {
+        *eastPtr = 0.0;
+        *northPtr = 0.0;
+        return distance;
+    }
+
+    *eastPtr = cos(Heading) * Displacement[0] - sin(Heading) * Displacement[1];
+    *northPtr = sin(Heading) * Displacement[0] + cos(Heading) * Displacement[1];
+    return distance * ALIGN_ERROR_RATIO;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Advance the reckoning by one step of the IMU's orientation filter.
+ */
+//--------------------------------------------------------------------------------------------------
+void deadReckoning_Step
+(
+    double step,            ///< Seconds since the previous step (0 = the filter restarted).
+    const double accel[3],  ///< m/s2, sensor frame
+    const double q[4]       ///< Attitude (w, x, y, z) after the step.
+)
+{
+    if (step == 0.0)
+    {
+        // The filter restarted with a new heading: the velocity's direction is lost, and the
+        // displacement so far can't be continued in the new frame, so rebase the fix on it.
+        if (HasFix)
+        {
+            double east;
+            double north;
+
+            PositionError += PlaceDisplacement(&east, &north);
+            Fix.lon += (east / (EARTH_RADIUS * cos(Fix.lat * M_PI / 180))) * (180 / M_PI);
+            Fix.lat += (north / EARTH_RADIUS) * (180 / M_PI);
+        }
+        Heading = NAN;
+        VelocityError += hypot(Velocity[0], Velocity[1]);
+        Velocity[0] = Velocity[1] = 0.0;
+        FixVelocity[0] = FixVelocity[1] = 0.0;
+        Displacement[0] = Displacement[1] = 0.0;
+        LastUpdate = RelativeNow();
+        return;
+    }
+
+    CheckGap();
+    LastUpdate = RelativeNow();
+
+    if (!HasFix)
+    {
+        return;
+    }
+
+    if (psensor_IsStationary())
+    {
+        Velocity[0] = Velocity[1] = 0.0;
+        VelocityError = 0.0;
+        return;
+    }
+
+    // Rotate the reading into the level frame: v' = v + w * t + (q x t), where t = 2 * (q x v).
+    // Gravity is all on z, so the horizontal components are the device's own acceleration.
+    double t[3] =
+    {
+        2 * (q[2] * accel[2] - q[3] * accel[1]),
+        2 * (q[3] * accel[0] - q[1] * accel[2]),
+        2 * (q[1] * accel[1] - q[2] * accel[0]),
+    };
+    double ax = accel[0] + q[0] * t[0] + (q[2] * t[2] - q[3] * t[1]);
+    double ay = accel[1] + q[0] * t[1] + (q[3] * t[0] - q[1] * t[2]);
+
+    Velocity[0] += ax * step;
+    Velocity[1] += ay * step;
+    Displacement[0] += Velocity[0] * step;
+    Displacement[1] += Velocity[1] * step;
+
+    VelocityError += ACCEL_ERROR * step;
+    PositionError += VelocityError * step;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Restart dead reckoning from a new fix.
+ */
+//--------------------------------------------------------------------------------------------------
+void deadReckoning_SetFix
+(
+    double timestamp,   ///< Seconds since the Epoch.
+    double lat,         ///< degrees
+    double lon,         ///< degrees
+    double hAccuracy,   ///< metres
+    double alt,         ///< metres (NAN = unknown)
+    double vAccuracy    ///< metres
+)
+{
+    double east = 0.0;
+    double north = 0.0;
+    double velocityError = UNKNOWN_VELOCITY_ERROR;
+
+    CheckGap();
+
+    double interval = timestamp - Fix.timestamp;
+    if (HasFix && (interval > 0.0) && (interval <= MAX_FIX_INTERVAL))
+    {
+        double dEast = (lon - Fix.lon) * (M_PI / 180) * EARTH_RADIUS * cos(Fix.lat * M_PI / 180);
+        double dNorth = (lat - Fix.lat) * (M_PI / 180) * EARTH_RADIUS;
+        double distance = hypot(dEast, dNorth);
+        double error = PositionError + hAccuracy + Fix.hAccuracy;
+
+        if (   (distance >= MIN_ALIGN_DISTANCE)
+            && (error < distance * ALIGN_ERROR_RATIO)
+            && (hypot(Displacement[0], Displacement[1]) > 0.0))
+        {
+            Heading = atan2(dNorth, dEast) - atan2(Displacement[1], Displacement[0]);
+            LE_DEBUG("Dead reckoning heading offset %.1lf degrees.", Heading * 180 / M_PI);
+        }
+
+        // The mean velocity between the fixes is off by as much as the velocity changed.
+        east = dEast / interval;
+        north = dNorth / interval;
+        velocityError = (hAccuracy + Fix.hAccuracy) / interval
+                      + hypot(Velocity[0] - FixVelocity[0], Velocity[1] - FixVelocity[1]);
+    }
+
+    if (psensor_IsStationary())
+    {
+        Velocity[0] = Velocity[1] = 0.0;
+        VelocityError = 0.0;
+    }
+    else if (HasFix && !isnan(Heading) && (VelocityError <= velocityError))
+    {
+        // The reckoned velocity is better than the mean velocity between the fixes: keep it.
+    }
+    else if (!isnan(Heading))
+    {
+        Velocity[0] = cos(Heading) * east + sin(Heading) * north;
+        Velocity[1] = -sin(Heading) * east + cos(Heading) * north;
+        VelocityError = velocityError;
+    }
+    else
+    {
+        // The velocity can't be put in the filter's frame, so all of it is error.
+        Velocity[0] = Velocity[1] = 0.0;
+        VelocityError = velocityError + hypot(east, north);
+    }
+
+    Fix.timestamp = timestamp;
+    Fix.lat = lat;
+    Fix.lon = lon;
+    Fix.hAccuracy = hAccuracy;
+    Fix.alt = alt;
+    Fix.vAccuracy = vAccuracy;
+    Fix.baroAlt = BaroAltitude;
+
+    FixVelocity[0] = Velocity[0];
+    FixVelocity[1] = Velocity[1];
+    Displacement[0] = Displacement[1] = 0.0;
+    PositionError = 0.0;
+    LastUpdate = RelativeNow();
+    HasFix = true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Account for a barometric altitude reading.  Changes in barometric altitude since the fix are
+ * used for the estimated altitude.
+ */
+//--------------------------------------------------------------------------------------------------
+void deadReckoning_SetBaroAltitude
+(
+    double altitude     ///< metres
+)
+{
+    BaroAltitude = altitude;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current estimate.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_UNAVAILABLE if there's no fix to reckon from, or the IMU readings since the fix are
+ *    incomplete.
+ *  - LE_OUT_OF_RANGE if the error bound is larger than "deadReckoning/maxError".
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t deadReckoning_GetEstimate
+(
+    deadReckoning_Estimate_t* estimatePtr   ///< [OUT]
+)
+{
+    CheckGap();
+
+    if (!HasFix)
+    {
+        return LE_UNAVAILABLE;
+    }
+
+    double east;
+    double north;
+    double hError = Fix.hAccuracy + PositionError + PlaceDisplacement(&east, &north);
+
+    double reckoned = fmax(0.0, AbsoluteNow() - Fix.timestamp);
+
+    estimatePtr->lat = Fix.lat + (north / EARTH_RADIUS) * (180 / M_PI);
+    estimatePtr->lon = Fix.lon
+                     + (east / (EARTH_RADIUS * cos(Fix.lat * M_PI / 180))) * (180 / M_PI);
+    estimatePtr->hError = hError;
+    estimatePtr->reckoned = reckoned;
+
+    if (isnan(Fix.alt))
+    {
+        estimatePtr->alt = NAN;
+        estimatePtr->vError = NAN;
+    }
+    else if (!isnan(Fix.baroAlt) && !isnan(BaroAltitude))
+    {
+        estimatePtr->alt = Fix.alt + (BaroAltitude - Fix.baroAlt);
+        estimatePtr->vError = Fix.vAccuracy + BARO_DRIFT * reckoned;
+    }
+    else
+    {
+        estimatePtr->alt = Fix.alt;
+        estimatePtr->vError = Fix.vAccuracy + (hError - Fix.hAccuracy);
+    }
+
+    if (hError > MaxError)
+    {
+        return LE_OUT_OF_RANGE;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish the current estimate.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SampleEstimate
+(
+    psensor_Ref_t ref,
+    void *contextPtr
+)
+{
+    deadReckoning_Estimate_t estimate;
+
+    if (deadReckoning_GetEstimate(&estimate) != LE_OK)
+    {
+        return;
+    }
+
+    char json[256];
+
+    int len = snprintf(json,
+                       sizeof(json),
+                       "{\"lat\":%.6lf,\"lon\":%.6lf,\"hAcc\":%.0lf",
+                       estimate.lat,
+                       estimate.lon,
+                       estimate.hError);
+    if (!isnan(estimate.alt) && (len < sizeof(json)))
+    {
+        len += snprintf(json + len,
+                        sizeof(json) - len,
+                        ",\"alt\":%.1lf,\"vAcc\":%.0lf",
+                        estimate.alt,
+                        estimate.vError);
+    }
+    if (len < sizeof(json))
+    {
+        len += snprintf(json + len, sizeof(json) - len, ",\"reckoned\":%.1lf}", estimate.reckoned);
+    }
+    if (len >= sizeof(json))
+    {
+        LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(json));
+    }
+
+    psensor_PushJson(ref, 0 /* now */, json);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an update to the largest error bound that is published.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleMaxErrorPush
+(
+    double timestamp,
+    double maxError,    ///< metres
+    void* contextPtr
+)
+{
+    if (!(maxError > 0.0))
+    {
+        LE_ERROR("Invalid dead reckoning maximum error %lf.", maxError);
+        return;
+    }
+
+    MaxError = maxError;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The orientation filter is paused while the device is stationary, so the gap in its steps
+ * doesn't count when the device starts moving again.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleMotionChange
+(
+    bool isStationary,
+    void* contextPtr
+)
+{
+    if (!isStationary)
+    {
+        LastUpdate = RelativeNow();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    psensor_Ref_t ref = psensor_CreateJson(SENSOR_NAME,
+                                           "{\"lat\":0.0,\"lon\":0.0,\"hAcc\":0,"
+                                           "\"alt\":0.0,\"vAcc\":0,\"reckoned\":0.0}",
+                                           SampleEstimate,
+                                           NULL);
+
+    // A parked device's estimate doesn't change.
+    psensor_EnableMotionGating(ref, STATIONARY_PERIOD);
+    psensor_AddMotionHandler(HandleMotionChange, NULL);
+
+    dhubUtils_CreateOutput(MAX_ERROR_PATH, DHUBIO_DATA_TYPE_NUMERIC, "m");
+    dhubIO_AddNumericPushHandler(MAX_ERROR_PATH, HandleMaxErrorPush, NULL);
+    dhubIO_SetNumericDefault(MAX_ERROR_PATH, DEFAULT_MAX_ERROR);
+    dhubIO_MarkOptional(MAX_ERROR_PATH);
+}
@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file deadReckoning.h
+ *
+ * Dead reckoning from the last position fix with the IMU.  The sensor components in the same
+ * executable feed the estimator: the IMU component its orientation filter's steps, the position
+ * component its fixes and the pressure component barometric altitude.  The position component
+ * falls back to the estimate when there's no fix.
+ *
+ * All functions must be called on the main thread.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef DEAD_RECKONING_H_INCLUDE_GUARD
+#define DEAD_RECKONING_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A dead-reckoned position, with bounds on its error.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    double lat;         ///< degrees
+    double lon;         ///< degrees
+    double hError;      ///< metres
+    double alt;         ///< metres (NAN = unknown)
+    double vError;      ///< metres (NAN = unknown)
+    double reckoned;    ///< seconds since the fix it was reckoned from
+}
+deadReckoning_Estimate_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Advance the reckoning by one step of the IMU's orientation filter.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void deadReckoning_Step
+(
+    double step,            ///< Seconds since the previous step (0 = the filter restarted).
+    const double accel[3],  ///< m/s2, sensor frame
+    const double q[4]       ///< Attitude (w, x, y, z) after the step.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Restart dead reckoning from a new fix.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void deadReckoning_SetFix
+(
+    double timestamp,   ///< Seconds since the Epoch.
+    double lat,         ///< degrees
+    double lon,         ///< degrees
+    double hAccuracy,   ///< metres
+    double alt,         ///< metres (NAN = unknown)
+    double vAccuracy    ///< metres
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Account for a barometric altitude reading.  Changes in barometric altitude since the fix are
+ * used for the estimated altitude.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void deadReckoning_SetBaroAltitude
+(
+    double altitude     ///< metres
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current estimate.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_UNAVAILABLE if there's no fix to reckon from, or the IMU readings since the fix are
+ *    incomplete.
+ *  - LE_OUT_OF_RANGE if the error bound is larger than "deadReckoning/maxError".
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t deadReckoning_GetEstimate
+(
+    deadReckoning_Estimate_t* estimatePtr   ///< [OUT]
+);
+
+
+#endif // DEAD_RECKONING_H_INCLUDE_GUARD
@@ -12,9 +12,67 @@
 #include "interfaces.h"
 
 #include "imu.h"
+#include "imuStream.h"
+#include "vibration.h"
+#include "orientation.h"
+#include "shock.h"
+#include "motion.h"
+#include "deadReckoning.h"
 #include "fileUtils.h"
 #include "periodicSensor.h"
 
+#include <math.h>
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The IIO device's sysfs attributes.  They're opened once at start-up and kept open, so that each
+ * read is a single system call.  The scale and offset attributes are also cached.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    ATTR_ACCEL_SCALE,
+    ATTR_ACCEL_X,
+    ATTR_ACCEL_Y,
+    ATTR_ACCEL_Z,
+    ATTR_GYRO_SCALE,
+    ATTR_GYRO_X,
+    ATTR_GYRO_Y,
+    ATTR_GYRO_Z,
+    ATTR_TEMP_SCALE,
+    ATTR_TEMP_OFFSET,
+    ATTR_TEMP_RAW,
+    ATTR_COUNT
+}
+Attribute_t;
+
+static const char* const AttributePaths[ATTR_COUNT] =
+{
+    [ATTR_ACCEL_SCALE]  = "/driver/in_accel_scale",
+    [ATTR_ACCEL_X]      = "/driver/in_accel_x_raw",
+    [ATTR_ACCEL_Y]      = "/driver/in_accel_y_raw",
+    [ATTR_ACCEL_Z]      = "/driver/in_accel_z_raw",
+    [ATTR_GYRO_SCALE]   = "/driver/in_anglvel_scale",
+    [ATTR_GYRO_X]       = "/driver/in_anglvel_x_raw",
+    [ATTR_GYRO_Y]       = "/driver/in_anglvel_y_raw",
+    [ATTR_GYRO_Z]       = "/driver/in_anglvel_z_raw",
+    [ATTR_TEMP_SCALE]   = "/driver/in_temp_scale",
+    [ATTR_TEMP_OFFSET]  = "/driver/in_temp_offset",
+    [ATTR_TEMP_RAW]     = "/driver/in_temp_raw",
+};
+
+static file_Ref_t Attributes[ATTR_COUNT];
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * How long (seconds) a cached scale or offset attribute is trusted before it's read again.  These
+ * only change if someone reconfigures the device, so they aren't read on every sample.
+ */
+//--------------------------------------------------------------------------------------------------
+#define CALIBRATION_MAX_AGE 60.0
+
 
 //--------------------------------------------------------------------------------------------------
 /**
@@ -36,27 +94,27 @@ le_result_t imu_ReadAccel
     le_result_t r;
 
     double scaling = 0.0;
-    r = file_ReadDouble("/driver/in_accel_scale", &scaling);
+    r = file_ReadDoubleFrom(Attributes[ATTR_ACCEL_SCALE], &scaling);
     if (r != LE_OK)
     {
         goto done;
     }
 
-    r = file_ReadDouble("/driver/in_accel_x_raw", xPtr);
+    r = file_ReadDoubleFrom(Attributes[ATTR_ACCEL_X], xPtr);
     if (r != LE_OK)
     {
         goto done;
     }
     *xPtr *= scaling;
 
-    r = file_ReadDouble("/driver/in_accel_y_raw", yPtr);
+    r = file_ReadDoubleFrom(Attributes[ATTR_ACCEL_Y], yPtr);
     if (r != LE_OK)
     {
         goto done;
     }
     *yPtr *= scaling;
 
-    r = file_ReadDouble("/driver/in_accel_z_raw", zPtr);
+    r = file_ReadDoubleFrom(Attributes[ATTR_ACCEL_Z], zPtr);
     if (r != LE_OK)
     {
         goto done;
@@ -88,27 +146,27 @@ le_result_t imu_ReadGyro
     le_result_t r;
 
     double scaling = 0.0;
-    r = file_ReadDouble("/driver/in_anglvel_scale", &scaling);
+    r = file_ReadDoubleFrom(Attributes[ATTR_GYRO_SCALE], &scaling);
     if (r != LE_OK)
     {
         goto done;
     }
 
-    r = file_ReadDouble("/driver/in_anglvel_x_raw", xPtr);
+    r = file_ReadDoubleFrom(Attributes[ATTR_GYRO_X], xPtr);
     if (r != LE_OK)
     {
         goto done;
     }
     *xPtr *= scaling;
 
-    r = file_ReadDouble("/driver/in_anglvel_y_raw", yPtr);
+    r = file_ReadDoubleFrom(Attributes[ATTR_GYRO_Y], yPtr);
     if (r != LE_OK)
     {
         goto done;
     }
     *yPtr *= scaling;
 
-    r = file_ReadDouble("/driver/in_anglvel_z_raw", zPtr);
+    r = file_ReadDoubleFrom(Attributes[ATTR_GYRO_Z], zPtr);
     if (r != LE_OK)
     {
         goto done;
@@ -136,7 +194,7 @@ le_result_t temperature_Read
     le_result_t r;
 
     double scaling = 0.0;
-    r = file_ReadDouble("/driver/in_temp_scale", &scaling);
+    r = file_ReadDoubleFrom(Attributes[ATTR_TEMP_SCALE], &scaling);
     if (r != LE_OK)
     {
         LE_ERROR("Failed to read scale");
@@ -144,14 +202,14 @@ le_result_t temperature_Read
     }
 
     double offset = 0.0;
-    r = file_ReadDouble("/driver/in_temp_offset", &offset);
+    r = file_ReadDoubleFrom(Attributes[ATTR_TEMP_OFFSET], &offset);
     if (r != LE_OK)
     {
         LE_ERROR("Failed to read offset (%s)", LE_RESULT_TXT(r));
         goto done;
     }
 
-    r = file_ReadDouble("/driver/in_temp_raw", readingPtr);
+    r = file_ReadDoubleFrom(Attributes[ATTR_TEMP_RAW], readingPtr);
     if (r != LE_OK)
     {
         LE_ERROR("Failed to read raw value (%s)", LE_RESULT_TXT(r));
@@ -167,99 +225,189 @@ done:
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Sample the gyroscope and publish the results to the Data Hub.
+ * The IMU's sensors.  They're all read from the same IIO device, so they're sampled as a group
+ * and don't need sample functions of their own.
  */
 //--------------------------------------------------------------------------------------------------
-static void SampleGyro
-(
-    psensor_Ref_t ref,
-    void *contextPtr
-)
+enum
 {
-    double x;
-    double y;
-    double z;
+    GYRO,
+    ACCEL,
+    TEMP,
+    SENSOR_COUNT
+};
 
-    le_result_t result = imu_ReadGyro(&x, &y, &z);
+#define VECTOR_EXAMPLE "{\"x\":0.1,\"y\":0.2,\"z\":0.3}"
 
-    if (result == LE_OK)
-    {
-        char sample[256];
+static const psensor_Descriptor_t Sensors[SENSOR_COUNT] =
+{
+    [GYRO] = { "gyro", DHUBIO_DATA_TYPE_JSON, NULL, NULL, NULL, 10, VECTOR_EXAMPLE },
+    [ACCEL] = { "accel", DHUBIO_DATA_TYPE_JSON, NULL, NULL, NULL, 10, VECTOR_EXAMPLE },
+    [TEMP] = { "imu/temp", DHUBIO_DATA_TYPE_NUMERIC, "degC", NULL, NULL, 10, NULL },
+};
 
-        int len = snprintf(sample, sizeof(sample), "{\"x\":%lf, \"y\":%lf, \"z\":%lf}", x, y, z);
-        if (len >= sizeof(sample))
-        {
-            LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(sample));
-        }
+static psensor_Ref_t SensorRefs[SENSOR_COUNT];
 
-        psensor_PushJson(ref, 0 /* now */, sample);
-    }
-    else
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * While the gyro or accelerometer is sampled more often than every BATCH_INTERVAL seconds, its
+ * samples are batched (see psensor_SetBatching()) so that they reach the Data Hub about that
+ * often, however fast they're taken.  Slower sampling isn't batched, so it doesn't cost an extra
+ * wakeup per sample.
+ */
+//--------------------------------------------------------------------------------------------------
+#define BATCH_INTERVAL      1.0
+#define MAX_BATCH_COUNT     50
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The dead reckoning sensor's enable resource (see deadReckoning.h).
+ */
+//--------------------------------------------------------------------------------------------------
+#define DEAD_RECKONING_ENABLE_PATH "deadReckoning/enable"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push an x/y/z vector sample to the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushVector
+(
+    psensor_Ref_t ref,
+    double x,
+    double y,
+    double z
+)
+{
+    char sample[256];
+
+    int len = snprintf(sample, sizeof(sample), "{\"x\":%lf, \"y\":%lf, \"z\":%lf}", x, y, z);
+    if (len >= sizeof(sample))
     {
-        LE_ERROR("Failed to read gyro (%s).", LE_RESULT_TXT(result));
+        LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(sample));
     }
+
+    psensor_PushJson(ref, 0 /* now */, sample);
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Sample the accelerometer and publish the results to the Data Hub.
+ * Sample whichever of the gyroscope, accelerometer and temperature are due, in one pass, and
+ * publish the results to the Data Hub.  The samples all get the same timestamp, so the gyro and
+ * accelerometer readings line up for anything downstream that fuses them.
  */
 //--------------------------------------------------------------------------------------------------
-static void SampleAccel
+static void SampleImu
 (
-    psensor_Ref_t ref,
+    psensor_GroupRef_t group,
     void *contextPtr
 )
 {
     double x;
     double y;
     double z;
+    le_result_t result;
 
-    le_result_t result = imu_ReadAccel(&x, &y, &z);
-
-    if (result == LE_OK)
+    if (psensor_IsSampling(SensorRefs[GYRO]))
     {
-        char sample[256];
-
-        int len = snprintf(sample, sizeof(sample), "{\"x\":%lf, \"y\":%lf, \"z\":%lf}", x, y, z);
-        if (len >= sizeof(sample))
+        result = imu_ReadGyro(&x, &y, &z);
+        if (result == LE_OK)
         {
-            LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(sample));
+            PushVector(SensorRefs[GYRO], x, y, z);
         }
+        else
+        {
+            LE_ERROR("Failed to read gyro (%s).", LE_RESULT_TXT(result));
+        }
+    }
 
-        psensor_PushJson(ref, 0 /* now */, sample);
+    if (psensor_IsSampling(SensorRefs[ACCEL]))
+    {
+        result = imu_ReadAccel(&x, &y, &z);
+        if (result == LE_OK)
+        {
+            PushVector(SensorRefs[ACCEL], x, y, z);
+        }
+        else
+        {
+            LE_ERROR("Failed to read accelerometer (%s).", LE_RESULT_TXT(result));
+        }
     }
-    else
+
+    if (psensor_IsSampling(SensorRefs[TEMP]))
     {
-        LE_ERROR("Failed to read accelerometer (%s).", LE_RESULT_TXT(result));
+        double sample;
+
+        result = temperature_Read(&sample);
+        if (result == LE_OK)
+        {
+            psensor_PushNumeric(SensorRefs[TEMP], 0 /* now */, sample);
+        }
+        else
+        {
+            LE_ERROR("Failed to read IMU temperature (%s).", LE_RESULT_TXT(result));
+        }
     }
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Sample the temperature and publish the results to the Data Hub.
+ * Batch a vector sensor's samples, or not, to suit its new sampling period.
  */
 //--------------------------------------------------------------------------------------------------
-static void SampleTemp
+static void HandlePeriodPush
 (
-    psensor_Ref_t ref,
-    void *contextPtr
+    double timestamp,
+    double period,      ///< seconds
+    void* contextPtr    ///< psensor_Ref_t
 )
 {
-    double sample;
-
-    le_result_t result = temperature_Read(&sample);
+    uint32_t count = 0;
 
-    if (result == LE_OK)
+    if ((period > 0.0) && (period < BATCH_INTERVAL))
     {
-        psensor_PushNumeric(ref, 0 /* now */, sample);
-    }
-    else
-    {
-        LE_ERROR("Failed to read IMU temperature (%s).", LE_RESULT_TXT(result));
+        count = (uint32_t)fmin(ceil(BATCH_INTERVAL / period), MAX_BATCH_COUNT);
     }
+
+    psensor_SetBatching(contextPtr, count, (uint32_t)(BATCH_INTERVAL * 1000));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Feed each step of the orientation filter to dead reckoning.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleOrientationUpdate
+(
+    double step,
+    const double accel[3],
+    const double q[4],
+    void* contextPtr
+)
+{
+    deadReckoning_Step(step, accel, q);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Keep the orientation filter running while dead reckoning is enabled.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleDeadReckoningEnablePush
+(
+    double timestamp,
+    bool enable,
+    void* contextPtr
+)
+{
+    orientation_SetRequired(enable);
 }
 
 
@@ -270,11 +418,42 @@ static void SampleTemp
 //--------------------------------------------------------------------------------------------------
 COMPONENT_INIT
 {
-    // Use the Periodic Sensor component from the Data Hub to implement the sensor interfaces.
-    psensor_Create("gyro", DHUBIO_DATA_TYPE_JSON, "", SampleGyro, NULL);
-    psensor_Create("accel", DHUBIO_DATA_TYPE_JSON, "", SampleAccel, NULL);
-    psensor_Create("imu/temp", DHUBIO_DATA_TYPE_NUMERIC, "degC", SampleTemp, NULL);
+    for (size_t i = 0; i < ATTR_COUNT; i++)
+    {
+        if ((i == ATTR_ACCEL_SCALE) || (i == ATTR_GYRO_SCALE) ||
+            (i == ATTR_TEMP_SCALE) || (i == ATTR_TEMP_OFFSET))
+        {
+            Attributes[i] = file_OpenCached(AttributePaths[i], CALIBRATION_MAX_AGE);
+        }
+        else
+        {
+            Attributes[i] = file_Open(AttributePaths[i]);
+        }
+    }
 
-    dhubIO_SetJsonExample("gyro/value", "{\"x\":0.1,\"y\":0.2,\"z\":0.3}");
-    dhubIO_SetJsonExample("accel/value", "{\"x\":0.1,\"y\":0.2,\"z\":0.3}");
+    // Use the Periodic Sensor component from the Data Hub to implement the sensor interfaces.
+    psensor_CreateFromTable(Sensors, SENSOR_COUNT, SensorRefs);
+
+    psensor_GroupRef_t group = psensor_CreateGroup(SampleImu, NULL);
+    psensor_AddToGroup(group, SensorRefs[GYRO]);
+    psensor_AddToGroup(group, SensorRefs[ACCEL]);
+    psensor_AddToGroup(group, SensorRefs[TEMP]);
+
+    // Drop x/y/z samples that haven't changed by the deadband the consumer sets (dataPublisher
+    // does) before they reach the Data Hub.
+    psensor_EnableDeadband(SensorRefs[GYRO], PSENSOR_DEADBAND_PER_MEMBER);
+    psensor_EnableDeadband(SensorRefs[ACCEL], PSENSOR_DEADBAND_PER_MEMBER);
+
+    // The periodic sensors handle their own periods; this only follows them to set the batching.
+    dhubIO_AddNumericPushHandler("gyro/period", HandlePeriodPush, SensorRefs[GYRO]);
+    dhubIO_AddNumericPushHandler("accel/period", HandlePeriodPush, SensorRefs[ACCEL]);
+
+    imuStream_Init();
+    vibration_Init();
+    orientation_Init();
+    shock_Init();
+    motion_Init();
+
+    orientation_SetUpdateHandler(HandleOrientationUpdate, NULL);
+    dhubIO_AddBooleanPushHandler(DEAD_RECKONING_ENABLE_PATH, HandleDeadReckoningEnablePush, NULL);
 }
@@ -0,0 +1,1059 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file imuStream.c
+ *
+ * High-rate streaming of IMU samples through the IIO triggered buffer.
+ *
+ * Reading the accelerometer and gyro one sysfs attribute at a time limits the sampling rate to a
+ * few Hz and gives no precise timestamps.  In streaming mode, the IIO scan elements and a trigger
+ * are enabled and the driver fills its buffer with packed binary scans (all six axes plus a
+ * timestamp), which are read from the IIO character device by a reader thread.
+ *
+ * The reader thread only parses scans and puts them in a single-producer, single-consumer
+ * lock-free ring.  The main thread drains the ring every DRAIN_INTERVAL_MS and:
+ * - aggregates the scans into a summary that is pushed to the "imu/stream" periodic sensor,
+ * - keeps a short history that can be pushed as a raw burst on demand, and
+ * - hands the scans to any other handlers (see imuStream_AddScanHandler()).
+ *
+ * Data Hub resources (relative to the app):
+ * - imu/stream/rate (output, Hz) - streaming rate.  0 (the default) stops streaming, unless
+ *   another part of the component needs it (see imuStream_SetMinRate()).
+ * - imu/stream/value (input, JSON) - aggregated scans, pushed once per imu/stream/period.
+ * - imu/stream/burst/count (output) - number of scans in a raw burst.
+ * - imu/stream/burst/trigger (output) - push the latest raw scans to imu/stream/burst/value.
+ * - imu/stream/burst/value (input, JSON) - raw burst.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "imuStream.h"
+#include "fileUtils.h"
+#include "periodicSensor.h"
+#include "dhubUtils.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * IIO device paths.  The sysfs directories are bound to /driver/ in the component definition.
+ */
+//--------------------------------------------------------------------------------------------------
+#define DEVICE_PATH             "/dev/iio:device0"
+#define SCAN_ELEMENTS_DIR       "/driver/scan_elements/"
+#define BUFFER_ENABLE_PATH      "/driver/buffer/enable"
+#define BUFFER_LENGTH_PATH      "/driver/buffer/length"
+#define CURRENT_TRIGGER_PATH    "/driver/trigger/current_trigger"
+#define ACCEL_FREQUENCY_PATH    "/driver/in_accel_sampling_frequency"
+#define GYRO_FREQUENCY_PATH     "/driver/in_anglvel_sampling_frequency"
+#define ACCEL_SCALE_PATH        "/driver/in_accel_scale"
+#define GYRO_SCALE_PATH         "/driver/in_anglvel_scale"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Name of the IIO trigger that clocks the buffer (the IMU's data-ready trigger).
+ */
+//--------------------------------------------------------------------------------------------------
+#define STREAM_TRIGGER "bmi160-dev0"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Length (in scans) of the kernel's buffer.
+ */
+//--------------------------------------------------------------------------------------------------
+#define KERNEL_BUFFER_LENGTH 256
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of scans in the ring between the reader thread and the main thread.  Must be a power of
+ * two.  Holds more than one DRAIN_INTERVAL_MS worth of scans at the highest rate.
+ */
+//--------------------------------------------------------------------------------------------------
+#define RING_SIZE 1024
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * How often (milliseconds) the main thread drains the ring while streaming.
+ */
+//--------------------------------------------------------------------------------------------------
+#define DRAIN_INTERVAL_MS 100
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of most recent scans kept for raw bursts, and the default burst size.
+ */
+//--------------------------------------------------------------------------------------------------
+#define HISTORY_SIZE 256
+#define DEFAULT_BURST_COUNT 64
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Largest scan (in bytes) and the most scans fetched from the device in one read().
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_SCAN_BYTES 64
+#define READ_MAX_SCANS 64
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of handlers that can be added with imuStream_AddScanHandler().
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_SCAN_HANDLERS 4
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data Hub resource paths.
+ */
+//--------------------------------------------------------------------------------------------------
+#define RATE_PATH           "imu/stream/rate"
+#define BURST_COUNT_PATH    "imu/stream/burst/count"
+#define BURST_TRIGGER_PATH  "imu/stream/burst/trigger"
+#define BURST_VALUE_PATH    "imu/stream/burst/value"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Channels captured in each scan.  Axis channels are in the same order as the members of
+ * imuStream_Scan_t.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    CHAN_ACCEL_X,
+    CHAN_ACCEL_Y,
+    CHAN_ACCEL_Z,
+    CHAN_GYRO_X,
+    CHAN_GYRO_Y,
+    CHAN_GYRO_Z,
+    CHAN_TIMESTAMP,
+    CHAN_COUNT
+}
+Channel_t;
+
+static const char* const ChannelNames[CHAN_COUNT] =
+{
+    [CHAN_ACCEL_X]      = "accel_x",
+    [CHAN_ACCEL_Y]      = "accel_y",
+    [CHAN_ACCEL_Z]      = "accel_z",
+    [CHAN_GYRO_X]       = "anglvel_x",
+    [CHAN_GYRO_Y]       = "anglvel_y",
+    [CHAN_GYRO_Z]       = "anglvel_z",
+    [CHAN_TIMESTAMP]    = "timestamp",
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Where and how a channel is stored in a scan (from scan_elements/in_<name>_index and _type).
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    unsigned int index;     ///< Position of the channel in the scan.
+    bool isBigEndian;
+    bool isSigned;
+    unsigned int realBits;  ///< Number of significant bits.
+    unsigned int storageBytes;
+    unsigned int shift;     ///< Right shift to apply before masking to realBits.
+    size_t offset;          ///< Byte offset of the channel in the scan.
+}
+ChannelLayout_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scan layout.  Worked out when streaming is first started, before the reader thread reads any
+ * scans, and never changed after that.
+ */
+//--------------------------------------------------------------------------------------------------
+static ChannelLayout_t Layout[CHAN_COUNT];
+static size_t ScanBytes = 0;
+static double AccelScale = 1.0;
+static double GyroScale = 1.0;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Lock-free single-producer (reader thread), single-consumer (main thread) ring of scans.
+ * RingHead is only written by the reader thread and RingTail only by the main thread.  They count
+ * up forever, and are reduced modulo RING_SIZE to index Ring[].
+ */
+//--------------------------------------------------------------------------------------------------
+static imuStream_Scan_t Ring[RING_SIZE];
+static uint32_t RingHead = 0;
+static uint32_t RingTail = 0;
+static uint32_t RingOverruns = 0;   ///< Scans dropped because the ring was full.
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Summary of the scans received since the last push to "imu/stream/value".  Main thread only.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t count;
+    double firstTimestamp;
+    double lastTimestamp;
+    double sum[6];      ///< accel x, y, z, gyro x, y, z
+    double sumSq[6];
+    double peak[6];     ///< Largest magnitude seen.
+}
+Aggregate_t;
+
+static Aggregate_t Aggregate;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The latest scans, for raw bursts.  Main thread only.
+ */
+//--------------------------------------------------------------------------------------------------
+static imuStream_Scan_t History[HISTORY_SIZE];
+static size_t HistoryNext = 0;      ///< Where the next scan will go.
+static size_t HistoryCount = 0;     ///< Number of valid scans in History[].
+static uint32_t BurstCount = DEFAULT_BURST_COUNT;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Registered scan handlers.
+ */
+//--------------------------------------------------------------------------------------------------
+static struct
+{
+    imuStream_ScanHandlerFunc_t func;
+    void* contextPtr;
+}
+ScanHandlers[MAX_SCAN_HANDLERS];
+static size_t ScanHandlerCount = 0;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Streaming state.  Main thread only.
+ */
+//--------------------------------------------------------------------------------------------------
+static double StreamRate = 0.0;             ///< Hz (0 = not streaming).
+static double RequestedRate = 0.0;          ///< Hz, from imu/stream/rate.
+static double MinRate = 0.0;                ///< Hz, from imuStream_SetMinRate().
+static bool IsDeviceOpen = false;           ///< true once the reader thread has been started.
+static le_thread_Ref_t ReaderThread = NULL;
+static le_timer_Ref_t DrainTimer = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reader thread state.  Reader thread only.
+ */
+//--------------------------------------------------------------------------------------------------
+static int DeviceFd = -1;
+static le_fdMonitor_Ref_t DeviceMonitor = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Work out the layout of one channel from its sysfs scan element attributes.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadChannelLayout
+(
+    Channel_t channel
+)
+{
+    char path[LIMIT_MAX_PATH_BYTES];
+    char type[32];
+    int index;
+    le_result_t r;
+
+    ChannelLayout_t* layoutPtr = &Layout[channel];
+
+    (void)snprintf(path, sizeof(path), SCAN_ELEMENTS_DIR "in_%s_en", ChannelNames[channel]);
+    r = file_WriteString(path, "1");
+    if (r != LE_OK)
+    {
+        return r;
+    }
+
+    (void)snprintf(path, sizeof(path), SCAN_ELEMENTS_DIR "in_%s_index", ChannelNames[channel]);
+    r = file_ReadInt(path, &index);
+    if (r != LE_OK)
+    {
+        return r;
+    }
+
+    if (index < 0)
+    {
+        LE_ERROR("Invalid scan index %d for channel %s.", index, ChannelNames[channel]);
+        return LE_FORMAT_ERROR;
+    }
+
+    // The type looks like "le:s16/16>>0" (endianness, sign, real bits / storage bits >> shift).
+    (void)snprintf(path, sizeof(path), SCAN_ELEMENTS_DIR "in_%s_type", ChannelNames[channel]);
+    r = file_ReadString(path, type, sizeof(type));
+    if (r != LE_OK)
+    {
+        return r;
+    }
+
+    char endian;
+    char sign;
+    unsigned int realBits;
+    unsigned int storageBits;
+    unsigned int shift;
+
+    if ((sscanf(type, "%ce:%c%u/%u>>%u", &endian, &sign, &realBits, &storageBits, &shift) != 5)
+        || (storageBits == 0) || (storageBits % 8 != 0) || (storageBits > 64)
+        || (realBits > storageBits))
+    {
+        LE_ERROR("Unsupported scan element type '%s' for channel %s.",
+                 type,
+                 ChannelNames[channel]);
+        return LE_FORMAT_ERROR;
+    }
+
+    layoutPtr->index = (unsigned int)index;
+    layoutPtr->isBigEndian = (endian == 'b');
+    layoutPtr->isSigned = (sign == 's');
+    layoutPtr->realBits = realBits;
+    layoutPtr->storageBytes = storageBits / 8;
+    layoutPtr->shift = shift;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compare two channels by their position in the scan, for qsort().
+ */
+//--------------------------------------------------------------------------------------------------
+static int CompareChannelIndex
+(
+    const void* aPtr,
+    const void* bPtr
+)
+{
+    unsigned int a = Layout[*(const Channel_t*)aPtr].index;
+    unsigned int b = Layout[*(const Channel_t*)bPtr].index;
+
+    return (a > b) - (a < b);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Enable the scan elements and work out the scan layout.  Channels are packed in index order, each
+ * aligned to its own size, and the scan is padded to a multiple of its largest channel.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SetUpLayout
+(
+    void
+)
+{
+    size_t largest = 1;
+    Channel_t order[CHAN_COUNT];
+
+    for (Channel_t channel = 0; channel < CHAN_COUNT; channel++)
+    {
+        le_result_t r = ReadChannelLayout(channel);
+        if (r != LE_OK)
+        {
+            return r;
+        }
+        order[channel] = channel;
+    }
+
+    qsort(order, CHAN_COUNT, sizeof(order[0]), CompareChannelIndex);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < CHAN_COUNT; i++)
+    {
+        ChannelLayout_t* layoutPtr = &Layout[order[i]];
+        size_t size = layoutPtr->storageBytes;
+
+        if ((i > 0) && (layoutPtr->index == Layout[order[i - 1]].index))
+        {
+            LE_ERROR("Channels %s and %s have the same scan index (%u).",
+                     ChannelNames[order[i - 1]],
+                     ChannelNames[order[i]],
+                     layoutPtr->index);
+            return LE_FORMAT_ERROR;
+        }
+
+        offset = (offset + size - 1) / size * size;
+        layoutPtr->offset = offset;
+        offset += size;
+
+        if (size > largest)
+        {
+            largest = size;
+        }
+    }
+
+    ScanBytes = (offset + largest - 1) / largest * largest;
+
+    if ((ScanBytes == 0) || (ScanBytes > MAX_SCAN_BYTES))
+    {
+        LE_ERROR("Unsupported scan size (%zu bytes).", ScanBytes);
+        return LE_FORMAT_ERROR;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Extract one channel's value from a raw scan.
+ *
+ * @return The raw (unscaled) value.
+ */
+//--------------------------------------------------------------------------------------------------
+static int64_t ExtractChannel
+(
+    const uint8_t* scanPtr,
+    Channel_t channel
+)
+{
+    const ChannelLayout_t* layoutPtr = &Layout[channel];
+    const uint8_t* bytesPtr = scanPtr + layoutPtr->offset;
+    uint64_t raw = 0;
+
+    for (unsigned int i = 0; i < layoutPtr->storageBytes; i++)
+    {
+        unsigned int byteIndex = layoutPtr->isBigEndian ? i
+                                                        : (layoutPtr->storageBytes - 1 - i);
+        raw = (raw << 8) | bytesPtr[byteIndex];
+    }
+
+    raw >>= layoutPtr->shift;
+
+    if (layoutPtr->realBits < 64)
+    {
+        raw &= ((uint64_t)1 << layoutPtr->realBits) - 1;
+
+        if (layoutPtr->isSigned && (raw & ((uint64_t)1 << (layoutPtr->realBits - 1))))
+        {
+            raw |= ~(((uint64_t)1 << layoutPtr->realBits) - 1);  // Sign extend.
+        }
+    }
+
+    return (int64_t)raw;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Put a scan in the ring.  Reader thread only.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushScan
+(
+    const imuStream_Scan_t* scanPtr
+)
+{
+    uint32_t head = __atomic_load_n(&RingHead, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&RingTail, __ATOMIC_ACQUIRE);
+
+    if ((head - tail) >= RING_SIZE)
+    {
+        __atomic_add_fetch(&RingOverruns, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    Ring[head & (RING_SIZE - 1)] = *scanPtr;
+
+    // Publish the scan only after it has been written.
+    __atomic_store_n(&RingHead, head + 1, __ATOMIC_RELEASE);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read whatever scans are waiting in the device and put them in the ring.  Reader thread only.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleDeviceReadable
+(
+    int fd,
+    short events
+)
+{
+    uint8_t buffer[READ_MAX_SCANS * MAX_SCAN_BYTES];
+
+    if (events & (POLLERR | POLLHUP))
+    {
+        LE_ERROR("IIO device error (events 0x%x).", events);
+    }
+
+    for (;;)
+    {
+        ssize_t len = read(fd, buffer, READ_MAX_SCANS * ScanBytes);
+        if (len <= 0)
+        {
+            if ((len < 0) && (errno != EAGAIN) && (errno != EINTR))
+            {
+                LE_ERROR("Failed to read IIO device - %m");
+            }
+            return;
+        }
+
+        for (size_t offset = 0; (offset + ScanBytes) <= (size_t)len; offset += ScanBytes)
+        {
+            const uint8_t* scanPtr = buffer + offset;
+            imuStream_Scan_t scan;
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                scan.accel[axis] = ExtractChannel(scanPtr, CHAN_ACCEL_X + axis) * AccelScale;
+                scan.gyro[axis] = ExtractChannel(scanPtr, CHAN_GYRO_X + axis) * GyroScale;
+            }
+            scan.timestamp = (double)ExtractChannel(scanPtr, CHAN_TIMESTAMP) / 1000000000.0;
+
+            PushScan(&scan);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open the IIO device and start watching it.  Runs on the reader thread.
+ */
+//--------------------------------------------------------------------------------------------------
+static void OpenDevice
+(
+    void* param1Ptr,
+    void* param2Ptr
+)
+{
+    DeviceFd = open(DEVICE_PATH, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (DeviceFd < 0)
+    {
+        LE_ERROR("Couldn't open '%s' - %m", DEVICE_PATH);
+        return;
+    }
+
+    DeviceMonitor = le_fdMonitor_Create("imuStream", DeviceFd, HandleDeviceReadable, POLLIN);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reader thread main function.
+ */
+//--------------------------------------------------------------------------------------------------
+static void* ReaderMain
+(
+    void* contextPtr
+)
+{
+    le_event_RunLoop();
+
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Feed a run of contiguous scans to the aggregate, the history and the scan handlers.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ProcessScans
+(
+    const imuStream_Scan_t* scansPtr,
+    size_t count
+)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const imuStream_Scan_t* scanPtr = &scansPtr[i];
+        const double values[6] =
+        {
+            scanPtr->accel[0], scanPtr->accel[1], scanPtr->accel[2],
+            scanPtr->gyro[0], scanPtr->gyro[1], scanPtr->gyro[2],
+        };
+
+        if (Aggregate.count == 0)
+        {
+            Aggregate.firstTimestamp = scanPtr->timestamp;
+        }
+        Aggregate.lastTimestamp = scanPtr->timestamp;
+        Aggregate.count++;
+
+        for (int j = 0; j < 6; j++)
+        {
+            Aggregate.sum[j] += values[j];
+            Aggregate.sumSq[j] += values[j] * values[j];
+            Aggregate.peak[j] = fmax(Aggregate.peak[j], fabs(values[j]));
+        }
+
+        History[HistoryNext] = *scanPtr;
+        HistoryNext = (HistoryNext + 1) % HISTORY_SIZE;
+        if (HistoryCount < HISTORY_SIZE)
+        {
+            HistoryCount++;
+        }
+    }
+
+    for (size_t h = 0; h < ScanHandlerCount; h++)
+    {
+        ScanHandlers[h].func(scansPtr, count, ScanHandlers[h].contextPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Take all the scans out of the ring and process them.  Main thread only.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Drain
+(
+    void
+)
+{
+    uint32_t tail = __atomic_load_n(&RingTail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&RingHead, __ATOMIC_ACQUIRE);
+
+    while (tail != head)
+    {
+        // Process up to the end of the ring's storage, then wrap around.
+        size_t start = tail & (RING_SIZE - 1);
+        size_t count = head - tail;
+        if (count > (RING_SIZE - start))
+        {
+            count = RING_SIZE - start;
+        }
+
+        ProcessScans(&Ring[start], count);
+        tail += count;
+    }
+
+    // Hand the slots back to the reader thread only after they've been processed.
+    __atomic_store_n(&RingTail, tail, __ATOMIC_RELEASE);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Drain timer expiry handler.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleDrainTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    Drain();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push the aggregate of the scans received since the last push.  Sample function of the
+ * "imu/stream" periodic sensor.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SampleStream
+(
+    psensor_Ref_t ref,
+    void *contextPtr
+)
+{
+    Drain();
+
+    uint32_t count = Aggregate.count;
+    if (count == 0)
+    {
+        return;
+    }
+
+    double mean[6];
+    double rms[6];
+    for (int j = 0; j < 6; j++)
+    {
+        mean[j] = Aggregate.sum[j] / count;
+        rms[j] = sqrt(Aggregate.sumSq[j] / count);
+    }
+
+    double span = Aggregate.lastTimestamp - Aggregate.firstTimestamp;
+    double rate = ((count > 1) && (span > 0.0)) ? ((count - 1) / span) : 0.0;
+
+    char json[512];
+    int len = snprintf(json,
+                       sizeof(json),
+                       "{\"n\":%u,\"rate\":%.1f,\"overruns\":%u,"
+                       "\"accel\":{\"mean\":[%.4f,%.4f,%.4f],\"rms\":[%.4f,%.4f,%.4f],"
+                       "\"peak\":[%.4f,%.4f,%.4f]},"
+                       "\"gyro\":{\"mean\":[%.5f,%.5f,%.5f],\"rms\":[%.5f,%.5f,%.5f],"
+                       "\"peak\":[%.5f,%.5f,%.5f]}}",
+                       count,
+                       rate,
+                       __atomic_load_n(&RingOverruns, __ATOMIC_RELAXED),
+                       mean[0], mean[1], mean[2], rms[0], rms[1], rms[2],
+                       Aggregate.peak[0], Aggregate.peak[1], Aggregate.peak[2],
+                       mean[3], mean[4], mean[5], rms[3], rms[4], rms[5],
+                       Aggregate.peak[3], Aggregate.peak[4], Aggregate.peak[5]);
+    if (len >= sizeof(json))
+    {
+        LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(json));
+    }
+
+    psensor_PushJson(ref, Aggregate.lastTimestamp, json);
+
+    memset(&Aggregate, 0, sizeof(Aggregate));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push the latest raw scans to the burst resource, oldest first.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleBurstTrigger
+(
+    double timestamp,
+    void* contextPtr
+)
+{
+    static char json[DHUBIO_MAX_STRING_VALUE_LEN + 1];
+
+    Drain();
+
+    size_t count = (BurstCount < HistoryCount) ? BurstCount : HistoryCount;
+    if (count == 0)
+    {
+        LE_WARN("No scans to burst (is the IMU streaming?).");
+        return;
+    }
+
+    size_t first = (HistoryNext + HISTORY_SIZE - count) % HISTORY_SIZE;
+    size_t len = 0;
+
+    len += snprintf(json + len,
+                    sizeof(json) - len,
+                    "{\"t0\":%.6f,\"dt\":[",
+                    History[first].timestamp);
+
+    for (size_t i = 0; (i < count) && (len < sizeof(json)); i++)
+    {
+        const imuStream_Scan_t* scanPtr = &History[(first + i) % HISTORY_SIZE];
+        len += snprintf(json + len,
+                        sizeof(json) - len,
+                        "%s%.6f",
+                        (i == 0) ? "" : ",",
+                        scanPtr->timestamp - History[first].timestamp);
+    }
+
+    const char* const members[] = { "accel", "gyro" };
+    for (int m = 0; (m < 2) && (len < sizeof(json)); m++)
+    {
+        len += snprintf(json + len, sizeof(json) - len, "],\"%s\":[", members[m]);
+
+        for (size_t i = 0; (i < count) && (len < sizeof(json)); i++)
+        {
+            const imuStream_Scan_t* scanPtr = &History[(first + i) % HISTORY_SIZE];
+            const double* axesPtr = (m == 0) ? scanPtr->accel : scanPtr->gyro;
+
+            len += snprintf(json + len,
+                            sizeof(json) - len,
+                            "%s[%.4f,%.4f,%.4f]",
+                            (i == 0) ? "" : ",",
+                            axesPtr[0],
+                            axesPtr[1],
+                            axesPtr[2]);
+        }
+    }
+
+    if (len < sizeof(json))
+    {
+        len += snprintf(json + len, sizeof(json) - len, "]}");
+    }
+
+    if (len >= sizeof(json))
+    {
+        LE_ERROR("Burst of %zu scans is too big for the Data Hub.", count);
+        return;
+    }
+
+    dhubIO_PushJson(BURST_VALUE_PATH, History[first].timestamp, json);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an update to the burst size.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleBurstCountPush
+(
+    double timestamp,
+    double value,
+    void* contextPtr
+)
+{
+    if (!(value >= 1.0) || (value > HISTORY_SIZE))
+    {
+        LE_ERROR("Burst count %lf out of range (1..%d).", value, HISTORY_SIZE);
+        return;
+    }
+
+    BurstCount = (uint32_t)value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop streaming.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StopStreaming
+(
+    void
+)
+{
+    (void)file_WriteString(BUFFER_ENABLE_PATH, "0");
+    le_timer_Stop(DrainTimer);
+
+    // Anything already in the ring still counts.
+    Drain();
+
+    StreamRate = 0.0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Configure the IIO buffer and trigger for a given rate and start streaming.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartStreaming
+(
+    double rate     ///< Hz
+)
+{
+    char text[32];
+    le_result_t r;
+
+    // The buffer must be disabled while it's being configured.
+    (void)file_WriteString(BUFFER_ENABLE_PATH, "0");
+
+    if (ScanBytes == 0)
+    {
+        r = SetUpLayout();
+        if (r != LE_OK)
+        {
+            return r;
+        }
+    }
+
+    // The scales don't change while streaming, so they're read once here.
+    r = file_ReadDouble(ACCEL_SCALE_PATH, &AccelScale);
+    if (r == LE_OK)
+    {
+        r = file_ReadDouble(GYRO_SCALE_PATH, &GyroScale);
+    }
+    if (r != LE_OK)
+    {
+        return r;
+    }
+
+    (void)snprintf(text, sizeof(text), "%g", rate);
+    if ((file_WriteString(ACCEL_FREQUENCY_PATH, text) != LE_OK) ||
+        (file_WriteString(GYRO_FREQUENCY_PATH, text) != LE_OK))
+    {
+        return LE_IO_ERROR;
+    }
+
+    (void)snprintf(text, sizeof(text), "%d", KERNEL_BUFFER_LENGTH);
+    if ((file_WriteString(CURRENT_TRIGGER_PATH, STREAM_TRIGGER) != LE_OK) ||
+        (file_WriteString(BUFFER_LENGTH_PATH, text) != LE_OK))
+    {
+        return LE_IO_ERROR;
+    }
+
+    // The layout (and scales) must be set before the reader thread sees any scans.  Queueing the
+    // open to the reader thread orders it after them.
+    if (!IsDeviceOpen)
+    {
+        le_event_QueueFunctionToThread(ReaderThread, OpenDevice, NULL, NULL);
+        IsDeviceOpen = true;
+    }
+
+    r = file_WriteString(BUFFER_ENABLE_PATH, "1");
+    if (r != LE_OK)
+    {
+        return r;
+    }
+
+    StreamRate = rate;
+    le_timer_Start(DrainTimer);
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stream at the higher of the requested and minimum rates, restarting streaming if that's changed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ApplyRate
+(
+    void
+)
+{
+    double rate = fmax(RequestedRate, MinRate);
+
+    if (rate == StreamRate)
+    {
+        return;
+    }
+
+    if (StreamRate > 0.0)
+    {
+        StopStreaming();
+    }
+
+    if (!(rate > 0.0))
+    {
+        return;
+    }
+
+    le_result_t r = StartStreaming(rate);
+    if (r != LE_OK)
+    {
+        LE_ERROR("Failed to start IMU streaming at %lf Hz (%s).", rate, LE_RESULT_TXT(r));
+        StopStreaming();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an update to the streaming rate.  0 stops streaming.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleRatePush
+(
+    double timestamp,
+    double rate,    ///< Hz
+    void* contextPtr
+)
+{
+    RequestedRate = (rate > 0.0) ? rate : 0.0;
+    ApplyRate();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the lowest rate to stream at, whatever imu/stream/rate says.  Used by parts of the IMU
+ * component that need the stream running.  0 removes the minimum.
+ */
+//--------------------------------------------------------------------------------------------------
+void imuStream_SetMinRate
+(
+    double rate     ///< Hz
+)
+{
+    MinRate = (rate > 0.0) ? rate : 0.0;
+    ApplyRate();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register a handler to be called with every scan received while streaming.
+ */
+//--------------------------------------------------------------------------------------------------
+void imuStream_AddScanHandler
+(
+    imuStream_ScanHandlerFunc_t handlerFunc,
+    void* contextPtr
+)
+{
+    LE_ASSERT(ScanHandlerCount < MAX_SCAN_HANDLERS);
+
+    ScanHandlers[ScanHandlerCount].func = handlerFunc;
+    ScanHandlers[ScanHandlerCount].contextPtr = contextPtr;
+    ScanHandlerCount++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the rate the IMU is streaming at.
+ *
+ * @return Scans per second, or 0 if not streaming.
+ */
+//--------------------------------------------------------------------------------------------------
+double imuStream_GetRate
+(
+    void
+)
+{
+    return StreamRate;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up streaming and its Data Hub resources.  Called by the IMU component's initializer.
+ */
+//--------------------------------------------------------------------------------------------------
+void imuStream_Init
+(
+    void
+)
+{
+    ReaderThread = le_thread_Create("imuStream", ReaderMain, NULL);
+    le_thread_Start(ReaderThread);
+
+    DrainTimer = le_timer_Create("imuStreamDrain");
+    le_timer_SetMsInterval(DrainTimer, DRAIN_INTERVAL_MS);
+    le_timer_SetRepeat(DrainTimer, 0);
+    le_timer_SetHandler(DrainTimer, HandleDrainTimer);
+
+    psensor_CreateJson("imu/stream",
+                       "{\"n\":100,\"rate\":100.0,\"overruns\":0,"
+                       "\"accel\":{\"mean\":[0,0,9.8],\"rms\":[0,0,9.8],\"peak\":[0,0,9.8]},"
+                       "\"gyro\":{\"mean\":[0,0,0],\"rms\":[0,0,0],\"peak\":[0,0,0]}}",
+                       SampleStream,
+                       NULL);
+
+    dhubUtils_CreateOutput(RATE_PATH, DHUBIO_DATA_TYPE_NUMERIC, "Hz");
+    dhubIO_AddNumericPushHandler(RATE_PATH, HandleRatePush, NULL);
+    dhubIO_SetNumericDefault(RATE_PATH, 0.0);
+
+    dhubUtils_CreateOutput(BURST_COUNT_PATH, DHUBIO_DATA_TYPE_NUMERIC, "");
+    dhubIO_AddNumericPushHandler(BURST_COUNT_PATH, HandleBurstCountPush, NULL);
+    dhubIO_SetNumericDefault(BURST_COUNT_PATH, DEFAULT_BURST_COUNT);
+    dhubIO_MarkOptional(BURST_COUNT_PATH);
+
+    dhubUtils_CreateOutput(BURST_TRIGGER_PATH, DHUBIO_DATA_TYPE_TRIGGER, "");
+    dhubIO_AddTriggerPushHandler(BURST_TRIGGER_PATH, HandleBurstTrigger, NULL);
+    dhubIO_MarkOptional(BURST_TRIGGER_PATH);
+
+    dhubUtils_CreateInput(BURST_VALUE_PATH, DHUBIO_DATA_TYPE_JSON, "");
+}
@@ -0,0 +1,92 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file imuStream.h
+ *
+ * High-rate streaming of IMU samples through the IIO triggered buffer.  Internal to the IMU
+ * component.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef IMU_STREAM_H_INCLUDE_GUARD
+#define IMU_STREAM_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * One scan of the IMU: an accelerometer and a gyro reading taken at the same instant.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    double timestamp;   ///< Seconds since the Epoch.
+    double accel[3];    ///< x, y, z (m/s2)
+    double gyro[3];     ///< x, y, z (rad/s)
+}
+imuStream_Scan_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler for streamed scans.  Called on the main thread with scans in time order; a batch of
+ * scans may be delivered in more than one call.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*imuStream_ScanHandlerFunc_t)
+(
+    const imuStream_Scan_t* scansPtr,
+    size_t count,
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register a handler to be called with every scan received while streaming.
+ */
+//--------------------------------------------------------------------------------------------------
+void imuStream_AddScanHandler
+(
+    imuStream_ScanHandlerFunc_t handlerFunc,
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the lowest rate to stream at, whatever imu/stream/rate says.  Used by parts of the IMU
+ * component that need the stream running.  0 removes the minimum.
+ */
+//--------------------------------------------------------------------------------------------------
+void imuStream_SetMinRate
+(
+    double rate     ///< Hz
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the rate the IMU is streaming at.
+ *
+ * @return Scans per second, or 0 if not streaming.
+ */
+//--------------------------------------------------------------------------------------------------
+double imuStream_GetRate
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up streaming and its Data Hub resources.  Called by the IMU component's initializer.
+ */
+//--------------------------------------------------------------------------------------------------
+void imuStream_Init
+(
+    void
+);
+
+
+#endif // IMU_STREAM_H_INCLUDE_GUARD
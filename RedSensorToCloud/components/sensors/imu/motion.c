@@ -0,0 +1,237 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file motion.c
+ *
+ * Motion (stationary/moving) detection from the IMU's accelerometer.
+ *
+ * The accelerometer is read at a low rate (MOTION_CHECK_PERIOD) and each reading is compared
+ * with the previous one.  A change of more than imu/motion/threshold counts as activity.  The
+ * device is moving as soon as there's any activity, and becomes stationary after
+ * imu/motion/stillTime seconds without any.  The state is handed to the Periodic Sensor
+ * component (see psensor_SetStationary()), which throttles the motion-gated sensors in this
+ * process while the device is stationary.
+ *
+ * Data Hub resources (relative to the app):
+ * - imu/motion/enable (output, boolean) - detect motion.  On by default.  While off, the device
+ *   is treated as moving.
+ * - imu/motion/threshold (output, m/s2) - change between readings that counts as activity.
+ * - imu/motion/stillTime (output, s) - time without activity after which the device is
+ *   stationary.
+ * - imu/motion/stationary (input, boolean) - pushed whenever the state changes.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "motion.h"
+#include "periodicSensor.h"
+#include "dhubUtils.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data Hub resource paths.
+ */
+//--------------------------------------------------------------------------------------------------
+#define ENABLE_PATH         "imu/motion/enable"
+#define THRESHOLD_PATH      "imu/motion/threshold"
+#define STILL_TIME_PATH     "imu/motion/stillTime"
+#define STATIONARY_PATH     "imu/motion/stationary"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time (ms) between accelerometer readings.
+ */
+//--------------------------------------------------------------------------------------------------
+#define MOTION_CHECK_PERIOD 1000
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Defaults.
+ */
+//--------------------------------------------------------------------------------------------------
+#define DEFAULT_THRESHOLD   0.4     // m/s2
+#define DEFAULT_STILL_TIME  120.0   // s
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Detector state.
+ */
+//--------------------------------------------------------------------------------------------------
+static double Threshold = DEFAULT_THRESHOLD;
+static double StillTime = DEFAULT_STILL_TIME;
+static bool HasLast = false;
+static double Last[3];
+static double LastActivity;     ///< Relative time (s) of the last activity.
+static le_timer_Ref_t CheckTimer = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current relative (monotonic) time, in seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double Now
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the device's state, pushing it to the Data Hub if it's changed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetStationary
+(
+    bool isStationary
+)
+{
+    if (isStationary != psensor_IsStationary())
+    {
+        psensor_SetStationary(isStationary);
+        dhubIO_PushBoolean(STATIONARY_PATH, DHUBIO_NOW, isStationary);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the accelerometer and update the state.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleCheckTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    double accel[3];
+
+    le_result_t result = imu_ReadAccel(&accel[0], &accel[1], &accel[2]);
+    if (result != LE_OK)
+    {
+        LE_ERROR("Failed to read accelerometer (%s).", LE_RESULT_TXT(result));
+        return;
+    }
+
+    double now = Now();
+
+    if (HasLast)
+    {
+        double dx = accel[0] - Last[0];
+        double dy = accel[1] - Last[1];
+        double dz = accel[2] - Last[2];
+
+        if (sqrt(dx * dx + dy * dy + dz * dz) > Threshold)
+        {
+            LastActivity = now;
+            SetStationary(false);
+        }
+        else if ((now - LastActivity) >= StillTime)
+        {
+            SetStationary(true);
+        }
+    }
+    else
+    {
+        LastActivity = now;
+        HasLast = true;
+    }
+
+    memcpy(Last, accel, sizeof(Last));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle motion detection being enabled or disabled.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleEnablePush
+(
+    double timestamp,
+    bool enable,
+    void* contextPtr
+)
+{
+    le_timer_Stop(CheckTimer);
+    HasLast = false;
+
+    if (enable)
+    {
+        le_timer_Start(CheckTimer);
+    }
+    else
+    {
+        SetStationary(false);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an update to the activity threshold or the still time.  The context pointer is the
+ * setting.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleSettingPush
+(
+    double timestamp,
+    double value,
+    void* contextPtr
+)
+{
+    if (!(value > 0.0))
+    {
+        LE_ERROR("Invalid motion detection setting %lf.", value);
+        return;
+    }
+
+    *(double*)contextPtr = value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up motion detection and its Data Hub resources.
+ */
+//--------------------------------------------------------------------------------------------------
+void motion_Init
+(
+    void
+)
+{
+    CheckTimer = le_timer_Create("motion");
+    le_timer_SetRepeat(CheckTimer, 0);
+    le_timer_SetMsInterval(CheckTimer, MOTION_CHECK_PERIOD);
+    le_timer_SetHandler(CheckTimer, HandleCheckTimer);
+
+    dhubUtils_CreateInput(STATIONARY_PATH, DHUBIO_DATA_TYPE_BOOLEAN, "");
+
+    dhubUtils_CreateOutput(THRESHOLD_PATH, DHUBIO_DATA_TYPE_NUMERIC, "m/s2");
+    dhubIO_AddNumericPushHandler(THRESHOLD_PATH, HandleSettingPush, &Threshold);
+    dhubIO_SetNumericDefault(THRESHOLD_PATH, DEFAULT_THRESHOLD);
+    dhubIO_MarkOptional(THRESHOLD_PATH);
+
+    dhubUtils_CreateOutput(STILL_TIME_PATH, DHUBIO_DATA_TYPE_NUMERIC, "s");
+    dhubIO_AddNumericPushHandler(STILL_TIME_PATH, HandleSettingPush, &StillTime);
+    dhubIO_SetNumericDefault(STILL_TIME_PATH, DEFAULT_STILL_TIME);
+    dhubIO_MarkOptional(STILL_TIME_PATH);
+
+    dhubUtils_CreateOutput(ENABLE_PATH, DHUBIO_DATA_TYPE_BOOLEAN, "");
+    dhubIO_AddBooleanPushHandler(ENABLE_PATH, HandleEnablePush, NULL);
+    dhubIO_SetBooleanDefault(ENABLE_PATH, true);
+    dhubIO_MarkOptional(ENABLE_PATH);
+    HandleEnablePush(0.0, true, NULL);
+}
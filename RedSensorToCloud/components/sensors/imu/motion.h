@@ -0,0 +1,27 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file motion.h
+ *
+ * Motion (stationary/moving) detection from the IMU's accelerometer.  Internal to the IMU
+ * component.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef MOTION_H_INCLUDE_GUARD
+#define MOTION_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up motion detection and its Data Hub resources.
+ */
+//--------------------------------------------------------------------------------------------------
+void motion_Init
+(
+    void
+);
+
+
+#endif // MOTION_H_INCLUDE_GUARD
@@ -0,0 +1,509 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file orientation.c
+ *
+ * Orientation (attitude) estimation from the IMU's accelerometer and gyro.
+ *
+ * A Madgwick gradient-descent filter integrates the gyro and corrects the result towards the
+ * direction of gravity measured by the accelerometer.  Without a magnetometer the heading (yaw)
+ * is relative to the heading at start-up and drifts slowly; roll and pitch are absolute.
+ *
+ * The filter is fed with time-coherent accelerometer and gyro readings: the IMU stream's scans
+ * while it's streaming (see imuStream.h), otherwise readings taken together by a timer at the
+ * rate set by "orientation/rate".  The timer only runs while the estimate is in use (the
+ * orientation sensor is enabled, or see orientation_SetRequired()), and is paused while the
+ * device is stationary (see psensor_IsStationary()), when the attitude isn't changing.
+ *
+ * The estimate is published to "orientation/value" through the Periodic Sensor component, so the
+ * output rate is set by "orientation/period" independently of the integration rate, as JSON:
+ *
+ *  {"q":[w,x,y,z],"roll":degrees,"pitch":degrees,"yaw":degrees}
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "orientation.h"
+#include "imuStream.h"
+#include "periodicSensor.h"
+#include "dhubUtils.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data Hub resource paths.
+ */
+//--------------------------------------------------------------------------------------------------
+#define SENSOR_NAME     "orientation"
+#define ENABLE_PATH     "orientation/enable"
+#define RATE_PATH       "orientation/rate"
+#define GAIN_PATH       "orientation/gain"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default integration rate (Hz) when the IMU isn't streaming, and default filter gain.  A larger
+ * gain trusts the accelerometer more: it converges faster but lets through more linear
+ * acceleration.
+ */
+//--------------------------------------------------------------------------------------------------
+#define DEFAULT_RATE 20.0
+#define DEFAULT_GAIN 0.1
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Longest gap (seconds) between readings that is integrated.  After a longer gap the filter
+ * restarts from the next reading.
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_STEP 1.0
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Where the filter's readings are coming from.  The two sources' timestamps aren't comparable.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    SOURCE_NONE,
+    SOURCE_TIMER,
+    SOURCE_STREAM,
+}
+Source_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Filter state.
+ */
+//--------------------------------------------------------------------------------------------------
+static double Q[4] = { 1.0, 0.0, 0.0, 0.0 };    ///< w, x, y, z
+static Source_t LastSource = SOURCE_NONE;
+static double LastTime;
+static double Gain = DEFAULT_GAIN;
+static le_timer_Ref_t IntegrationTimer = NULL;
+static double Rate = DEFAULT_RATE;              ///< Integration rate (Hz) when not streaming.
+static bool IsEnabled = false;                  ///< The orientation sensor is enabled.
+static bool IsRequired = false;                 ///< See orientation_SetRequired().
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler called after each step (see orientation_SetUpdateHandler()).
+ */
+//--------------------------------------------------------------------------------------------------
+static orientation_UpdateHandlerFunc_t UpdateHandlerFunc = NULL;
+static void* UpdateContextPtr = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Normalize a quaternion (or any 4-vector) in place.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Normalize
+(
+    double v[4]
+)
+{
+    double norm = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3]);
+
+    if (norm > 0.0)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            v[i] /= norm;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start the filter at the roll and pitch given by the direction of gravity, with zero yaw, so
+ * it doesn't have to converge from an arbitrary attitude.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Reset
+(
+    const double accel[3]
+)
+{
+    double roll = atan2(accel[1], accel[2]);
+    double pitch = atan2(-accel[0], sqrt(accel[1] * accel[1] + accel[2] * accel[2]));
+
+    double cr = cos(roll / 2);
+    double sr = sin(roll / 2);
+    double cp = cos(pitch / 2);
+    double sp = sin(pitch / 2);
+
+    Q[0] = cr * cp;
+    Q[1] = sr * cp;
+    Q[2] = cr * sp;
+    Q[3] = -sr * sp;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Advance the filter by one accelerometer (m/s2) and gyro (rad/s) reading.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Update
+(
+    Source_t source,
+    double time,        ///< Seconds, on the source's own clock.
+    const double accel[3],
+    const double gyro[3]
+)
+{
+    double step = time - LastTime;
+
+    if ((source != LastSource) || !(step > 0.0) || (step > MAX_STEP))
+    {
+        LastTime = time;
+        if (source != LastSource)
+        {
+            LastSource = source;
+            Reset(accel);
+            if (UpdateHandlerFunc != NULL)
+            {
+                UpdateHandlerFunc(0.0, accel, Q, UpdateContextPtr);
+            }
+        }
+        return;
+    }
+    LastTime = time;
+
+    double q0 = Q[0];
+    double q1 = Q[1];
+    double q2 = Q[2];
+    double q3 = Q[3];
+    double gx = gyro[0];
+    double gy = gyro[1];
+    double gz = gyro[2];
+
+    // Rate of change of the quaternion from the gyro.
+    double qDot[4] =
+    {
+        0.5 * (-q1 * gx - q2 * gy - q3 * gz),
+        0.5 * (q0 * gx + q2 * gz - q3 * gy),
+        0.5 * (q0 * gy - q1 * gz + q3 * gx),
+        0.5 * (q0 * gz + q1 * gy - q2 * gx),
+    };
+
+    double norm = sqrt(accel[0] * accel[0] + accel[1] * accel[1] + accel[2] * accel[2]);
+    if (norm > 0.0)
+    {
+        double ax = accel[0] / norm;
+        double ay = accel[1] / norm;
+        double az = accel[2] / norm;
+
+        // Gradient of the error between the measured and the estimated direction of gravity.
+        double q0q0 = q0 * q0;
+        double q1q1 = q1 * q1;
+        double q2q2 = q2 * q2;
+        double q3q3 = q3 * q3;
+
+        double s[4] =
+        {
+            4 * q0 * q2q2 + 2 * q2 * ax + 4 * q0 * q1q1 - 2 * q1 * ay,
+            4 * q1 * q3q3 - 2 * q3 * ax + 4 * q0q0 * q1 - 2 * q0 * ay - 4 * q1
+                + 8 * q1 * q1q1 + 8 * q1 * q2q2 + 4 * q1 * az,
+            4 * q0q0 * q2 + 2 * q0 * ax + 4 * q2 * q3q3 - 2 * q3 * ay - 4 * q2
+                + 8 * q2 * q1q1 + 8 * q2 * q2q2 + 4 * q2 * az,
+            4 * q1q1 * q3 - 2 * q1 * ax + 4 * q2q2 * q3 - 2 * q2 * ay,
+        };
+        Normalize(s);
+
+        for (int i = 0; i < 4; i++)
+        {
+            qDot[i] -= Gain * s[i];
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        Q[i] += qDot[i] * step;
+    }
+    Normalize(Q);
+
+    if (UpdateHandlerFunc != NULL)
+    {
+        UpdateHandlerFunc(step, accel, Q, UpdateContextPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Feed the IMU stream's scans to the filter.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleScans
+(
+    const imuStream_Scan_t* scansPtr,
+    size_t count,
+    void* contextPtr
+)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        Update(SOURCE_STREAM, scansPtr[i].timestamp, scansPtr[i].accel, scansPtr[i].gyro);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the accelerometer and gyro and feed them to the filter, unless the IMU is streaming (in
+ * which case the scans are used instead).
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleIntegrationTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    double accel[3];
+    double gyro[3];
+
+    if (imuStream_GetRate() > 0.0)
+    {
+        return;
+    }
+
+    le_result_t result = imu_ReadGyro(&gyro[0], &gyro[1], &gyro[2]);
+    if (result == LE_OK)
+    {
+        result = imu_ReadAccel(&accel[0], &accel[1], &accel[2]);
+    }
+    if (result != LE_OK)
+    {
+        LE_ERROR("Failed to read IMU (%s).", LE_RESULT_TXT(result));
+        return;
+    }
+
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+    Update(SOURCE_TIMER, now.sec + now.usec / 1000000.0, accel, gyro);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish the current estimate.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SampleOrientation
+(
+    psensor_Ref_t ref,
+    void *contextPtr
+)
+{
+    if (LastSource == SOURCE_NONE)
+    {
+        return;
+    }
+
+    double q0 = Q[0];
+    double q1 = Q[1];
+    double q2 = Q[2];
+    double q3 = Q[3];
+
+    double roll = atan2(2 * (q0 * q1 + q2 * q3), 1 - 2 * (q1 * q1 + q2 * q2));
+    double sinPitch = 2 * (q0 * q2 - q3 * q1);
+    double pitch = asin(fmax(-1.0, fmin(1.0, sinPitch)));
+    double yaw = atan2(2 * (q0 * q3 + q1 * q2), 1 - 2 * (q2 * q2 + q3 * q3));
+
+    char sample[256];
+    int len = snprintf(sample,
+                       sizeof(sample),
+                       "{\"q\":[%.5f,%.5f,%.5f,%.5f],\"roll\":%.2f,\"pitch\":%.2f,\"yaw\":%.2f}",
+                       q0, q1, q2, q3,
+                       roll * 180 / M_PI,
+                       pitch * 180 / M_PI,
+                       yaw * 180 / M_PI);
+    if (len >= sizeof(sample))
+    {
+        LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(sample));
+    }
+
+    psensor_PushJson(ref, 0 /* now */, sample);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start or stop the integration timer, depending on whether the estimate is in use and the device
+ * is moving.
+ */
+//--------------------------------------------------------------------------------------------------
+static void UpdateIntegrationTimer
+(
+    void
+)
+{
+    bool isNeeded = (IsEnabled || IsRequired) && (Rate > 0.0) && !psensor_IsStationary();
+
+    if (isNeeded == le_timer_IsRunning(IntegrationTimer))
+    {
+        return;
+    }
+
+    if (isNeeded)
+    {
+        le_timer_SetMsInterval(IntegrationTimer, (uint32_t)(1000.0 / Rate));
+        le_timer_Start(IntegrationTimer);
+    }
+    else
+    {
+        le_timer_Stop(IntegrationTimer);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an update to the integration rate used when the IMU isn't streaming.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleRatePush
+(
+    double timestamp,
+    double rate,    ///< Hz
+    void* contextPtr
+)
+{
+    Rate = rate;
+
+    // Restart the timer, if it's needed, at the new interval.
+    le_timer_Stop(IntegrationTimer);
+    UpdateIntegrationTimer();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle the orientation sensor being enabled or disabled.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleEnablePush
+(
+    double timestamp,
+    bool enable,
+    void* contextPtr
+)
+{
+    IsEnabled = enable;
+    UpdateIntegrationTimer();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pause the integration timer while the device is stationary.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleMotionChange
+(
+    bool isStationary,
+    void* contextPtr
+)
+{
+    UpdateIntegrationTimer();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an update to the filter gain.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleGainPush
+(
+    double timestamp,
+    double gain,
+    void* contextPtr
+)
+{
+    if (!(gain >= 0.0))
+    {
+        LE_ERROR("Invalid orientation filter gain %lf.", gain);
+        return;
+    }
+
+    Gain = gain;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the handler to be called after each step of the filter.  Only one handler is supported.
+ */
+//--------------------------------------------------------------------------------------------------
+void orientation_SetUpdateHandler
+(
+    orientation_UpdateHandlerFunc_t handlerFunc,
+    void* contextPtr
+)
+{
+    UpdateHandlerFunc = handlerFunc;
+    UpdateContextPtr = contextPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Keep the filter running (while the device is moving) even if the orientation sensor is
+ * disabled.  Used by the update handler's owner while it needs the steps.
+ */
+//--------------------------------------------------------------------------------------------------
+void orientation_SetRequired
+(
+    bool isRequired
+)
+{
+    IsRequired = isRequired;
+    UpdateIntegrationTimer();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up the orientation estimator and its Data Hub resources.  Must be called after
+ * imuStream_Init().
+ */
+//--------------------------------------------------------------------------------------------------
+void orientation_Init
+(
+    void
+)
+{
+    IntegrationTimer = le_timer_Create("orientation");
+    le_timer_SetRepeat(IntegrationTimer, 0);
+    le_timer_SetHandler(IntegrationTimer, HandleIntegrationTimer);
+
+    psensor_CreateJson(SENSOR_NAME,
+                       "{\"q\":[1,0,0,0],\"roll\":0.0,\"pitch\":0.0,\"yaw\":0.0}",
+                       SampleOrientation,
+                       NULL);
+    dhubIO_AddBooleanPushHandler(ENABLE_PATH, HandleEnablePush, NULL);
+    psensor_AddMotionHandler(HandleMotionChange, NULL);
+
+    dhubUtils_CreateOutput(RATE_PATH, DHUBIO_DATA_TYPE_NUMERIC, "Hz");
+    dhubIO_AddNumericPushHandler(RATE_PATH, HandleRatePush, NULL);
+    dhubIO_SetNumericDefault(RATE_PATH, DEFAULT_RATE);
+    dhubIO_MarkOptional(RATE_PATH);
+
+    dhubUtils_CreateOutput(GAIN_PATH, DHUBIO_DATA_TYPE_NUMERIC, "");
+    dhubIO_AddNumericPushHandler(GAIN_PATH, HandleGainPush, NULL);
+    dhubIO_SetNumericDefault(GAIN_PATH, DEFAULT_GAIN);
+    dhubIO_MarkOptional(GAIN_PATH);
+
+    imuStream_AddScanHandler(HandleScans, NULL);
+}
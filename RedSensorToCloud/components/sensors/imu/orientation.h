@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file orientation.h
+ *
+ * Orientation (attitude) estimation from the IMU.  Internal to the IMU component.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ORIENTATION_H_INCLUDE_GUARD
+#define ORIENTATION_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler called after each step of the filter, with the accelerometer reading (m/s2, sensor
+ * frame) it used and the resulting attitude: q rotates the sensor frame into a frame with z up
+ * and an arbitrary (but fixed) heading.  A step of 0 means the filter has restarted, so the
+ * heading has changed.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*orientation_UpdateHandlerFunc_t)
+(
+    double step,            ///< Seconds since the previous step.
+    const double accel[3],
+    const double q[4],      ///< w, x, y, z
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the handler to be called after each step of the filter.  Only one handler is supported.
+ */
+//--------------------------------------------------------------------------------------------------
+void orientation_SetUpdateHandler
+(
+    orientation_UpdateHandlerFunc_t handlerFunc,
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Keep the filter running (while the device is moving) even if the orientation sensor is
+ * disabled.  Used by the update handler's owner while it needs the steps.
+ */
+//--------------------------------------------------------------------------------------------------
+void orientation_SetRequired
+(
+    bool isRequired
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up the orientation estimator and its Data Hub resources.  Must be called after
+ * imuStream_Init().
+ */
+//--------------------------------------------------------------------------------------------------
+void orientation_Init
+(
+    void
+);
+
+
+#endif // ORIENTATION_H_INCLUDE_GUARD
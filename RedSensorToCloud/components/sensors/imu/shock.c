@@ -0,0 +1,369 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file shock.c
+ *
+ * Shock (impact) capture from the IMU stream.
+ *
+ * Impacts last a few milliseconds, so periodic accelerometer samples almost never see them.  While
+ * shock capture is enabled, the IMU streams continuously (at SHOCK_RATE or faster) and the latest
+ * scans are kept in a pre-trigger ring.  When the acceleration magnitude differs from 1 g by more
+ * than the threshold, the scans from imu/shock/preTrigger ms before the event to
+ * imu/shock/postTrigger ms after it are frozen and published as one record, and the
+ * imu/shock/event trigger is pushed.
+ *
+ * Data Hub resources (relative to the app):
+ * - imu/shock/enable (output, boolean) - capture shocks.  Off by default.
+ * - imu/shock/threshold (output, m/s2) - departure from 1 g that counts as a shock.
+ * - imu/shock/preTrigger, imu/shock/postTrigger (outputs, ms) - length of the record either side.
+ * - imu/shock/event (input, trigger) - pushed when a shock is detected.
+ * - imu/shock/value (input, JSON) - the record, pushed once the post-trigger period is over:
+ *
+ *  {"t":trigger time,"peak":m/s2,"t0":offset of the first scan (s),"dt":scan interval (s),
+ *   "a":[[x,y,z],...]}
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "shock.h"
+#include "imuStream.h"
+#include "dhubUtils.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data Hub resource paths.
+ */
+//--------------------------------------------------------------------------------------------------
+#define ENABLE_PATH         "imu/shock/enable"
+#define THRESHOLD_PATH      "imu/shock/threshold"
+#define PRE_TRIGGER_PATH    "imu/shock/preTrigger"
+#define POST_TRIGGER_PATH   "imu/shock/postTrigger"
+#define EVENT_PATH          "imu/shock/event"
+#define VALUE_PATH          "imu/shock/value"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Lowest streaming rate (Hz) while capturing shocks.
+ */
+//--------------------------------------------------------------------------------------------------
+#define SHOCK_RATE 400.0
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Standard gravity (m/s2).
+ */
+//--------------------------------------------------------------------------------------------------
+#define GRAVITY 9.80665
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Defaults.
+ */
+//--------------------------------------------------------------------------------------------------
+#define DEFAULT_THRESHOLD       GRAVITY
+#define DEFAULT_PRE_TRIGGER     100     // ms
+#define DEFAULT_POST_TRIGGER    200     // ms
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size (in scans) of the pre-trigger ring and of a record.  These bound the pre- and post-trigger
+ * times at high rates.
+ */
+//--------------------------------------------------------------------------------------------------
+#define PRE_RING_SIZE   512
+#define RECORD_SIZE     1024
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Configuration.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsEnabled = false;
+static double Threshold = DEFAULT_THRESHOLD;
+static double PreTrigger = DEFAULT_PRE_TRIGGER / 1000.0;    ///< seconds
+static double PostTrigger = DEFAULT_POST_TRIGGER / 1000.0;  ///< seconds
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pre-trigger ring.
+ */
+//--------------------------------------------------------------------------------------------------
+static imuStream_Scan_t PreRing[PRE_RING_SIZE];
+static size_t PreRingNext = 0;
+static size_t PreRingCount = 0;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record being captured.  IsCapturing is true between a trigger and the end of its post-trigger
+ * period.  A further shock during that time just becomes part of the same record.
+ */
+//--------------------------------------------------------------------------------------------------
+static imuStream_Scan_t Record[RECORD_SIZE];
+static size_t RecordCount = 0;
+static bool IsCapturing = false;
+static double TriggerTime;
+static double PeakDeviation;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish the captured record and go back to watching for shocks.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PublishRecord
+(
+    void
+)
+{
+    static char json[DHUBIO_MAX_STRING_VALUE_LEN + 1];
+
+    IsCapturing = false;
+
+    double t0 = Record[0].timestamp - TriggerTime;
+    double dt = (RecordCount > 1) ?
+                (Record[RecordCount - 1].timestamp - Record[0].timestamp) / (RecordCount - 1) :
+                0.0;
+
+    size_t len = snprintf(json,
+                          sizeof(json),
+                          "{\"t\":%.6f,\"peak\":%.3f,\"t0\":%.6f,\"dt\":%.6f,\"a\":[",
+                          TriggerTime,
+                          PeakDeviation,
+                          t0,
+                          dt);
+
+    for (size_t i = 0; (i < RecordCount) && (len < sizeof(json)); i++)
+    {
+        len += snprintf(json + len,
+                        sizeof(json) - len,
+                        "%s[%.2f,%.2f,%.2f]",
+                        (i == 0) ? "" : ",",
+                        Record[i].accel[0],
+                        Record[i].accel[1],
+                        Record[i].accel[2]);
+    }
+
+    if (len < sizeof(json))
+    {
+        len += snprintf(json + len, sizeof(json) - len, "]}");
+    }
+
+    if (len >= sizeof(json))
+    {
+        LE_ERROR("Shock record of %zu scans is too big for the Data Hub.", RecordCount);
+        return;
+    }
+
+    dhubIO_PushJson(VALUE_PATH, TriggerTime, json);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start a record with the pre-trigger scans.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartRecord
+(
+    double timestamp,
+    double deviation
+)
+{
+    IsCapturing = true;
+    TriggerTime = timestamp;
+    PeakDeviation = deviation;
+    RecordCount = 0;
+
+    // Oldest first, skipping anything from before the pre-trigger period.
+    size_t first = (PreRingNext + PRE_RING_SIZE - PreRingCount) % PRE_RING_SIZE;
+    for (size_t i = 0; i < PreRingCount; i++)
+    {
+        const imuStream_Scan_t* scanPtr = &PreRing[(first + i) % PRE_RING_SIZE];
+
+        if (scanPtr->timestamp >= (timestamp - PreTrigger))
+        {
+            Record[RecordCount++] = *scanPtr;
+        }
+    }
+    PreRingCount = 0;
+
+    dhubIO_PushTrigger(EVENT_PATH, timestamp);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Watch the IMU stream's scans for shocks.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleScans
+(
+    const imuStream_Scan_t* scansPtr,
+    size_t count,
+    void* contextPtr
+)
+{
+    if (!IsEnabled)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const imuStream_Scan_t* scanPtr = &scansPtr[i];
+        const double* accelPtr = scanPtr->accel;
+        double deviation = fabs(sqrt(accelPtr[0] * accelPtr[0] +
+                                     accelPtr[1] * accelPtr[1] +
+                                     accelPtr[2] * accelPtr[2]) - GRAVITY);
+
+        if (IsCapturing)
+        {
+            if (scanPtr->timestamp > (TriggerTime + PostTrigger))
+            {
+                PublishRecord();
+            }
+            else
+            {
+                if (RecordCount < RECORD_SIZE)
+                {
+                    Record[RecordCount++] = *scanPtr;
+                }
+                PeakDeviation = fmax(PeakDeviation, deviation);
+                continue;
+            }
+        }
+
+        if (deviation > Threshold)
+        {
+            StartRecord(scanPtr->timestamp, deviation);
+            Record[RecordCount++] = *scanPtr;
+            continue;
+        }
+
+        PreRing[PreRingNext] = *scanPtr;
+        PreRingNext = (PreRingNext + 1) % PRE_RING_SIZE;
+        if (PreRingCount < PRE_RING_SIZE)
+        {
+            PreRingCount++;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle shock capture being enabled or disabled.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleEnablePush
+(
+    double timestamp,
+    bool enable,
+    void* contextPtr
+)
+{
+    if (enable == IsEnabled)
+    {
+        return;
+    }
+
+    IsEnabled = enable;
+    IsCapturing = false;
+    PreRingCount = 0;
+
+    imuStream_SetMinRate(enable ? SHOCK_RATE : 0.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an update to the threshold.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleThresholdPush
+(
+    double timestamp,
+    double value,   ///< m/s2
+    void* contextPtr
+)
+{
+    if (!(value > 0.0))
+    {
+        LE_ERROR("Invalid shock threshold %lf.", value);
+        return;
+    }
+
+    Threshold = value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an update to the pre- or post-trigger time.  The context pointer is the setting.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleTriggerTimePush
+(
+    double timestamp,
+    double value,   ///< ms
+    void* contextPtr
+)
+{
+    if (!(value >= 0.0))
+    {
+        LE_ERROR("Invalid shock capture time %lf ms.", value);
+        return;
+    }
+
+    *(double*)contextPtr = value / 1000.0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up shock capture and its Data Hub resources.  Must be called after imuStream_Init().
+ */
+//--------------------------------------------------------------------------------------------------
+void shock_Init
+(
+    void
+)
+{
+    dhubUtils_CreateOutput(ENABLE_PATH, DHUBIO_DATA_TYPE_BOOLEAN, "");
+    dhubIO_AddBooleanPushHandler(ENABLE_PATH, HandleEnablePush, NULL);
+    dhubIO_SetBooleanDefault(ENABLE_PATH, false);
+
+    dhubUtils_CreateOutput(THRESHOLD_PATH, DHUBIO_DATA_TYPE_NUMERIC, "m/s2");
+    dhubIO_AddNumericPushHandler(THRESHOLD_PATH, HandleThresholdPush, NULL);
+    dhubIO_SetNumericDefault(THRESHOLD_PATH, DEFAULT_THRESHOLD);
+    dhubIO_MarkOptional(THRESHOLD_PATH);
+
+    dhubUtils_CreateOutput(PRE_TRIGGER_PATH, DHUBIO_DATA_TYPE_NUMERIC, "ms");
+    dhubIO_AddNumericPushHandler(PRE_TRIGGER_PATH, HandleTriggerTimePush, &PreTrigger);
+    dhubIO_SetNumericDefault(PRE_TRIGGER_PATH, DEFAULT_PRE_TRIGGER);
+    dhubIO_MarkOptional(PRE_TRIGGER_PATH);
+
+    dhubUtils_CreateOutput(POST_TRIGGER_PATH, DHUBIO_DATA_TYPE_NUMERIC, "ms");
+    dhubIO_AddNumericPushHandler(POST_TRIGGER_PATH, HandleTriggerTimePush, &PostTrigger);
+    dhubIO_SetNumericDefault(POST_TRIGGER_PATH, DEFAULT_POST_TRIGGER);
+    dhubIO_MarkOptional(POST_TRIGGER_PATH);
+
+    dhubUtils_CreateInput(EVENT_PATH, DHUBIO_DATA_TYPE_TRIGGER, "");
+    dhubUtils_CreateInput(VALUE_PATH, DHUBIO_DATA_TYPE_JSON, "");
+    dhubIO_SetJsonExample(VALUE_PATH,
+                          "{\"t\":1546300800.0,\"peak\":14.2,\"t0\":-0.1,\"dt\":0.0025,"
+                          "\"a\":[[0.1,0.0,9.8],[3.2,-1.1,24.0]]}");
+
+    imuStream_AddScanHandler(HandleScans, NULL);
+}
@@ -0,0 +1,26 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file shock.h
+ *
+ * Shock (impact) capture from the IMU stream.  Internal to the IMU component.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SHOCK_H_INCLUDE_GUARD
+#define SHOCK_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up shock capture and its Data Hub resources.  Must be called after imuStream_Init().
+ */
+//--------------------------------------------------------------------------------------------------
+void shock_Init
+(
+    void
+);
+
+
+#endif // SHOCK_H_INCLUDE_GUARD
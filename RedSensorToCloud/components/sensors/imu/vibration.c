@@ -0,0 +1,639 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file vibration.c
+ *
+ * Vibration analysis of streamed accelerometer data.
+ *
+ * Rather than shipping raw high-rate samples off the device, the magnitude of the acceleration
+ * (with its mean removed) is collected into fixed-size windows as it arrives from the IMU stream
+ * (see imuStream.h).  Each full window is multiplied by a Hann window and run through a real FFT,
+ * and reduced to:
+ * - the RMS acceleration over the window (m/s2),
+ * - the PEAK_COUNT largest spectral peaks, as [frequency (Hz), amplitude (m/s2)] pairs, and
+ * - the mean-square acceleration ((m/s2)^2) in each of a configurable set of frequency bands.
+ *
+ * The features of the latest window are pushed to "imu/vibration/value" through the Periodic
+ * Sensor component, so the usual period and enable controls apply.  The band edges (Hz) are set
+ * by pushing a JSON array like [0,5,10,20,50] to "imu/vibration/bands".
+ *
+ * Nothing is analysed unless the IMU is streaming (see imu/stream/rate).
+ *
+ * The FFT's inner loops use NEON or SSE when the compiler targets them, and plain C otherwise.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "vibration.h"
+#include "imuStream.h"
+#include "periodicSensor.h"
+#include "dhubUtils.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_NEON 1
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define USE_SSE 1
+#endif
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of samples in an analysis window.  Must be a power of two.
+ */
+//--------------------------------------------------------------------------------------------------
+#define WINDOW_SIZE 256
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The real FFT of WINDOW_SIZE samples is done as a complex FFT of half that size.
+ */
+//--------------------------------------------------------------------------------------------------
+#define HALF_SIZE (WINDOW_SIZE / 2)
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of spectral peaks reported per window.
+ */
+//--------------------------------------------------------------------------------------------------
+#define PEAK_COUNT 3
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of frequency bands (one less than the number of band edges).
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_BANDS 8
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data Hub resource paths.
+ */
+//--------------------------------------------------------------------------------------------------
+#define SENSOR_NAME     "imu/vibration"
+#define BANDS_PATH      "imu/vibration/bands"
+#define DEFAULT_BANDS   "[0,5,10,20,50]"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tables, computed once at start-up.
+ */
+//--------------------------------------------------------------------------------------------------
+static float Hann[WINDOW_SIZE];
+static double HannSum;              ///< Sum of the window (for amplitudes).
+static double HannSumSq;            ///< Sum of the squares of the window (for energies).
+static uint16_t BitReverse[HALF_SIZE];
+
+// Twiddle factors for each stage of the complex FFT, stored so each stage's are contiguous.  The
+// stage with butterflies "half" apart uses entries [half - 1, 2 * half - 1).
+static float TwiddleRe[HALF_SIZE];
+static float TwiddleIm[HALF_SIZE];
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Window being filled and the buffers used to analyse it.
+ */
+//--------------------------------------------------------------------------------------------------
+static float Samples[WINDOW_SIZE];
+static size_t SampleCount = 0;
+static double FirstTimestamp;
+static double LastTimestamp;
+
+static float Windowed[WINDOW_SIZE];
+static float Re[HALF_SIZE];
+static float Im[HALF_SIZE];
+static float Power[HALF_SIZE + 1];
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Band edges (Hz).  BandCount bands, band i being [BandEdges[i], BandEdges[i + 1]).
+ */
+//--------------------------------------------------------------------------------------------------
+static double BandEdges[MAX_BANDS + 1];
+static size_t BandCount = 0;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Features of the latest window, waiting to be pushed.
+ */
+//--------------------------------------------------------------------------------------------------
+static char FeaturesJson[512];
+static double FeaturesTimestamp;
+static bool HasNewFeatures = false;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Multiply samples by the window function.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ApplyWindow
+(
+    const float* inPtr,
+    float* outPtr,
+    size_t count
+)
+{
+    size_t i = 0;
+
+#if defined(USE_NEON)
+    for (; i + 4 <= count; i += 4)
+    {
+        vst1q_f32(outPtr + i, vmulq_f32(vld1q_f32(inPtr + i), vld1q_f32(Hann + i)));
+    }
+#elif defined(USE_SSE)
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(outPtr + i, _mm_mul_ps(_mm_loadu_ps(inPtr + i), _mm_loadu_ps(Hann + i)));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        outPtr[i] = inPtr[i] * Hann[i];
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Do a run of radix-2 butterflies: a' = a + w * b, b' = a - w * b.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Butterflies
+(
+    float* aRePtr,
+    float* aImPtr,
+    float* bRePtr,
+    float* bImPtr,
+    const float* wRePtr,
+    const float* wImPtr,
+    size_t count
+)
+{
+    size_t i = 0;
+
+#if defined(USE_NEON)
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t ar = vld1q_f32(aRePtr + i);
+        float32x4_t ai = vld1q_f32(aImPtr + i);
+        float32x4_t br = vld1q_f32(bRePtr + i);
+        float32x4_t bi = vld1q_f32(bImPtr + i);
+        float32x4_t wr = vld1q_f32(wRePtr + i);
+        float32x4_t wi = vld1q_f32(wImPtr + i);
+
+        float32x4_t tr = vmlsq_f32(vmulq_f32(br, wr), bi, wi);
+        float32x4_t ti = vmlaq_f32(vmulq_f32(br, wi), bi, wr);
+
+        vst1q_f32(aRePtr + i, vaddq_f32(ar, tr));
+        vst1q_f32(aImPtr + i, vaddq_f32(ai, ti));
+        vst1q_f32(bRePtr + i, vsubq_f32(ar, tr));
+        vst1q_f32(bImPtr + i, vsubq_f32(ai, ti));
+    }
+#elif defined(USE_SSE)
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 ar = _mm_loadu_ps(aRePtr + i);
+        __m128 ai = _mm_loadu_ps(aImPtr + i);
+        __m128 br = _mm_loadu_ps(bRePtr + i);
+        __m128 bi = _mm_loadu_ps(bImPtr + i);
+        __m128 wr = _mm_loadu_ps(wRePtr + i);
+        __m128 wi = _mm_loadu_ps(wImPtr + i);
+
+        __m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+        __m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+
+        _mm_storeu_ps(aRePtr + i, _mm_add_ps(ar, tr));
+        _mm_storeu_ps(aImPtr + i, _mm_add_ps(ai, ti));
+        _mm_storeu_ps(bRePtr + i, _mm_sub_ps(ar, tr));
+        _mm_storeu_ps(bImPtr + i, _mm_sub_ps(ai, ti));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        float tr = bRePtr[i] * wRePtr[i] - bImPtr[i] * wImPtr[i];
+        float ti = bRePtr[i] * wImPtr[i] + bImPtr[i] * wRePtr[i];
+
+        bRePtr[i] = aRePtr[i] - tr;
+        bImPtr[i] = aImPtr[i] - ti;
+        aRePtr[i] += tr;
+        aImPtr[i] += ti;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the power spectrum (bins 0 to HALF_SIZE) of the windowed samples.
+ *
+ * The even and odd samples are packed into the real and imaginary parts of a complex sequence of
+ * half the length, transformed in place, and the two interleaved spectra separated afterwards.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ComputePowerSpectrum
+(
+    void
+)
+{
+    for (size_t k = 0; k < HALF_SIZE; k++)
+    {
+        Re[BitReverse[k]] = Windowed[2 * k];
+        Im[BitReverse[k]] = Windowed[2 * k + 1];
+    }
+
+    for (size_t half = 1; half < HALF_SIZE; half *= 2)
+    {
+        for (size_t start = 0; start < HALF_SIZE; start += 2 * half)
+        {
+            Butterflies(&Re[start], &Im[start],
+                        &Re[start + half], &Im[start + half],
+                        &TwiddleRe[half - 1], &TwiddleIm[half - 1],
+                        half);
+        }
+    }
+
+    for (size_t k = 0; k <= HALF_SIZE; k++)
+    {
+        size_t i = k % HALF_SIZE;
+        size_t j = (HALF_SIZE - k) % HALF_SIZE;
+
+        // Spectra of the even (e) and odd (o) samples.
+        double eRe = (Re[i] + Re[j]) / 2;
+        double eIm = (Im[i] - Im[j]) / 2;
+        double oRe = (Im[i] + Im[j]) / 2;
+        double oIm = (Re[j] - Re[i]) / 2;
+
+        double angle = 2 * M_PI * k / WINDOW_SIZE;
+        double c = cos(angle);
+        double s = sin(angle);
+
+        double xRe = eRe + c * oRe + s * oIm;
+        double xIm = eIm + c * oIm - s * oRe;
+
+        Power[k] = xRe * xRe + xIm * xIm;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find the largest local maxima of the power spectrum.
+ *
+ * @return The number of peaks found (up to PEAK_COUNT).
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t FindPeaks
+(
+    double binHz,
+    double frequencies[PEAK_COUNT],     ///< [OUT] Hz, largest peak first.
+    double amplitudes[PEAK_COUNT]       ///< [OUT] m/s2
+)
+{
+    size_t found = 0;
+
+    for (size_t k = 1; k < HALF_SIZE; k++)
+    {
+        if ((Power[k] <= Power[k - 1]) || (Power[k] < Power[k + 1]))
+        {
+            continue;
+        }
+
+        double left = sqrt(Power[k - 1]);
+        double centre = sqrt(Power[k]);
+        double right = sqrt(Power[k + 1]);
+        double amplitude = 2 * centre / HannSum;
+
+        // Insert in order, dropping the smallest if full.
+        size_t pos = found;
+        while ((pos > 0) && (amplitudes[pos - 1] < amplitude))
+        {
+            if (pos < PEAK_COUNT)
+            {
+                frequencies[pos] = frequencies[pos - 1];
+                amplitudes[pos] = amplitudes[pos - 1];
+            }
+            pos--;
+        }
+        if (pos >= PEAK_COUNT)
+        {
+            continue;
+        }
+
+        // Refine the frequency by fitting a parabola through the peak and its neighbours.
+        double curvature = left - 2 * centre + right;
+        double offset = (curvature != 0.0) ? (0.5 * (left - right) / curvature) : 0.0;
+
+        frequencies[pos] = (k + offset) * binHz;
+        amplitudes[pos] = amplitude;
+        if (found < PEAK_COUNT)
+        {
+            found++;
+        }
+    }
+
+    return found;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Analyse a full window and save its features for the next push.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AnalyseWindow
+(
+    void
+)
+{
+    double span = LastTimestamp - FirstTimestamp;
+    double rate = (span > 0.0) ? ((WINDOW_SIZE - 1) / span) : imuStream_GetRate();
+    if (!(rate > 0.0))
+    {
+        return;
+    }
+
+    // Remove the mean (mostly gravity), and get the RMS of what's left.
+    double sum = 0.0;
+    for (size_t i = 0; i < WINDOW_SIZE; i++)
+    {
+        sum += Samples[i];
+    }
+    float mean = sum / WINDOW_SIZE;
+
+    double sumSq = 0.0;
+    for (size_t i = 0; i < WINDOW_SIZE; i++)
+    {
+        Samples[i] -= mean;
+        sumSq += (double)Samples[i] * Samples[i];
+    }
+
+    ApplyWindow(Samples, Windowed, WINDOW_SIZE);
+    ComputePowerSpectrum();
+
+    double binHz = rate / WINDOW_SIZE;
+    double frequencies[PEAK_COUNT];
+    double amplitudes[PEAK_COUNT];
+    size_t peakCount = FindPeaks(binHz, frequencies, amplitudes);
+
+    size_t len = snprintf(FeaturesJson,
+                          sizeof(FeaturesJson),
+                          "{\"rms\":%.4f,\"rate\":%.1f,\"peaks\":[",
+                          sqrt(sumSq / WINDOW_SIZE),
+                          rate);
+
+    for (size_t i = 0; (i < peakCount) && (len < sizeof(FeaturesJson)); i++)
+    {
+        len += snprintf(FeaturesJson + len,
+                        sizeof(FeaturesJson) - len,
+                        "%s[%.2f,%.4f]",
+                        (i == 0) ? "" : ",",
+                        frequencies[i],
+                        amplitudes[i]);
+    }
+
+    if (len < sizeof(FeaturesJson))
+    {
+        len += snprintf(FeaturesJson + len, sizeof(FeaturesJson) - len, "],\"bands\":[");
+    }
+
+    // Parseval: the one-sided power spectrum, scaled by the window's energy, sums to the mean
+    // square of the signal.
+    for (size_t b = 0; (b < BandCount) && (len < sizeof(FeaturesJson)); b++)
+    {
+        double energy = 0.0;
+
+        for (size_t k = 0; k <= HALF_SIZE; k++)
+        {
+            double frequency = k * binHz;
+
+            if ((frequency >= BandEdges[b]) && (frequency < BandEdges[b + 1]))
+            {
+                double weight = ((k == 0) || (k == HALF_SIZE)) ? 1.0 : 2.0;
+                energy += weight * Power[k];
+            }
+        }
+
+        len += snprintf(FeaturesJson + len,
+                        sizeof(FeaturesJson) - len,
+                        "%s%.6f",
+                        (b == 0) ? "" : ",",
+                        energy / (WINDOW_SIZE * HannSumSq));
+    }
+
+    if (len < sizeof(FeaturesJson))
+    {
+        len += snprintf(FeaturesJson + len, sizeof(FeaturesJson) - len, "]}");
+    }
+
+    if (len >= sizeof(FeaturesJson))
+    {
+        LE_FATAL("JSON string (len %zu) is longer than buffer (size %zu).",
+                 len,
+                 sizeof(FeaturesJson));
+    }
+
+    FeaturesTimestamp = LastTimestamp;
+    HasNewFeatures = true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Collect streamed accelerometer samples into windows, and analyse each window when it's full.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleScans
+(
+    const imuStream_Scan_t* scansPtr,
+    size_t count,
+    void* contextPtr
+)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const double* accelPtr = scansPtr[i].accel;
+
+        if (SampleCount == 0)
+        {
+            FirstTimestamp = scansPtr[i].timestamp;
+        }
+        LastTimestamp = scansPtr[i].timestamp;
+
+        Samples[SampleCount++] = sqrt(accelPtr[0] * accelPtr[0] +
+                                      accelPtr[1] * accelPtr[1] +
+                                      accelPtr[2] * accelPtr[2]);
+
+        if (SampleCount == WINDOW_SIZE)
+        {
+            AnalyseWindow();
+            SampleCount = 0;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push the features of the latest window, if there's been one since the last push.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SampleVibration
+(
+    psensor_Ref_t ref,
+    void *contextPtr
+)
+{
+    if (HasNewFeatures)
+    {
+        psensor_PushJson(ref, FeaturesTimestamp, FeaturesJson);
+        HasNewFeatures = false;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an update to the band edges.  Expects a JSON array of increasing frequencies (Hz).
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleBandsPush
+(
+    double timestamp,
+    const char* value,
+    void* contextPtr
+)
+{
+    double edges[MAX_BANDS + 1];
+    size_t count = 0;
+    const char* textPtr = value;
+
+    while (isspace((unsigned char)*textPtr))
+    {
+        textPtr++;
+    }
+    if (*textPtr++ != '[')
+    {
+        goto badValue;
+    }
+
+    for (;;)
+    {
+        char* endPtr;
+        double edge = strtod(textPtr, &endPtr);
+
+        if ((endPtr == textPtr) || (count > MAX_BANDS) || !(edge >= 0.0) ||
+            ((count > 0) && (edge <= edges[count - 1])))
+        {
+            goto badValue;
+        }
+        edges[count++] = edge;
+
+        while (isspace((unsigned char)*endPtr))
+        {
+            endPtr++;
+        }
+        if (*endPtr == ']')
+        {
+            break;
+        }
+        if (*endPtr != ',')
+        {
+            goto badValue;
+        }
+        textPtr = endPtr + 1;
+    }
+
+    if (count < 2)
+    {
+        goto badValue;
+    }
+
+    memcpy(BandEdges, edges, count * sizeof(edges[0]));
+    BandCount = count - 1;
+    return;
+
+badValue:
+
+    LE_ERROR("Invalid band edges '%s' (expected up to %d increasing frequencies, like %s).",
+             value,
+             MAX_BANDS + 1,
+             DEFAULT_BANDS);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up vibration analysis and its Data Hub resources.  Must be called after imuStream_Init().
+ */
+//--------------------------------------------------------------------------------------------------
+void vibration_Init
+(
+    void
+)
+{
+    HannSum = 0.0;
+    HannSumSq = 0.0;
+    for (size_t i = 0; i < WINDOW_SIZE; i++)
+    {
+        Hann[i] = 0.5 - 0.5 * cos(2 * M_PI * i / WINDOW_SIZE);
+        HannSum += Hann[i];
+        HannSumSq += Hann[i] * Hann[i];
+    }
+
+    unsigned int bits = 0;
+    while ((1u << bits) < HALF_SIZE)
+    {
+        bits++;
+    }
+    for (size_t i = 0; i < HALF_SIZE; i++)
+    {
+        uint16_t reversed = 0;
+        for (unsigned int b = 0; b < bits; b++)
+        {
+            if (i & (1u << b))
+            {
+                reversed |= 1u << (bits - 1 - b);
+            }
+        }
+        BitReverse[i] = reversed;
+    }
+
+    for (size_t half = 1; half < HALF_SIZE; half *= 2)
+    {
+        for (size_t j = 0; j < half; j++)
+        {
+            double angle = -M_PI * j / half;
+            TwiddleRe[half - 1 + j] = cos(angle);
+            TwiddleIm[half - 1 + j] = sin(angle);
+        }
+    }
+
+    psensor_CreateJson(SENSOR_NAME,
+                       "{\"rms\":0.05,\"rate\":100.0,\"peaks\":[[12.5,0.03],[25.0,0.01]],"
+                       "\"bands\":[0.0001,0.002,0.0004,0.0001]}",
+                       SampleVibration,
+                       NULL);
+
+    dhubUtils_CreateOutput(BANDS_PATH, DHUBIO_DATA_TYPE_JSON, "Hz");
+    dhubIO_AddJsonPushHandler(BANDS_PATH, HandleBandsPush, NULL);
+    dhubIO_SetJsonExample(BANDS_PATH, DEFAULT_BANDS);
+    dhubIO_SetJsonDefault(BANDS_PATH, DEFAULT_BANDS);
+    dhubIO_MarkOptional(BANDS_PATH);
+    HandleBandsPush(0.0, DEFAULT_BANDS, NULL);
+
+    imuStream_AddScanHandler(HandleScans, NULL);
+}
@@ -0,0 +1,26 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file vibration.h
+ *
+ * Vibration analysis of streamed accelerometer data.  Internal to the IMU component.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef VIBRATION_H_INCLUDE_GUARD
+#define VIBRATION_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up vibration analysis and its Data Hub resources.  Must be called after imuStream_Init().
+ */
+//--------------------------------------------------------------------------------------------------
+void vibration_Init
+(
+    void
+);
+
+
+#endif // VIBRATION_H_INCLUDE_GUARD
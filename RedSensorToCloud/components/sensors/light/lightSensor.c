@@ -11,35 +11,293 @@
 #include "legato.h"
 #include "interfaces.h"
 #include "periodicSensor.h"
+#include "dhubUtils.h"
 #include "lightSensor.h"
 
 const char lightSensorAdc[] = "EXT_ADC3";
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Longest sampling period (seconds) while the device is stationary.
+ */
+//--------------------------------------------------------------------------------------------------
+#define STATIONARY_PERIOD 600.0
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data Hub resource paths for oversampling.
+ */
+//--------------------------------------------------------------------------------------------------
+#define OVERSAMPLE_PATH "light/oversample"
+#define LATENCY_PATH    "light/noise/latency"
+#define VARIANCE_PATH   "light/noise/variance"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default and largest number of ADC readings taken per sample.
+ */
+//--------------------------------------------------------------------------------------------------
+#define DEFAULT_OVERSAMPLE  9
+#define MAX_OVERSAMPLE      32
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Shortest time (seconds) between updates of the "light/noise" inputs, unless the number of
+ * readings per sample changes.
+ */
+//--------------------------------------------------------------------------------------------------
+#define NOISE_PERIOD 600.0
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Noise metrics of a burst, passed from the worker thread to the main thread.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    double latency;     ///< ms per reading
+    double variance;    ///< NAN if there were fewer than two readings
+}
+Noise_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of ADC readings taken per sample.  Also read by the sample function on the worker
+ * threads; a stale value there only affects one sample.
+ */
+//--------------------------------------------------------------------------------------------------
+static volatile uint32_t Oversample = DEFAULT_OVERSAMPLE;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * When the noise metrics were last published (relative seconds), and for how many readings per
+ * sample.  Only used by the sample function, which never runs twice at once.
+ */
+//--------------------------------------------------------------------------------------------------
+static double NoiseTime = 0.0;
+static uint32_t NoiseOversample = 0;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The main thread, where the noise metrics are pushed, and the pool they are passed to it in.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_thread_Ref_t MainThread = NULL;
+static le_mem_PoolRef_t NoisePool = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compare two readings, for qsort().
+ */
+//--------------------------------------------------------------------------------------------------
+static int CompareReadings
+(
+    const void* aPtr,
+    const void* bPtr
+)
+{
+    int32_t a = *(const int32_t*)aPtr;
+    int32_t b = *(const int32_t*)bPtr;
+
+    return (a > b) - (a < b);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a burst's noise metrics to the Data Hub.  Runs on the main thread.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushNoise
+(
+    void* param1Ptr,    ///< Noise_t*
+    void* param2Ptr     ///< Not used.
+)
+{
+    Noise_t* noisePtr = param1Ptr;
+
+    if (!isnan(noisePtr->variance))
+    {
+        dhubIO_PushNumeric(VARIANCE_PATH, DHUBIO_NOW, noisePtr->variance);
+    }
+    dhubIO_PushNumeric(LATENCY_PATH, DHUBIO_NOW, noisePtr->latency);
+
+    le_mem_Release(noisePtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Take a sample: a burst of back-to-back ADC readings, reduced to the mean of the middle half so
+ * that outliers are rejected.  Failed readings are left out.  The mean time per reading and the
+ * variance of the burst are pushed to the "light/noise" inputs, to help choose the burst length
+ * and deadband.
+ *
+ * The burst keeps the ADC busy for a while, so this runs on a worker thread (see
+ * psensor_SetBlocking()).
+ */
+//--------------------------------------------------------------------------------------------------
 static void Sample
 (
     psensor_Ref_t ref,
     void *contextPtr
 )
 {
-    int32_t sample;
+    int32_t readings[MAX_OVERSAMPLE];
+    uint32_t oversample = Oversample;
+    uint32_t count = 0;
+    le_result_t result = LE_OK;
 
-    le_result_t result = light_Read(&sample);
+    le_clk_Time_t start = le_clk_GetRelativeTime();
 
-    if (result == LE_OK)
+    for (uint32_t i = 0; i < oversample; i++)
     {
-        psensor_PushNumeric(ref, 0 /* now */, (double)sample);
+        le_result_t readResult = light_Read(&readings[count]);
+
+        if (readResult == LE_OK)
+        {
+            count++;
+        }
+        else
+        {
+            result = readResult;
+        }
+    }
+
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+    le_clk_Time_t elapsed = le_clk_Sub(now, start);
+
+    if (count < oversample)
+    {
+        LE_ERROR("Failed %u of %u sensor reads (%s).",
+                 oversample - count,
+                 oversample,
+                 LE_RESULT_TXT(result));
+        if (count == 0)
+        {
+            return;
+        }
+    }
+
+    qsort(readings, count, sizeof(readings[0]), CompareReadings);
+
+    // Trim a quarter of the readings off each end.  With fewer than four readings nothing is
+    // trimmed.
+    uint32_t trim = count / 4;
+    double sum = 0.0;
+    for (uint32_t i = trim; i < count - trim; i++)
+    {
+        sum += readings[i];
     }
-    else
+    double value = sum / (count - 2 * trim);
+
+    psensor_PushNumeric(ref, 0 /* now */, value);
+
+    // The noise metrics change slowly, so they are only published every so often.
+    double nowSec = now.sec + (now.usec / 1000000.0);
+    if ((oversample == NoiseOversample) && (nowSec - NoiseTime < NOISE_PERIOD))
     {
-        LE_ERROR("Failed to read sensor (%s).", LE_RESULT_TXT(result));
+        return;
     }
+    NoiseTime = nowSec;
+    NoiseOversample = oversample;
+
+    Noise_t* noisePtr = le_mem_ForceAlloc(NoisePool);
+    noisePtr->variance = NAN;
+
+    if (count > 1)
+    {
+        double mean = 0.0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            mean += readings[i];
+        }
+        mean /= count;
+
+        double variance = 0.0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            variance += (readings[i] - mean) * (readings[i] - mean);
+        }
+        variance /= (count - 1);
+
+        noisePtr->variance = variance;
+    }
+
+    noisePtr->latency = ((elapsed.sec * 1000.0) + (elapsed.usec / 1000.0)) / oversample;
+
+    le_event_QueueFunctionToThread(MainThread, PushNoise, noisePtr, NULL);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back for pushes to the oversampling setting.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleOversamplePush
+(
+    double timestamp,
+    double oversample,
+    void* contextPtr
+)
+{
+    if (!((oversample >= 1.0) && (oversample <= MAX_OVERSAMPLE)))
+    {
+        LE_ERROR("Light oversampling must be between 1 and %d (got %lf).",
+                 MAX_OVERSAMPLE,
+                 oversample);
+        return;
+    }
+
+    Oversample = (uint32_t)oversample;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Connect the ADC API on a worker thread.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ConnectWorker
+(
+    void
+)
+{
+    le_adc_ConnectService();
 }
 
 
 COMPONENT_INIT
 {
-    psensor_Create("light", DHUBIO_DATA_TYPE_NUMERIC, "", Sample, NULL);
+    MainThread = le_thread_GetCurrent();
+    NoisePool = le_mem_CreatePool("lightNoise", sizeof(Noise_t));
+
+    psensor_Ref_t ref = psensor_Create("light", DHUBIO_DATA_TYPE_NUMERIC, "", Sample, NULL);
+
+    // An oversampled burst keeps the ADC busy, so keep it off the main thread.
+    psensor_AddWorkerInitHandler(ConnectWorker);
+    psensor_SetBlocking(ref, true);
+
+    psensor_EnableDeadband(ref, PSENSOR_DEADBAND_PER_MEMBER);
+    psensor_EnableMotionGating(ref, STATIONARY_PERIOD);
+
+    dhubUtils_CreateOutput(OVERSAMPLE_PATH, DHUBIO_DATA_TYPE_NUMERIC, "");
+    dhubIO_AddNumericPushHandler(OVERSAMPLE_PATH, HandleOversamplePush, NULL);
+    dhubIO_SetNumericDefault(OVERSAMPLE_PATH, DEFAULT_OVERSAMPLE);
+    dhubIO_MarkOptional(OVERSAMPLE_PATH);
+
+    dhubUtils_CreateInput(LATENCY_PATH, DHUBIO_DATA_TYPE_NUMERIC, "ms");
+    dhubUtils_CreateInput(VARIANCE_PATH, DHUBIO_DATA_TYPE_NUMERIC, "");
 }
 
 
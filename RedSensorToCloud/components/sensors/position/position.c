@@ -2,6 +2,19 @@
 /**
  * Implementation of the mangOH Red position sensor interface to the Data Hub.
  *
+ * By default the position is polled every "position/period".  Setting "position/movement/distance"
+ * (metres) switches to movement mode instead: the positioning service notifies us whenever the
+ * horizontal position has moved by more than that distance, and only then is a sample pushed.
+ * If there's no movement for "position/movement/maxInterval" seconds, the last fix is pushed
+ * again.  Samples pushed in movement mode carry the fix's age (seconds) in an "age" member.
+ *
+ * Either way, the fixes go through the track simplifier (see track.c) before they are pushed.
+ *
+ * Every fix also restarts dead reckoning (see deadReckoning.h).  When a poll fails to get a fix,
+ * the dead-reckoned estimate is pushed instead, if there is one within its maximum error: its
+ * hAcc and vAcc are error bounds, and it carries the time (seconds) since the fix it was reckoned
+ * from in a "reckoned" member.
+ *
  * Copyright (C) Sierra Wireless Inc.
  */
 //--------------------------------------------------------------------------------------------------
@@ -9,6 +22,204 @@
 #include "legato.h"
 #include "interfaces.h"
 #include "periodicSensor.h"
+#include "dhubUtils.h"
+#include "position.h"
+#include "track.h"
+#include "deadReckoning.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data Hub resource paths.
+ */
+//--------------------------------------------------------------------------------------------------
+#define DISTANCE_PATH       "position/movement/distance"
+#define MAX_INTERVAL_PATH   "position/movement/maxInterval"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default longest time (seconds) between pushes in movement mode.
+ */
+//--------------------------------------------------------------------------------------------------
+#define DEFAULT_MAX_INTERVAL 300.0
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Vertical movement (metres) passed to the positioning service.  Only horizontal movement is
+ * tracked, so this is big enough never to matter.
+ */
+//--------------------------------------------------------------------------------------------------
+#define IGNORED_VERTICAL_MAGNITUDE 100000
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The position sensor.
+ */
+//--------------------------------------------------------------------------------------------------
+static psensor_Ref_t SensorRef = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fixes taken on a worker thread are passed to the main thread, which owns the track simplifier,
+ * in blocks from this pool.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t FixPool = NULL;
+static le_thread_Ref_t MainThread = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Movement mode state.  IsMovementMode is also read by the sample function on the worker threads;
+ * a stale value there only costs (or saves) one poll.
+ */
+//--------------------------------------------------------------------------------------------------
+static volatile bool IsMovementMode = false;
+static le_pos_MovementHandlerRef_t MovementHandlerRef = NULL;
+static le_timer_Ref_t MaxIntervalTimer = NULL;
+static bool HasLastFix = false;
+static position_Fix_t LastFix;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current absolute time, in seconds since the Epoch.
+ */
+//--------------------------------------------------------------------------------------------------
+static double AbsoluteNow
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetAbsoluteTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a fix to the Data Hub.  The fix's age is included if it's known.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushFix
+(
+    const position_Fix_t* fixPtr
+)
+{
+    char json[256];
+
+    int len = snprintf(json,
+                       sizeof(json),
+                       "{ \"lat\": %lf, \"lon\": %lf, \"hAcc\": %lf,"
+                        " \"alt\": %lf, \"vAcc\": %lf",
+                       (double)fixPtr->lat / 1000000.0,
+                       (double)fixPtr->lon / 1000000.0,
+                       (double)fixPtr->hAccuracy,
+                       (double)fixPtr->alt / 1000.0,
+                       (double)fixPtr->vAccuracy);
+    if (!isnan(fixPtr->age) && (len < sizeof(json)))
+    {
+        len += snprintf(json + len, sizeof(json) - len, ", \"age\": %.1lf", fixPtr->age);
+    }
+    if (!isnan(fixPtr->reckoned) && (len < sizeof(json)))
+    {
+        len += snprintf(json + len,
+                        sizeof(json) - len,
+                        ", \"reckoned\": %.1lf",
+                        fixPtr->reckoned);
+    }
+    if (len < sizeof(json))
+    {
+        len += snprintf(json + len, sizeof(json) - len, " }");
+    }
+    if (len >= sizeof(json))
+    {
+        LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(json));
+    }
+
+    psensor_PushJson(SensorRef, fixPtr->timestamp, json);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Restart dead reckoning from a fix.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetReckoningFix
+(
+    const position_Fix_t* fixPtr
+)
+{
+    deadReckoning_SetFix(fixPtr->timestamp,
+                         (double)fixPtr->lat / 1000000.0,
+                         (double)fixPtr->lon / 1000000.0,
+                         (double)fixPtr->hAccuracy,
+                         (fixPtr->vAccuracy == INT32_MAX) ? NAN : (double)fixPtr->alt / 1000.0,
+                         (double)fixPtr->vAccuracy);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pass a fix taken on a worker thread to the track simplifier.  Runs on the main thread.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddQueuedFix
+(
+    void* param1Ptr,    ///< position_Fix_t*
+    void* param2Ptr     ///< Not used.
+)
+{
+    position_Fix_t* fixPtr = param1Ptr;
+
+    SetReckoningFix(fixPtr);
+    track_Add(fixPtr);
+
+    le_mem_Release(fixPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pass the dead-reckoned estimate to the track simplifier in place of a fix that a worker thread
+ * couldn't get.  Runs on the main thread, which owns the estimator.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddEstimate
+(
+    void* param1Ptr,    ///< Not used.
+    void* param2Ptr     ///< Not used.
+)
+{
+    deadReckoning_Estimate_t estimate;
+
+    le_result_t result = deadReckoning_GetEstimate(&estimate);
+    if (result != LE_OK)
+    {
+        LE_DEBUG("No dead-reckoned position (%s).", LE_RESULT_TXT(result));
+        return;
+    }
+
+    position_Fix_t fix =
+    {
+        .lat = (int32_t)lround(estimate.lat * 1000000.0),
+        .lon = (int32_t)lround(estimate.lon * 1000000.0),
+        .hAccuracy = (int32_t)ceil(estimate.hError),
+        .alt = isnan(estimate.alt) ? 0 : (int32_t)lround(estimate.alt * 1000.0),
+        .vAccuracy = isnan(estimate.vError) ? INT32_MAX : (int32_t)ceil(estimate.vError),
+        .timestamp = AbsoluteNow(),
+        .age = NAN,
+        .reckoned = estimate.reckoned,
+    };
+
+    track_Add(&fix);
+}
 
 
 static void Sample
@@ -17,37 +228,220 @@ static void Sample
     void *contextPtr
 )
 {
-    int32_t lat;
-    int32_t lon;
-    int32_t hAccuracy;
-    int32_t alt;
-    int32_t vAccuracy;
+    // In movement mode, the positioning service tells us when there's something to push.
+    if (IsMovementMode)
+    {
+        return;
+    }
+
+    position_Fix_t* fixPtr = le_mem_ForceAlloc(FixPool);
 
-    le_result_t posRes = le_pos_Get3DLocation(&lat, &lon, &hAccuracy, &alt, &vAccuracy);
+    le_result_t posRes = le_pos_Get3DLocation(&fixPtr->lat,
+                                              &fixPtr->lon,
+                                              &fixPtr->hAccuracy,
+                                              &fixPtr->alt,
+                                              &fixPtr->vAccuracy);
 
     if (posRes == LE_OK)
     {
-        char json[256];
-
-        int len = snprintf(json,
-                           sizeof(json),
-                           "{ \"lat\": %lf, \"lon\": %lf, \"hAcc\": %lf,"
-                            " \"alt\": %lf, \"vAcc\": %lf }",
-                           (double)lat / 1000000.0,
-                           (double)lon / 1000000.0,
-                           (double)hAccuracy,
-                           (double)alt / 1000.0,
-                           (double)vAccuracy);
-        if (len >= sizeof(json))
-        {
-            LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(json));
-        }
+        fixPtr->timestamp = AbsoluteNow();
+        fixPtr->age = NAN;
+        fixPtr->reckoned = NAN;
 
-        psensor_PushJson(ref, 0 /* now */, json);
+        le_event_QueueFunctionToThread(MainThread, AddQueuedFix, fixPtr, NULL);
     }
     else
     {
         LE_ERROR("Failed to read sensor (%s).", LE_RESULT_TXT(posRes));
+        le_mem_Release(fixPtr);
+
+        le_event_QueueFunctionToThread(MainThread, AddEstimate, NULL, NULL);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push the last fix again when nothing has been pushed for the maximum interval.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleMaxIntervalTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    if (HasLastFix)
+    {
+        position_Fix_t fix = LastFix;
+
+        fix.timestamp = AbsoluteNow();
+        fix.age = fix.timestamp - LastFix.timestamp;
+
+        // Complete the track up to the last fix before repeating it.
+        track_Flush();
+        PushFix(&fix);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a movement notification from the positioning service by pushing its fix.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleMovement
+(
+    le_pos_SampleRef_t sampleRef,
+    void* contextPtr
+)
+{
+    position_Fix_t fix;
+    uint64_t fixTimeMs;
+
+    if (   (le_pos_sample_Get2DLocation(sampleRef, &fix.lat, &fix.lon, &fix.hAccuracy) != LE_OK)
+        || (le_pos_sample_GetTimestamp(sampleRef, &fixTimeMs) != LE_OK))
+    {
+        le_pos_sample_Release(sampleRef);
+        return;
+    }
+
+    if (le_pos_sample_GetAltitude(sampleRef, &fix.alt, &fix.vAccuracy) != LE_OK)
+    {
+        fix.alt = 0;
+        fix.vAccuracy = INT32_MAX;
+    }
+
+    le_pos_sample_Release(sampleRef);
+
+    fix.timestamp = (double)fixTimeMs / 1000.0;
+    fix.age = AbsoluteNow() - fix.timestamp;
+    fix.reckoned = NAN;
+
+    LastFix = fix;
+    HasLastFix = true;
+
+    SetReckoningFix(&fix);
+
+    track_Add(&fix);
+
+    le_timer_Restart(MaxIntervalTimer);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an update to the movement distance.  0 goes back to polling.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleDistancePush
+(
+    double timestamp,
+    double distance,    ///< metres
+    void* contextPtr
+)
+{
+    if (MovementHandlerRef != NULL)
+    {
+        le_pos_RemoveMovementHandler(MovementHandlerRef);
+        MovementHandlerRef = NULL;
+    }
+    le_timer_Stop(MaxIntervalTimer);
+    IsMovementMode = false;
+
+    if (!(distance > 0.0))
+    {
+        return;
+    }
+
+    MovementHandlerRef = le_pos_AddMovementHandler((uint32_t)ceil(distance),
+                                                   IGNORED_VERTICAL_MAGNITUDE,
+                                                   HandleMovement,
+                                                   NULL);
+    if (MovementHandlerRef == NULL)
+    {
+        LE_ERROR("Couldn't register for movement notifications; polling instead.");
+        return;
+    }
+
+    IsMovementMode = true;
+    le_timer_Start(MaxIntervalTimer);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an update to the longest time between pushes in movement mode.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleMaxIntervalPush
+(
+    double timestamp,
+    double interval,    ///< seconds
+    void* contextPtr
+)
+{
+    if (!(interval > 0.0))
+    {
+        LE_ERROR("Invalid maximum interval %lf.", interval);
+        return;
+    }
+
+    le_timer_SetMsInterval(MaxIntervalTimer, (uint32_t)(interval * 1000.0));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Connect the positioning API on a periodicSensor worker thread.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ConnectWorker
+(
+    void
+)
+{
+    le_pos_ConnectService();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Positioning service activation, held while the device is moving.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_posCtrl_ActivationRef_t PosCtrlRef = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release the positioning service (and with it, the GNSS receiver) while the device is stationary,
+ * and activate it again as soon as it moves.  Sampling is suspended meanwhile (see
+ * psensor_EnableMotionGating()), so the track is flushed to push where the device stopped.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleMotionChange
+(
+    bool isStationary,
+    void* contextPtr
+)
+{
+    if (isStationary)
+    {
+        track_Flush();
+
+        if (PosCtrlRef != NULL)
+        {
+            le_posCtrl_Release(PosCtrlRef);
+            PosCtrlRef = NULL;
+        }
+    }
+    else if (PosCtrlRef == NULL)
+    {
+        PosCtrlRef = le_posCtrl_Request();
+        if (PosCtrlRef == NULL)
+        {
+            LE_ERROR("Couldn't activate positioning service");
+        }
     }
 }
 
@@ -55,10 +449,38 @@ static void Sample
 COMPONENT_INIT
 {
     // Activate the positioning service.
-    le_posCtrl_ActivationRef_t posCtrlRef = le_posCtrl_Request();
-    LE_FATAL_IF(posCtrlRef == NULL, "Couldn't activate positioning service");
+    PosCtrlRef = le_posCtrl_Request();
+    LE_FATAL_IF(PosCtrlRef == NULL, "Couldn't activate positioning service");
 
     // Use the periodic sensor component from the Data Hub to implement the timer and Data Hub
     // interface.  We'll provide samples as JSON structures.
-    psensor_Create("position", DHUBIO_DATA_TYPE_JSON, "", Sample, NULL);
+    psensor_Ref_t ref = psensor_Create("position", DHUBIO_DATA_TYPE_JSON, "", Sample, NULL);
+    SensorRef = ref;
+
+    FixPool = le_mem_CreatePool("positionFix", sizeof(position_Fix_t));
+    MainThread = le_thread_GetCurrent();
+    track_Init(PushFix);
+
+    // Getting a location can take a while, so keep it off the main thread.
+    psensor_AddWorkerInitHandler(ConnectWorker);
+    psensor_SetBlocking(ref, true);
+
+    // A parked device's position doesn't change, so don't keep the GNSS receiver running for it.
+    psensor_EnableMotionGating(ref, 0 /* suspend */);
+    psensor_AddMotionHandler(HandleMotionChange, NULL);
+
+    // Movement mode, off until a distance is set.
+    MaxIntervalTimer = le_timer_Create("positionMaxInterval");
+    le_timer_SetRepeat(MaxIntervalTimer, 0);
+    le_timer_SetMsInterval(MaxIntervalTimer, (uint32_t)(DEFAULT_MAX_INTERVAL * 1000.0));
+    le_timer_SetHandler(MaxIntervalTimer, HandleMaxIntervalTimer);
+
+    dhubUtils_CreateOutput(MAX_INTERVAL_PATH, DHUBIO_DATA_TYPE_NUMERIC, "s");
+    dhubIO_AddNumericPushHandler(MAX_INTERVAL_PATH, HandleMaxIntervalPush, NULL);
+    dhubIO_SetNumericDefault(MAX_INTERVAL_PATH, DEFAULT_MAX_INTERVAL);
+    dhubIO_MarkOptional(MAX_INTERVAL_PATH);
+
+    dhubUtils_CreateOutput(DISTANCE_PATH, DHUBIO_DATA_TYPE_NUMERIC, "m");
+    dhubIO_AddNumericPushHandler(DISTANCE_PATH, HandleDistancePush, NULL);
+    dhubIO_MarkOptional(DISTANCE_PATH);
 }
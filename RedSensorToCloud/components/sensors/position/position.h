@@ -0,0 +1,34 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file position.h
+ *
+ * Position fixes, as passed around inside the position component.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef POSITION_H_INCLUDE_GUARD
+#define POSITION_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A position fix, in the positioning service's units.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int32_t lat;        ///< degrees * 1e6
+    int32_t lon;        ///< degrees * 1e6
+    int32_t hAccuracy;  ///< metres
+    int32_t alt;        ///< millimetres
+    int32_t vAccuracy;  ///< metres
+    double timestamp;   ///< seconds since the Epoch
+    double age;         ///< seconds since the fix was computed (NAN = unknown)
+    double reckoned;    ///< seconds dead-reckoned since the last fix (NAN = a real fix)
+}
+position_Fix_t;
+
+
+#endif // POSITION_H_INCLUDE_GUARD
@@ -0,0 +1,342 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file track.c
+ *
+ * Track simplification for the position stream.
+ *
+ * While driving straight, most fixes lie on the line between their neighbours and carry no
+ * information.  This is a streaming (opening window) form of the Douglas-Peucker algorithm:
+ * starting from the last fix kept (the anchor), fixes are held back as long as the segment from
+ * the anchor to the newest fix passes within "position/track/tolerance" metres of every fix held
+ * back.  When a new fix breaks that, the newest fix held back is kept and becomes the new anchor.
+ * The look-ahead is bounded to WINDOW_SIZE fixes and MAX_HOLD_TIME seconds, so no fix is held
+ * back indefinitely, even if fixes stop coming (e.g., when the device stops moving and sampling is
+ * suspended).
+ *
+ * Data Hub resources (relative to the app):
+ * - position/track/tolerance (output, m) - largest error allowed in the reconstructed track.
+ *   0 (the default) keeps every fix.
+ * - position/track/ratio (input) - fixes in per fix kept, pushed about once a minute.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "track.h"
+#include "dhubUtils.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data Hub resource paths.
+ */
+//--------------------------------------------------------------------------------------------------
+#define TOLERANCE_PATH  "position/track/tolerance"
+#define RATIO_PATH      "position/track/ratio"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of fixes held back.
+ */
+//--------------------------------------------------------------------------------------------------
+#define WINDOW_SIZE 32
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Longest time (seconds) a fix is held back.
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_HOLD_TIME 120
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time (seconds) between compression ratio reports.
+ */
+//--------------------------------------------------------------------------------------------------
+#define RATIO_REPORT_INTERVAL 60.0
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mean Earth radius (m).
+ */
+//--------------------------------------------------------------------------------------------------
+#define EARTH_RADIUS 6371008.8
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Simplifier state.
+ */
+//--------------------------------------------------------------------------------------------------
+static track_EmitFunc_t EmitFunc = NULL;
+static double Tolerance = 0.0;          ///< metres (0 = keep every fix)
+static bool HasAnchor = false;
+static position_Fix_t Anchor;           ///< Last fix kept.
+static position_Fix_t Window[WINDOW_SIZE];  ///< Fixes held back since the anchor, oldest first.
+static size_t WindowCount = 0;
+static le_timer_Ref_t HoldTimer = NULL;     ///< Runs while fixes are held back.
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compression accounting.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t FixesIn = 0;
+static uint32_t FixesKept = 0;
+static double LastReport = 0.0;         ///< Relative time (s) of the last ratio report.
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current relative (monotonic) time, in seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double Now
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Project a fix onto a local flat plane centred on the anchor, in metres (x east, y north).
+ */
+//--------------------------------------------------------------------------------------------------
+static void Project
+(
+    const position_Fix_t* fixPtr,
+    double* xPtr,
+    double* yPtr
+)
+{
+    const double radiansPerUnit = (M_PI / 180.0) / 1000000.0;
+
+    double dLon = (double)fixPtr->lon - (double)Anchor.lon;
+    if (dLon > 180000000.0)
+    {
+        dLon -= 360000000.0;
+    }
+    else if (dLon < -180000000.0)
+    {
+        dLon += 360000000.0;
+    }
+
+    *xPtr = dLon * radiansPerUnit * EARTH_RADIUS * cos(Anchor.lat * radiansPerUnit);
+    *yPtr = ((double)fixPtr->lat - (double)Anchor.lat) * radiansPerUnit * EARTH_RADIUS;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether the segment from the anchor to a fix passes within the tolerance of every fix
+ * held back.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool FitsSegment
+(
+    const position_Fix_t* endPtr
+)
+{
+    double ex, ey;
+    Project(endPtr, &ex, &ey);
+
+    double lengthSquared = ex * ex + ey * ey;
+
+    for (size_t i = 0; i < WindowCount; i++)
+    {
+        double px, py;
+        Project(&Window[i], &px, &py);
+
+        // Distance to the nearest point on the segment (not the infinite line), so that doubling
+        // back is caught too.
+        double t = (lengthSquared > 0.0) ? ((px * ex + py * ey) / lengthSquared) : 0.0;
+        t = fmin(fmax(t, 0.0), 1.0);
+
+        double dx = px - (t * ex);
+        double dy = py - (t * ey);
+
+        if (((dx * dx) + (dy * dy)) > (Tolerance * Tolerance))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Keep a fix.  It becomes the new anchor.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Keep
+(
+    const position_Fix_t* fixPtr
+)
+{
+    Anchor = *fixPtr;
+    HasAnchor = true;
+    FixesKept++;
+
+    EmitFunc(&Anchor);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push the compression ratio, if it's time to.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReportRatio
+(
+    void
+)
+{
+    double now = Now();
+
+    if (((now - LastReport) >= RATIO_REPORT_INTERVAL) && (FixesKept > 0))
+    {
+        dhubIO_PushNumeric(RATIO_PATH, DHUBIO_NOW, (double)FixesIn / FixesKept);
+        LastReport = now;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a fix to the track.  The fixes needed to reconstruct the track are passed to the emit
+ * function, possibly some time later.  Must be called on the main thread.
+ */
+//--------------------------------------------------------------------------------------------------
+void track_Add
+(
+    const position_Fix_t* fixPtr
+)
+{
+    FixesIn++;
+
+    if ((Tolerance == 0.0) || !HasAnchor)
+    {
+        Keep(fixPtr);
+    }
+    else if (FitsSegment(fixPtr))
+    {
+        // The look-ahead is bounded, so a long straight run is cut into segments.
+        if (WindowCount == WINDOW_SIZE)
+        {
+            track_Flush();
+        }
+        Window[WindowCount++] = *fixPtr;
+
+        if (WindowCount == 1)
+        {
+            le_timer_Restart(HoldTimer);
+        }
+    }
+    else
+    {
+        // The newest fix held back is the last one the track can pass through in a straight line.
+        // (The window can't be empty here, because a segment always fits an empty window.)
+        Keep(&Window[WindowCount - 1]);
+        Window[0] = *fixPtr;
+        WindowCount = 1;
+        le_timer_Restart(HoldTimer);
+    }
+
+    ReportRatio();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Emit the newest fix held back by the simplifier, if any, so the track is complete up to now.
+ */
+//--------------------------------------------------------------------------------------------------
+void track_Flush
+(
+    void
+)
+{
+    if (WindowCount > 0)
+    {
+        Keep(&Window[WindowCount - 1]);
+        WindowCount = 0;
+        le_timer_Stop(HoldTimer);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Flush the track when the oldest fix held back has been held for MAX_HOLD_TIME.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleHoldTimer
+(
+    le_timer_Ref_t timerRef
+)
+{
+    track_Flush();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle an update to the tolerance.  The track so far is flushed first.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleTolerancePush
+(
+    double timestamp,
+    double tolerance,   ///< metres
+    void* contextPtr
+)
+{
+    if (!(tolerance >= 0.0))
+    {
+        LE_ERROR("Invalid track tolerance %lf.", tolerance);
+        return;
+    }
+
+    track_Flush();
+    Tolerance = tolerance;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up the track simplifier and its Data Hub resources.
+ */
+//--------------------------------------------------------------------------------------------------
+void track_Init
+(
+    track_EmitFunc_t emitFunc   ///< Called with each fix that is kept.
+)
+{
+    EmitFunc = emitFunc;
+    LastReport = Now();
+
+    HoldTimer = le_timer_Create("trackHold");
+    le_timer_SetMsInterval(HoldTimer, MAX_HOLD_TIME * 1000);
+    le_timer_SetHandler(HoldTimer, HandleHoldTimer);
+
+    dhubUtils_CreateOutput(TOLERANCE_PATH, DHUBIO_DATA_TYPE_NUMERIC, "m");
+    dhubIO_AddNumericPushHandler(TOLERANCE_PATH, HandleTolerancePush, NULL);
+    dhubIO_MarkOptional(TOLERANCE_PATH);
+
+    dhubUtils_CreateInput(RATIO_PATH, DHUBIO_DATA_TYPE_NUMERIC, "");
+}
@@ -0,0 +1,60 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file track.h
+ *
+ * Track simplification for the position stream.  Internal to the position component.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef TRACK_H_INCLUDE_GUARD
+#define TRACK_H_INCLUDE_GUARD
+
+#include "position.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function called with each fix that the simplifier keeps.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*track_EmitFunc_t)(const position_Fix_t* fixPtr);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up the track simplifier and its Data Hub resources.
+ */
+//--------------------------------------------------------------------------------------------------
+void track_Init
+(
+    track_EmitFunc_t emitFunc   ///< Called with each fix that is kept.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a fix to the track.  The fixes needed to reconstruct the track are passed to the emit
+ * function, possibly some time later.  Must be called on the main thread.
+ */
+//--------------------------------------------------------------------------------------------------
+void track_Add
+(
+    const position_Fix_t* fixPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Emit the newest fix held back by the simplifier, if any, so the track is complete up to now.
+ * Called when no more fixes are expected for a while, e.g. when the device stops moving.
+ */
+//--------------------------------------------------------------------------------------------------
+void track_Flush
+(
+    void
+);
+
+
+#endif // TRACK_H_INCLUDE_GUARD
@@ -0,0 +1,319 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file barometer.c
+ *
+ * Barometric altitude and pressure tendency, derived from the pressure sensor.
+ *
+ * Two sensors are published through the Periodic Sensor component:
+ *
+ *  - "pressure/altitude" (m) is computed from each pressure and temperature reading with the
+ *    hypsometric formula, relative to the sea-level pressure set by "pressure/altitude/seaLevel".
+ *    The temperature is the sensor's own, which reads a little warm inside an enclosure.  Each
+ *    reading is also passed to dead reckoning (see deadReckoning.h) for the estimated altitude.
+ *
+ *  - "pressure/tendency" (kPa) is the change in mean pressure over the last three hours, the
+ *    quantity used in weather forecasting.  Rather than keeping the raw history, every reading
+ *    (including the raw "pressure" sensor's) is folded into a ring of fixed-length bins holding
+ *    only a sum and a count, so the memory used doesn't depend on the sampling rate.  Nothing is
+ *    pushed until the ring covers the whole interval.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "barometer.h"
+#include "deadReckoning.h"
+#include "periodicSensor.h"
+#include "dhubUtils.h"
+
+#include <math.h>
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data Hub resource paths.
+ */
+//--------------------------------------------------------------------------------------------------
+#define ALTITUDE_NAME       "pressure/altitude"
+#define TENDENCY_NAME       "pressure/tendency"
+#define SEA_LEVEL_PATH      "pressure/altitude/seaLevel"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default sampling periods (seconds), and the longest altitude sampling period while the device
+ * is stationary.
+ */
+//--------------------------------------------------------------------------------------------------
+#define ALTITUDE_PERIOD             10.0
+#define TENDENCY_PERIOD             900.0
+#define ALTITUDE_STATIONARY_PERIOD  600.0
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Standard sea-level pressure (kPa).
+ */
+//--------------------------------------------------------------------------------------------------
+#define STANDARD_SEA_LEVEL_PRESSURE 101.325
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hypsometric formula constants: the standard temperature lapse rate (K/m) and the exponent
+ * R * L / (g * M) for dry air.
+ */
+//--------------------------------------------------------------------------------------------------
+#define LAPSE_RATE          0.0065
+#define PRESSURE_EXPONENT   0.190263
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tendency interval and bin length (seconds).  The ring holds one more bin than the interval
+ * spans, so the bin being filled and the one an interval earlier are both present.
+ */
+//--------------------------------------------------------------------------------------------------
+#define TENDENCY_INTERVAL   (3 * 3600)
+#define BIN_DURATION        900
+#define BIN_COUNT           (TENDENCY_INTERVAL / BIN_DURATION + 1)
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A tendency bin: the readings taken during one BIN_DURATION.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int64_t number;     ///< Time (seconds since start-up) / BIN_DURATION, or -1 if never used.
+    double sum;         ///< kPa
+    uint32_t count;
+}
+Bin_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The tendency ring.  Bin n is in slot n % BIN_COUNT.
+ */
+//--------------------------------------------------------------------------------------------------
+static Bin_t Bins[BIN_COUNT];
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sea-level pressure (kPa) that altitude is computed relative to.
+ */
+//--------------------------------------------------------------------------------------------------
+static double SeaLevelPressure = STANDARD_SEA_LEVEL_PRESSURE;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of the bin the current time falls in.
+ */
+//--------------------------------------------------------------------------------------------------
+static int64_t CurrentBinNumber
+(
+    void
+)
+{
+    return le_clk_GetRelativeTime().sec / BIN_DURATION;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Account for a pressure reading taken elsewhere in the component, so that it counts towards the
+ * tendency.
+ */
+//--------------------------------------------------------------------------------------------------
+void barometer_AddPressure
+(
+    double pressure     ///< kPa
+)
+{
+    int64_t number = CurrentBinNumber();
+    Bin_t* binPtr = &Bins[number % BIN_COUNT];
+
+    if (binPtr->number != number)
+    {
+        binPtr->number = number;
+        binPtr->sum = 0.0;
+        binPtr->count = 0;
+    }
+
+    binPtr->sum += pressure;
+    binPtr->count++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the tendency from the ring.
+ *
+ * @return LE_OK if successful, LE_UNAVAILABLE if the ring doesn't cover the interval yet.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t GetTendency
+(
+    double* tendencyPtr     ///< [OUT] kPa
+)
+{
+    int64_t number = CurrentBinNumber();
+    int64_t oldNumber = number - (BIN_COUNT - 1);
+
+    if (oldNumber < 0)
+    {
+        return LE_UNAVAILABLE;
+    }
+
+    const Bin_t* binPtr = &Bins[number % BIN_COUNT];
+    const Bin_t* oldBinPtr = &Bins[oldNumber % BIN_COUNT];
+
+    if (   (binPtr->number != number)
+        || (binPtr->count == 0)
+        || (oldBinPtr->number != oldNumber)
+        || (oldBinPtr->count == 0))
+    {
+        return LE_UNAVAILABLE;
+    }
+
+    *tendencyPtr = (binPtr->sum / binPtr->count) - (oldBinPtr->sum / oldBinPtr->count);
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sample the altitude.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SampleAltitude
+(
+    psensor_Ref_t ref,
+    void *contextPtr
+)
+{
+    double pressure;
+    double temperature;
+
+    le_result_t result = pressure_Read(&pressure);
+    if (result == LE_OK)
+    {
+        result = temperature_Read(&temperature);
+    }
+
+    if (result != LE_OK)
+    {
+        LE_ERROR("Failed to read sensor (%s).", LE_RESULT_TXT(result));
+        return;
+    }
+
+    barometer_AddPressure(pressure);
+
+    double altitude = ((temperature + 273.15) / LAPSE_RATE)
+                    * (pow(SeaLevelPressure / pressure, PRESSURE_EXPONENT) - 1.0);
+
+    deadReckoning_SetBaroAltitude(altitude);
+
+    psensor_PushNumeric(ref, 0 /* now */, altitude);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sample the tendency.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SampleTendency
+(
+    psensor_Ref_t ref,
+    void *contextPtr
+)
+{
+    double pressure;
+
+    le_result_t result = pressure_Read(&pressure);
+    if (result != LE_OK)
+    {
+        LE_ERROR("Failed to read sensor (%s).", LE_RESULT_TXT(result));
+        return;
+    }
+
+    barometer_AddPressure(pressure);
+
+    double tendency;
+    if (GetTendency(&tendency) == LE_OK)
+    {
+        psensor_PushNumeric(ref, 0 /* now */, tendency);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back for pushes to the sea-level pressure setting.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleSeaLevelPush
+(
+    double timestamp,
+    double pressure,    ///< kPa
+    void* contextPtr
+)
+{
+    if (!(pressure > 0.0))
+    {
+        LE_ERROR("Invalid sea-level pressure %lf.", pressure);
+        return;
+    }
+
+    SeaLevelPressure = pressure;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up the derived sensors and their Data Hub resources.
+ */
+//--------------------------------------------------------------------------------------------------
+void barometer_Init
+(
+    void
+)
+{
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Bins); i++)
+    {
+        Bins[i].number = -1;
+    }
+
+    static const psensor_Descriptor_t Sensors[] =
+    {
+        { ALTITUDE_NAME, DHUBIO_DATA_TYPE_NUMERIC, "m", SampleAltitude, NULL,
+          ALTITUDE_PERIOD, NULL },
+        { TENDENCY_NAME, DHUBIO_DATA_TYPE_NUMERIC, "kPa", SampleTendency, NULL,
+          TENDENCY_PERIOD, NULL },
+    };
+
+    psensor_Ref_t refs[NUM_ARRAY_MEMBERS(Sensors)];
+    psensor_CreateFromTable(Sensors, NUM_ARRAY_MEMBERS(Sensors), refs);
+
+    psensor_Ref_t altitudeRef = refs[0];
+
+    // Altitude only changes when the device moves.  The tendency isn't gated: the weather changes
+    // whether the device is moving or not.
+    psensor_EnableAdaptivePeriod(altitudeRef);
+    psensor_EnableDeadband(altitudeRef, PSENSOR_DEADBAND_PER_MEMBER);
+    psensor_EnableMotionGating(altitudeRef, ALTITUDE_STATIONARY_PERIOD);
+
+    dhubUtils_CreateOutput(SEA_LEVEL_PATH, DHUBIO_DATA_TYPE_NUMERIC, "kPa");
+    dhubIO_AddNumericPushHandler(SEA_LEVEL_PATH, HandleSeaLevelPush, NULL);
+    dhubIO_SetNumericDefault(SEA_LEVEL_PATH, STANDARD_SEA_LEVEL_PRESSURE);
+    dhubIO_MarkOptional(SEA_LEVEL_PATH);
+}
@@ -0,0 +1,39 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file barometer.h
+ *
+ * Barometric altitude and pressure tendency, derived from the pressure sensor.  Internal to the
+ * pressure component.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef BAROMETER_H_INCLUDE_GUARD
+#define BAROMETER_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Account for a pressure reading taken elsewhere in the component, so that it counts towards the
+ * tendency.
+ */
+//--------------------------------------------------------------------------------------------------
+void barometer_AddPressure
+(
+    double pressure     ///< kPa
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up the derived sensors and their Data Hub resources.
+ */
+//--------------------------------------------------------------------------------------------------
+void barometer_Init
+(
+    void
+);
+
+
+#endif // BAROMETER_H_INCLUDE_GUARD
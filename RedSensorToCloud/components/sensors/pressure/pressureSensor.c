@@ -4,7 +4,8 @@
  *
  * Implementation of the mangOH Red pressure/temperature sensor interface component.
  *
- * Publishes the pressure and temperature readings to the Data Hub.
+ * Publishes the pressure and temperature readings to the Data Hub, along with the altitude and
+ * pressure tendency derived from them (see barometer.c).
  *
  * Copyright (C) Sierra Wireless Inc.
  */
@@ -14,10 +15,18 @@
 #include "interfaces.h"
 #include "periodicSensor.h"
 #include "fileUtils.h"
+#include "barometer.h"
 
 static const char PressureFile[] = "/driver/in_pressure_input";
 static const char TemperatureFile[] = "/driver/in_temp_input";
 
+// The files are opened once at start-up and kept open, so that each read is one system call.
+static file_Ref_t PressureFileRef;
+static file_Ref_t TemperatureFileRef;
+
+// Longest pressure sampling period (seconds) while the device is stationary.
+#define STATIONARY_PERIOD 600.0
+
 
 static void SamplePressure
 (
@@ -31,6 +40,7 @@ static void SamplePressure
 
     if (result == LE_OK)
     {
+        barometer_AddPressure(sample);
         psensor_PushNumeric(ref, 0 /* now */, sample);
     }
     else
@@ -74,7 +84,7 @@ le_result_t pressure_Read
         ///< [OUT] Where the pressure reading (kPa) will be put if LE_OK is returned.
 )
 {
-    return file_ReadDouble(PressureFile, readingPtr);
+    return file_ReadDoubleFrom(PressureFileRef, readingPtr);
 }
 
 
@@ -92,7 +102,7 @@ le_result_t temperature_Read
 )
 {
     int temp;
-    le_result_t r = file_ReadInt(TemperatureFile, &temp);
+    le_result_t r = file_ReadIntFrom(TemperatureFileRef, &temp);
     if (r != LE_OK)
     {
         return r;
@@ -106,10 +116,41 @@ le_result_t temperature_Read
 }
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * The sensors provided by this component.
+ */
+//--------------------------------------------------------------------------------------------------
+static const psensor_Descriptor_t Sensors[] =
+{
+    { "pressure", DHUBIO_DATA_TYPE_NUMERIC, "kPa", SamplePressure, NULL, 10, NULL },
+    { "pressure/temp", DHUBIO_DATA_TYPE_NUMERIC, "degC", SampleTemperature, NULL, 10, NULL },
+};
+
+
 COMPONENT_INIT
 {
     // Use the periodic sensor component from the Data Hub to implement the timers and the
     // interface to the Data Hub.
-    psensor_Create("pressure", DHUBIO_DATA_TYPE_NUMERIC, "kPa", SamplePressure, NULL);
-    psensor_Create("pressure/temp", DHUBIO_DATA_TYPE_NUMERIC, "degC", SampleTemperature, NULL);
+    PressureFileRef = file_Open(PressureFile);
+    TemperatureFileRef = file_Open(TemperatureFile);
+
+    psensor_Ref_t refs[NUM_ARRAY_MEMBERS(Sensors)];
+    psensor_CreateFromTable(Sensors, NUM_ARRAY_MEMBERS(Sensors), refs);
+
+    psensor_Ref_t pressureRef = refs[0];
+    psensor_Ref_t tempRef = refs[1];
+
+    // Barometric pressure and ambient temperature are flat most of the time, so let them back
+    // off to a longer period while nothing is happening.
+    psensor_EnableAdaptivePeriod(pressureRef);
+    psensor_EnableAdaptivePeriod(tempRef);
+
+    psensor_EnableDeadband(pressureRef, PSENSOR_DEADBAND_PER_MEMBER);
+    psensor_EnableDeadband(tempRef, PSENSOR_DEADBAND_PER_MEMBER);
+
+    // Pressure is only sampled often to track altitude changes, which a parked device doesn't have.
+    psensor_EnableMotionGating(pressureRef, STATIONARY_PERIOD);
+
+    barometer_Init();
 }